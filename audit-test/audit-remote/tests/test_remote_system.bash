@@ -53,7 +53,7 @@ call_remote_function() {
     local my_ip="$LOCAL_IPV4"
     # the mode variable will get here from audisp-remote_functions.bash
     echo "---- START [$call_remote_function_seq] call_remote_function($call_function) ----"
-    /usr/bin/nc -v $LBLNET_SVR_IPV4 4000 <<< "remote_call:audit-remote.bash,$call_function,$mode,$my_ip;"
+    tstsvr_call -t 0 $LBLNET_SVR_IPV4 "remote_call:audit-remote.bash,$call_function,$mode,$my_ip;"
     echo "---- END [$call_remote_function_seq] call_remote_function($call_function)  ----"
     ((call_remote_function_seq+=1))
 }
@@ -28,12 +28,38 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 #include <auparse.h>
 
 static char *AUSEARCH = NULL;
 static char *LOG = NULL;
 static int continue_on_error = 0;
 
+/*
+ * --batch: rather than running ausearch through the shell once per field,
+ * with the criteria of the record so far, collect one query per record
+ * with all its criteria and run them at the end, up to --jobs at a time
+ * (one per CPU by default).  The queries of the records that are not
+ * found are then rerun one criterion at a time to report the failing one,
+ * as the serial mode does.
+ */
+static int batch = 0;
+static int jobs = 0;
+
+struct query {
+        int event;
+        int argc;
+        char **argv;    // ausearch -if LOG -a serial [opt val]...
+        char *record;
+        int status;
+};
+
+static struct query *queries = NULL;
+static int nqueries = 0, maxqueries = 0;
+static int event_nr = 0;
+
 struct nv_pair {
         const char *field;
         const char *option;
@@ -112,6 +138,161 @@ int run_ausearch(auparse_state_t *au, char *line, const char *opt,
         return 0;
 }
 
+static void *xrealloc(void *ptr, size_t size)
+{
+        ptr = realloc(ptr, size);
+        if (ptr == NULL) {
+                printf("Out of memory\n");
+                exit(1);
+        }
+        return ptr;
+}
+
+static void query_arg(const char *arg)
+{
+        struct query *q = &queries[nqueries - 1];
+
+        q->argv = xrealloc(q->argv, (q->argc + 2) * sizeof(char *));
+        q->argv[q->argc++] = strdup(arg);
+        q->argv[q->argc] = NULL;
+}
+
+static void query_start(auparse_state_t *au, const char *serial)
+{
+        struct query *q;
+
+        if (nqueries == maxqueries) {
+                maxqueries = maxqueries ? maxqueries * 2 : 1024;
+                queries = xrealloc(queries, maxqueries * sizeof(*queries));
+        }
+        q = &queries[nqueries++];
+        q->event = event_nr;
+        q->argc = 0;
+        q->argv = NULL;
+        q->record = strdup(auparse_get_record_text(au));
+        q->status = 0;
+        query_arg(AUSEARCH);
+        query_arg("-if");
+        query_arg(LOG);
+        query_arg("-a");
+        query_arg(serial);
+}
+
+/*
+ * Run the first argcs[i] arguments of every query, up to jobs at a time,
+ * with the output thrown away.  The exit status lands in status.
+ */
+static void run_queries(struct query **qs, int n, const int *argcs)
+{
+        int i, running = 0, next = 0, status;
+        pid_t *pids = xrealloc(NULL, (n ? n : 1) * sizeof(pid_t));
+        pid_t pid;
+
+        while (next < n || running) {
+                if (next < n && running < jobs) {
+                        struct query *q = qs[next];
+                        char *saved = q->argv[argcs[next]];
+
+                        // cut the query short, for the narrowing down
+                        q->argv[argcs[next]] = NULL;
+                        pid = fork();
+                        if (pid == 0) {
+                                int fd = open("/dev/null", O_WRONLY);
+                                dup2(fd, 1);
+                                dup2(fd, 2);
+                                execvp(q->argv[0], q->argv);
+                                _exit(127);
+                        }
+                        q->argv[argcs[next]] = saved;
+                        if (pid < 0) {
+                                printf("Can't fork: %s\n", strerror(errno));
+                                exit(1);
+                        }
+                        pids[next++] = pid;
+                        running++;
+                        continue;
+                }
+                pid = waitpid(-1, &status, 0);
+                if (pid < 0) {
+                        printf("Can't wait: %s\n", strerror(errno));
+                        exit(1);
+                }
+                for (i = 0; i < next; i++) {
+                        if (pids[i] == pid) {
+                                qs[i]->status = status;
+                                running--;
+                                break;
+                        }
+                }
+        }
+        free(pids);
+}
+
+static void print_command(const struct query *q, int argc)
+{
+        int i;
+
+        printf("Command used:");
+        for (i = 0; i < argc; i++) {
+                if (strchr(q->argv[i], ' '))
+                        printf(" '%s'", q->argv[i]);
+                else
+                        printf(" %s", q->argv[i]);
+        }
+        printf("\n");
+}
+
+/*
+ * Run the collected queries, then narrow the failed ones down to the
+ * criterion ausearch trips over.  Returns the number of events with a
+ * record not found.
+ */
+int run_batch(void)
+{
+        struct query **qs;
+        int *argcs;
+        int i, last_event = -1, problems = 0;
+
+        qs = xrealloc(NULL, (nqueries ? nqueries : 1) * sizeof(*qs));
+        argcs = xrealloc(NULL, (nqueries ? nqueries : 1) * sizeof(int));
+        for (i = 0; i < nqueries; i++) {
+                qs[i] = &queries[i];
+                argcs[i] = queries[i].argc;
+        }
+        run_queries(qs, nqueries, argcs);
+
+        // like the serial mode: the first record not found of an event,
+        // and without --continue the first of all
+        for (i = 0; i < nqueries; i++) {
+                struct query *q = &queries[i];
+                int argc;
+
+                if (q->status == 0 || q->event == last_event)
+                        continue;
+                last_event = q->event;
+
+                // -a serial first, then one criterion more at a time
+                for (argc = 5; argc < q->argc; argc += 2) {
+                        run_queries(&q, 1, &argc);
+                        if (q->status)
+                                break;
+                }
+                printf("\n");
+                printf("Failed to locate a record\n");
+                printf("Current test option: %s %s\n",
+                                q->argv[argc - 2], q->argv[argc - 1]);
+                print_command(q, argc);
+                printf("Full record being tested: %s\n", q->record);
+                problems++;
+                if (!continue_on_error)
+                        break;
+        }
+
+        free(argcs);
+        free(qs);
+        return problems;
+}
+
 /*
  * This tests one complete record
  */
@@ -134,13 +315,17 @@ int do_record_test(auparse_state_t *au)
                         snprintf(buf, sizeof(buf), "%lu", serial);
                         ptr = stpcpy(ptr, " -a ");
                         ptr = stpcpy(ptr, buf);
-                        asprintf(&line, "%s  >/dev/null 2>&1", cmd);
-                        if (run_ausearch(au, line, "-a", buf, cmd)) {
+                        first = 1;
+                        if (batch)
+                                query_start(au, buf);
+                        else {
+                                asprintf(&line, "%s  >/dev/null 2>&1", cmd);
+                                if (run_ausearch(au, line, "-a", buf, cmd)) {
+                                        free(line);
+                                        return 1;
+                                }
                                 free(line);
-                                return 1;
                         }
-                        free(line);
-                        first = 1;
                 }
                 const char *field = auparse_get_field_name(au);
                 if (field) {
@@ -248,11 +433,32 @@ int do_record_test(auparse_state_t *au)
                                 if (auparse_get_field_type(au) ==
                                                 AUPARSE_TYPE_ESCAPED &&
                                                 val[0] != '"') {
-                                        snprintf(buf, sizeof(buf), "\'%s\'",
-                                        auparse_interpret_field(au));
-                                        val = buf;
+                                        // no shell to quote for in batch
+                                        if (batch)
+                                                val = auparse_interpret_field(au);
+                                        else {
+                                                snprintf(buf, sizeof(buf), "\'%s\'",
+                                                auparse_interpret_field(au));
+                                                val = buf;
+                                        }
                                 }
 
+                                if (batch) {
+                                        size_t len = strlen(val);
+
+                                        // the shell strips the quotes of
+                                        // comm="bash" and the like in the
+                                        // serial mode, do the same here
+                                        if (len >= 2 && val[0] == '"' &&
+                                                        val[len - 1] == '"') {
+                                                snprintf(buf, sizeof(buf), "%.*s",
+                                                        (int)len - 2, val + 1);
+                                                val = buf;
+                                        }
+                                        query_arg(opt);
+                                        query_arg(val);
+                                        continue;
+                                }
                                 ptr = stpcpy(ptr, " ");
                                 ptr = stpcpy(ptr, opt);
                                 ptr = stpcpy(ptr, " ");
@@ -277,12 +483,16 @@ int main(int argc, char *argv[])
         setlocale (LC_ALL, "");
         while (argc > opt) {
                 if (strcmp(argv[opt], "--help") == 0) {
-                        printf("ausearch-test [path to different ausearch|log] [--continue]\n");
+                        printf("ausearch-test [path to different ausearch|log] [--continue] [--batch] [--jobs=N]\n");
                         return 0;
                 }
 //printf("opt=%d, argv[opt]=%s\n", opt, argv[opt]);
                 if (strcmp(argv[opt], "--continue") == 0)
                         continue_on_error = 1;
+                else if (strcmp(argv[opt], "--batch") == 0)
+                        batch = 1;
+                else if (strncmp(argv[opt], "--jobs=", 7) == 0)
+                        jobs = atoi(argv[opt] + 7);
                 else if (access(argv[opt], X_OK) == 0)
                         AUSEARCH = strdup(argv[opt]);
                 else if (access(argv[opt], R_OK) == 0) {
@@ -297,6 +507,10 @@ int main(int argc, char *argv[])
                 AUSEARCH = strdup("ausearch");
         if (LOG == NULL)
                 LOG = strdup("./audit.log");
+        if (jobs <= 0)
+                jobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (jobs <= 0)
+                jobs = 1;
 
         au = auparse_init(AUSOURCE_FILE, LOG);
         if (au == NULL) {
@@ -313,9 +527,12 @@ int main(int argc, char *argv[])
                                 break; // --continue given, do next event
                         }
                 } while (auparse_next_record(au) > 0);
+                event_nr++;
         } while (auparse_next_event(au) > 0);
 
         auparse_destroy(au);
+        if (batch)
+                problems = run_batch();
         if (problems) {
                 printf("Done - %d problems detected\n", problems);
                 return 1;
@@ -0,0 +1,364 @@
+/* =======================================================================
+ *   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of version 2 the GNU General Public License as
+ *   published by the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ *
+ * audit_stress: generate audit events at the highest sustainable rate
+ *
+ * Workers (threads and/or forked processes) repeatedly call cheap, always
+ * failing syscalls with a "magic" first argument, so that an audit rule
+ * filtering on a0 selects exactly the events generated here and nothing
+ * else running on the system.  Meanwhile the main thread polls the kernel
+ * audit status (the same data as `auditctl -s') every few milliseconds and
+ * tracks the backlog, the lost counter and the event rate per interval.
+ *
+ * The syscall mix is a comma separated list of the syscall names below;
+ * the caller is expected to arm matching rules, ie.
+ *
+ *   auditctl -a exit,always -F arch=b64 -S close -F a0=<magic>
+ *
+ * Output is a list of key=value lines suitable for sourcing / grepping,
+ * the "sustained_rate" being the average events/sec up to the first
+ * interval where the kernel reported lost events (or the whole run if
+ * nothing was lost).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <libaudit.h>
+
+#define MAX_SYSCALLS    8
+#define CACHELINE       64
+
+/* per-worker counter, padded to avoid false sharing between workers */
+struct counter {
+    volatile unsigned long long events;
+    char pad[CACHELINE - sizeof(unsigned long long)];
+};
+
+/* shared between threads and forked worker processes */
+struct shared {
+    volatile int run;
+    struct counter workers[];
+};
+
+struct sc_entry {
+    const char *name;
+    long nr;
+};
+
+/* all of these take an integer a0 and fail early with EBADF/ESRCH */
+static const struct sc_entry sc_table[] = {
+    { "close",   SYS_close },
+    { "dup",     SYS_dup },
+    { "fchdir",  SYS_fchdir },
+    { "fsync",   SYS_fsync },
+    { "getpgid", SYS_getpgid },
+    { "getsid",  SYS_getsid },
+    { NULL, 0 }
+};
+
+static long sc_mix[MAX_SYSCALLS];
+static int sc_mix_len;
+static long magic = 0x7fffabcd;
+static struct shared *shm;
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int parse_mix(char *mix)
+{
+    char *tok, *save = NULL;
+    int i;
+
+    for (tok = strtok_r(mix, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save)) {
+        for (i = 0; sc_table[i].name; i++)
+            if (!strcmp(sc_table[i].name, tok))
+                break;
+        if (!sc_table[i].name) {
+            fprintf(stderr, "unsupported syscall in mix: %s\n", tok);
+            return -1;
+        }
+        if (sc_mix_len == MAX_SYSCALLS) {
+            fprintf(stderr, "too many syscalls in mix\n");
+            return -1;
+        }
+        sc_mix[sc_mix_len++] = sc_table[i].nr;
+    }
+    return sc_mix_len ? 0 : -1;
+}
+
+static void worker(struct counter *cnt)
+{
+    int i;
+
+    while (shm->run) {
+        for (i = 0; i < sc_mix_len; i++)
+            syscall(sc_mix[i], magic);
+        cnt->events += sc_mix_len;
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    worker(arg);
+    return NULL;
+}
+
+/* fetch current audit status from the kernel, returns 0 on success */
+static int get_status(int fd, struct audit_status *st)
+{
+    struct audit_reply rep;
+    int rc;
+
+    if (audit_request_status(fd) <= 0)
+        return -1;
+
+    /* skip unrelated messages (ie. ACKs) until we get the status */
+    do {
+        rc = audit_get_reply(fd, &rep, GET_REPLY_BLOCKING, 0);
+        if (rc <= 0)
+            return -1;
+    } while (rep.type != AUDIT_GET);
+
+    memcpy(st, rep.status, sizeof(*st));
+    return 0;
+}
+
+static unsigned long long sum_events(int nworkers)
+{
+    unsigned long long total = 0;
+    int i;
+
+    for (i = 0; i < nworkers; i++)
+        total += shm->workers[i].events;
+    return total;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-p procs] [-d seconds] [-i interval_ms]\n"
+            "          [-s syscall[,syscall...]] [-m magic] [-v]\n"
+            "\n"
+            "  -t  number of worker threads (default 1)\n"
+            "  -p  number of worker processes, each with -t threads (default 0,\n"
+            "      ie. threads run in this process)\n"
+            "  -d  duration of the run in seconds (default 10)\n"
+            "  -i  audit status sampling interval in ms (default 10)\n"
+            "  -s  syscall mix (default close), supported:",
+            prog);
+    for (int i = 0; sc_table[i].name; i++)
+        fprintf(stderr, " %s", sc_table[i].name);
+    fprintf(stderr,
+            "\n"
+            "  -m  magic a0 value used by the syscalls (default 0x%lx)\n"
+            "  -v  print every sample\n", magic);
+}
+
+int main(int argc, char **argv)
+{
+    int nthreads = 1, nprocs = 0, duration = 10, interval = 10, verbose = 0;
+    int nworkers, fd, opt, i, j;
+    char mix[] = "close";
+    char *mixarg = mix;
+    pthread_t *threads;
+    pid_t *pids;
+    struct audit_status st, first;
+    unsigned long long start, end, t, prev_t;
+    unsigned long long ev, prev_ev, ev_at_loss = 0, t_at_loss = 0;
+    unsigned long long peak_rate = 0, rate;
+    unsigned int backlog_max = 0, samples = 0, lost_intervals = 0;
+    unsigned int lost_start, lost_seen;
+    int rc = 0;
+
+    while ((opt = getopt(argc, argv, "t:p:d:i:s:m:vh")) != -1) {
+        switch (opt) {
+        case 't': nthreads = atoi(optarg); break;
+        case 'p': nprocs = atoi(optarg); break;
+        case 'd': duration = atoi(optarg); break;
+        case 'i': interval = atoi(optarg); break;
+        case 's': mixarg = optarg; break;
+        case 'm': magic = strtol(optarg, NULL, 0); break;
+        case 'v': verbose = 1; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nthreads < 1 || nprocs < 0 || duration < 1 || interval < 1 ||
+        parse_mix(mixarg) < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    nworkers = nthreads * (nprocs ? nprocs : 1);
+    shm = mmap(NULL, sizeof(*shm) + nworkers * sizeof(struct counter),
+               PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        return 2;
+    }
+
+    fd = audit_open();
+    if (fd < 0) {
+        perror("audit_open");
+        return 2;
+    }
+    if (get_status(fd, &first) < 0) {
+        fprintf(stderr, "cannot get audit status\n");
+        return 2;
+    }
+    lost_start = lost_seen = first.lost;
+
+    shm->run = 1;
+    threads = calloc(nworkers, sizeof(*threads));
+    pids = calloc(nprocs ? nprocs : 1, sizeof(*pids));
+    if (!threads || !pids) {
+        perror("calloc");
+        return 2;
+    }
+
+    if (nprocs) {
+        for (i = 0; i < nprocs; i++) {
+            pids[i] = fork();
+            if (pids[i] < 0) {
+                perror("fork");
+                shm->run = 0;
+                return 2;
+            }
+            if (pids[i] == 0) {
+                struct counter *base = &shm->workers[i * nthreads];
+                for (j = 1; j < nthreads; j++) {
+                    if (pthread_create(&threads[j], NULL, worker_thread,
+                                       &base[j])) {
+                        perror("pthread_create");
+                        shm->run = 0;
+                        _exit(2);
+                    }
+                }
+                worker(&base[0]);
+                for (j = 1; j < nthreads; j++)
+                    pthread_join(threads[j], NULL);
+                _exit(0);
+            }
+        }
+    } else {
+        for (i = 0; i < nthreads; i++) {
+            if (pthread_create(&threads[i], NULL, worker_thread,
+                               &shm->workers[i])) {
+                perror("pthread_create");
+                shm->run = 0;
+                return 2;
+            }
+        }
+    }
+
+    start = prev_t = now_ns();
+    end = start + duration * 1000000000ULL;
+    prev_ev = 0;
+
+    while ((t = now_ns()) < end) {
+        usleep(interval * 1000);
+
+        if (get_status(fd, &st) < 0) {
+            fprintf(stderr, "cannot get audit status\n");
+            rc = 2;
+            break;
+        }
+        t = now_ns();
+        ev = sum_events(nworkers);
+        samples++;
+
+        rate = (ev - prev_ev) * 1000000000ULL / (t - prev_t);
+        if (rate > peak_rate)
+            peak_rate = rate;
+        if (st.backlog > backlog_max)
+            backlog_max = st.backlog;
+        if (st.lost != lost_seen) {
+            if (!t_at_loss) {
+                t_at_loss = t;
+                ev_at_loss = prev_ev;
+            }
+            lost_intervals++;
+            lost_seen = st.lost;
+        }
+        if (verbose)
+            printf("sample t=%.3f events=%llu rate=%llu backlog=%u lost=%u\n",
+                   (t - start) / 1e9, ev, rate, st.backlog, st.lost);
+
+        prev_t = t;
+        prev_ev = ev;
+    }
+
+    shm->run = 0;
+    if (nprocs) {
+        for (i = 0; i < nprocs; i++) {
+            int status;
+            if (waitpid(pids[i], &status, 0) < 0 ||
+                !WIFEXITED(status) || WEXITSTATUS(status)) {
+                fprintf(stderr, "worker process %d failed\n", (int)pids[i]);
+                rc = 2;
+            }
+        }
+    } else {
+        for (i = 0; i < nthreads; i++)
+            pthread_join(threads[i], NULL);
+    }
+    end = now_ns();
+    ev = sum_events(nworkers);
+
+    /* final status, lost is reported relative to the start of the run */
+    if (get_status(fd, &st) < 0)
+        st = first;
+    audit_close(fd);
+
+    printf("workers=%d\n", nworkers);
+    printf("samples=%u\n", samples);
+    printf("events=%llu\n", ev);
+    printf("duration=%.3f\n", (end - start) / 1e9);
+    printf("rate=%llu\n", ev * 1000000000ULL / (end - start));
+    printf("peak_rate=%llu\n", peak_rate);
+    if (t_at_loss) {
+        printf("sustained_rate=%llu\n",
+               ev_at_loss * 1000000000ULL / (t_at_loss - start));
+        printf("overflow_after=%.3f\n", (t_at_loss - start) / 1e9);
+    } else {
+        printf("sustained_rate=%llu\n", ev * 1000000000ULL / (end - start));
+        printf("overflow_after=none\n");
+    }
+    printf("lost_intervals=%u\n", lost_intervals);
+    printf("backlog_max=%u\n", backlog_max);
+    printf("backlog_limit=%u\n", st.backlog_limit);
+    printf("rate_limit=%u\n", st.rate_limit);
+    printf("lost=%u\n", st.lost - lost_start);
+
+    return rc;
+}
+
+/* vim: set sts=4 sw=4 et : */
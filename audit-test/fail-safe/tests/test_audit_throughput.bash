@@ -0,0 +1,81 @@
+#!/bin/bash
+###############################################################################
+#   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of version 2 the GNU General Public License as
+#   published by the Free Software Foundation.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###############################################################################
+#
+# PURPOSE:
+# Measure the sustained audit event rate of the kernel and auditd and the
+# behaviour of the audit backlog under load.  The audit_stress generator
+# drives a syscall mix across several workers with matching audit rules
+# armed, sampling the backlog and lost counters while doing so.  The results
+# are meant for sizing backlog_limit, flush and freq of a given system.
+#
+# Named arguments (all optional):
+#   threads=N        worker threads (per process), default: number of CPUs
+#   procs=N          worker processes, default 0 (threads in one process)
+#   duration=SEC     length of the run, default 10
+#   interval=MS      status sampling interval, default 10
+#   mix=SC[,SC..]    syscall mix, default close,dup,getpgid
+#   backlog_limit=N  backlog limit to use for the run, default unchanged
+#   max_lost=N       fail if more than N events were lost, default unlimited
+
+source testcase.bash || exit 2
+
+eval "$(parse_named "$@")" || exit_error "parse_named failed"
+[[ ${#unnamed[@]} -eq 0 ]] || exit_error "unknown arguments: ${unnamed[*]}"
+
+threads=${threads:-$(nproc)}
+procs=${procs:-0}
+duration=${duration:-10}
+interval=${interval:-10}
+mix=${mix:-close,dup,getpgid}
+
+# a0 value used by all syscalls of the generator, see audit_stress.c
+magic=$((0x7fffabcd))
+
+# the kernel must not rate-limit us, that would show up as lost events
+orig_rate=$(auditctl -s | awk '$1 == "rate_limit" {print $2}')
+orig_backlog=$(auditctl -s | awk '$1 == "backlog_limit" {print $2}')
+[[ $orig_rate && $orig_backlog ]] || exit_error "cannot read audit status"
+prepend_cleanup "auditctl -r $orig_rate -b $orig_backlog >/dev/null"
+auditctl -r 0 >/dev/null || exit_error
+if [[ $backlog_limit ]]; then
+    auditctl -b "$backlog_limit" >/dev/null || exit_error
+fi
+
+for sc in ${mix//,/ }; do
+    rule="exit,always ${MODE:+-F arch=b$MODE} -S $sc -F a0=$magic -k audit_stress"
+    auditctl -a $rule || exit_error "cannot add rule for $sc"
+    prepend_cleanup "auditctl -d $rule"
+done
+
+auditctl -s
+
+out=$(./audit_stress -t "$threads" -p "$procs" -d "$duration" \
+                     -i "$interval" -s "$mix" -m "$magic") \
+    || exit_error "audit_stress failed"
+echo "$out"
+
+lost=$(awk -F= '$1 == "lost" {print $2}' <<<"$out")
+events=$(awk -F= '$1 == "events" {print $2}' <<<"$out")
+[[ $events -gt 0 ]] || exit_fail "no events were generated"
+
+if [[ $max_lost && $lost -gt $max_lost ]]; then
+    exit_fail "lost $lost events (more than $max_lost)"
+fi
+
+exit_pass
+
+# vim: sts=4 sw=4 et :
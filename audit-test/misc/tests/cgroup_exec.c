@@ -1,6 +1,7 @@
 /*
  * this tool executes a command within a cgroup, given a path to the "tasks"
- * file within a specific cgroup on a 'cgroup' filesystem type
+ * file within a specific cgroup on a 'cgroup' filesystem type, or to the
+ * "cgroup.procs" file on a 'cgroup2' one
  */
 
 #include <stdio.h>
@@ -12,7 +13,7 @@ int main(int argc, char **argv)
     FILE *f;
 
     if (argc < 3) {
-        printf("usage: %s <path_to_tasks> <cmd> [args]\n", argv[0]);
+        printf("usage: %s <path_to_tasks_or_cgroup.procs> <cmd> [args]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
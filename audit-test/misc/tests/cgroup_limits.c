@@ -15,10 +15,14 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <linux/fs.h>
+#include <linux/aio_abi.h>
 
 /*
  * helpers
@@ -34,18 +38,106 @@ int int_action(void (*handler)(int))
 }
 
 /*
- * testing functions
+ * statistics (-s), printed as key=value lines after the result
  */
 
 typedef unsigned long long ull;
 
-/* eat cpu cycles */
+#define MAX_INTERVALS 1024
+
+struct stats {
+    int enabled;
+    ull interval_ns;        /* -i, per interval series resolution */
+    ull start_ns, next_ns;  /* wall clock */
+    ull last_ns, last_val;  /* at the previous interval boundary */
+    ull series[MAX_INTERVALS];
+    int nseries;
+} stats = { .interval_ns = 100000000ULL };
+
+ull clock_ns(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void stats_start(ull val)
+{
+    stats.start_ns = stats.last_ns = clock_ns(CLOCK_MONOTONIC);
+    stats.next_ns = stats.start_ns + stats.interval_ns;
+    stats.last_val = val;
+}
+
+/* record the growth of val over each interval, as a percentage of the
+ * wall time elapsed if pct is set (for CPU time in ns); intervals passed
+ * without a sample (a blocked read) are recorded as zero growth */
+void stats_sample(ull val, int pct)
+{
+    ull now = clock_ns(CLOCK_MONOTONIC), missed;
+
+    if (now < stats.next_ns)
+        return;
+    missed = stats.next_ns ? (now - stats.next_ns) / stats.interval_ns : 0;
+    if (!pct)
+        while (missed-- && stats.nseries < MAX_INTERVALS)
+            stats.series[stats.nseries++] = 0;
+    if (stats.nseries < MAX_INTERVALS)
+        stats.series[stats.nseries++] = pct ?
+            (val - stats.last_val) * 100 / (now - stats.last_ns + 1) :
+            val - stats.last_val;
+    stats.last_ns = now;
+    stats.last_val = val;
+    stats.next_ns = now + stats.interval_ns;
+}
+
+/* close the last, partial, interval (too short for a percentage) and
+ * print it all */
+void stats_print(ull val, int pct, const char *series_unit)
+{
+    struct rusage ru;
+    ull wall = clock_ns(CLOCK_MONOTONIC) - stats.start_ns;
+    int i;
+
+    if (!pct) {
+        stats.next_ns = 0;
+        stats_sample(val, pct);
+    }
+
+    getrusage(RUSAGE_SELF, &ru);
+    printf("wall_us=%llu\n", wall / 1000);
+    printf("cpu_us=%llu\n", clock_ns(CLOCK_THREAD_CPUTIME_ID) / 1000);
+    printf("utime_us=%llu\n", ru.ru_utime.tv_sec * 1000000ULL + ru.ru_utime.tv_usec);
+    printf("stime_us=%llu\n", ru.ru_stime.tv_sec * 1000000ULL + ru.ru_stime.tv_usec);
+    printf("nvcsw=%ld\n", ru.ru_nvcsw);
+    printf("nivcsw=%ld\n", ru.ru_nivcsw);
+    printf("inblock=%ld\n", ru.ru_inblock);
+    printf("interval_ms=%llu\n", stats.interval_ns / 1000000);
+    printf("per_interval_%s=", series_unit);
+    for (i = 0; i < stats.nseries; i++)
+        printf("%s%llu", i ? "," : "", stats.series[i]);
+    printf("\n");
+}
+
+/*
+ * testing functions
+ */
+
+/* eat cpu cycles, with -s sampling the CPU share every 64k iterations */
 ull test_cpu(void)
 {
     volatile ull i;
 
     int_action(stop_loop);
 
+    if (stats.enabled) {
+        stats_start(clock_ns(CLOCK_THREAD_CPUTIME_ID));
+        for (i = 0; run && i < ULLONG_MAX; i++)
+            if (!(i & 0xffff))
+                stats_sample(clock_ns(CLOCK_THREAD_CPUTIME_ID), 1);
+        return i;
+    }
+
     /* may stress RAM as well, but as far as OS resources go, only CPU */
     for (i = 0; run && i < ULLONG_MAX; i++);
 
@@ -72,30 +164,96 @@ ull test_memory(ull size)
     return i;
 }
 
-/* read blocks from opened block device, at_once blocks at a time */
-ull test_blkio(int fd, ull at_once)
+/* keep depth reads of len bytes in flight with Linux AIO */
+ull blkio_aio(int fd, char *buff, size_t len, int depth, ull *ios)
+{
+    aio_context_t ctx = 0;
+    struct iocb cbs[depth], *cbp;
+    struct io_event events[depth];
+    ull size = 0, offset = 0, total_len = 0;
+    int i, n, inflight = 0;
+
+    if (ioctl(fd, BLKGETSIZE64, &size) == -1 ||
+        syscall(SYS_io_setup, depth, &ctx) == -1)
+        return 0;
+
+    memset(cbs, 0, sizeof(cbs));
+    for (i = 0; i < depth && offset + len <= size; i++, offset += len) {
+        cbs[i].aio_fildes = fd;
+        cbs[i].aio_lio_opcode = IOCB_CMD_PREAD;
+        cbs[i].aio_buf = (uintptr_t)(buff + i * len);
+        cbs[i].aio_nbytes = len;
+        cbs[i].aio_offset = offset;
+        cbs[i].aio_data = i;
+        cbp = &cbs[i];
+        if (syscall(SYS_io_submit, ctx, 1, &cbp) != 1)
+            break;
+        inflight++;
+    }
+
+    while (inflight > 0) {
+        n = syscall(SYS_io_getevents, ctx, 1, depth, events, NULL);
+        if (n == -1)
+            break;  /* EINTR, stopped */
+        for (i = 0; i < n; i++) {
+            inflight--;
+            if ((long long)events[i].res <= 0)
+                continue;
+            total_len += events[i].res;
+            (*ios)++;
+            /* the next block, in the iocb just completed */
+            if (!run || offset + len > size)
+                continue;
+            cbp = &cbs[events[i].data];
+            cbp->aio_offset = offset;
+            offset += len;
+            if (syscall(SYS_io_submit, ctx, 1, &cbp) == 1)
+                inflight++;
+        }
+        if (stats.enabled)
+            stats_sample(total_len, 0);
+    }
+
+    /* waits for what is still in flight */
+    syscall(SYS_io_destroy, ctx);
+    return total_len;
+}
+
+/* read blocks from opened block device, at_once blocks at a time, with
+ * depth reads in flight (AIO, O_DIRECT makes it actually asynchronous) */
+ull test_blkio(int fd, ull at_once, int depth, ull *ios)
 {
     char *buff;
     int blksz;
     ssize_t len;
     ull total_len;
 
-    if (!at_once)
+    if (!at_once || depth < 1)
         return 0;
 
     if (ioctl(fd, BLKBSZGET, &blksz) == -1)
         return 0;
 
     at_once = at_once * blksz;  /* sectors -> bytes */
-    buff = malloc(at_once);
-    if (!buff)
+    /* aligned for O_DIRECT */
+    if (posix_memalign((void **)&buff, blksz, at_once * depth))
         return 0;
 
     int_action(stop_loop);
+    if (stats.enabled)
+        stats_start(0);
 
     total_len = 0;
-    while (run && (len = read(fd, buff, at_once)) > 0)
-        total_len += len;
+    if (depth > 1) {
+        total_len = blkio_aio(fd, buff, at_once, depth, ios);
+    } else {
+        while (run && (len = read(fd, buff, at_once)) > 0) {
+            total_len += len;
+            (*ios)++;
+            if (stats.enabled)
+                stats_sample(total_len, 0);
+        }
+    }
 
     return total_len;
 }
@@ -130,26 +288,60 @@ void test_freezer(int fd)
 
 int main(int argc, char **argv)
 {
-    if (argc < 2) {
+    int opt, depth = 1, direct = 0;
+    char *prog = argv[0];
+
+    while ((opt = getopt(argc, argv, "+sdq:i:")) != -1) {
+        switch (opt) {
+        case 's':
+            stats.enabled = 1;
+            break;
+        case 'd':
+            direct = O_DIRECT;
+            break;
+        case 'q':
+            depth = atoi(optarg);
+            break;
+        case 'i':
+            stats.interval_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+            break;
+        default:
+            argc = 0;
+        }
+    }
+    argv += optind - 1;
+    argc -= optind - 1;
+
+    if (argc < 2 || depth < 1 || !stats.interval_ns) {
         fprintf(stderr,
-                "usage: %s <controller> [arguments]\n"
+                "usage: %s [options] <controller> [arguments]\n"
                 "\n"
                 "Arguments:\n"
                 "  controller: cgroups controller to test\n"
                 "  arguments:  zero or more controller-specific arguments\n"
                 "\n"
+                "Options:\n"
+                "  -s          print statistics (key=value) after the result:\n"
+                "              CPU time, rusage, per interval CPU share (cpu)\n"
+                "              or bytes read (blkio)\n"
+                "  -i ms       statistics interval (100)\n"
+                "  -d          blkio: read with O_DIRECT\n"
+                "  -q depth    blkio: reads in flight, with AIO (1)\n"
+                "\n"
                 "Controllers (with arguments):\n"
                 "  cpu\n"
                 "  memory size_in_bytes\n"
                 "  blkio path_to_device [blocks_at_a_time]\n"
                 "  devices path_to_device\n"
                 "  freezer\n"
-                , argv[0]);
+                , prog);
         exit(EXIT_FAILURE);
     }
 
     if (!strcmp(argv[1], "cpu")) {
         printf("%llu\n", test_cpu());
+        if (stats.enabled)
+            stats_print(clock_ns(CLOCK_THREAD_CPUTIME_ID), 1, "cpu_pct");
 
     } else if (!strcmp(argv[1], "memory")) {
         if (argc < 3)
@@ -160,7 +352,7 @@ int main(int argc, char **argv)
     } else if (!strcmp(argv[1], "blkio")) {
         if (argc < 3)
             exit(EXIT_FAILURE);
-        int fd = open(argv[2], O_RDONLY);
+        int fd = open(argv[2], O_RDONLY | direct);
         if (fd == -1) {
             perror("open");
             exit(EXIT_FAILURE);
@@ -168,7 +360,17 @@ int main(int argc, char **argv)
         ull blocks = 1;
         if (argc >= 4)
             blocks = strtoull(argv[3], NULL, 10);
-        printf("%llu\n", test_blkio(fd, blocks));
+        ull ios = 0, total_len = test_blkio(fd, blocks, depth, &ios);
+        printf("%llu\n", total_len);
+        if (stats.enabled) {
+            printf("bytes=%llu\n", total_len);
+            printf("ios=%llu\n", ios);
+            printf("depth=%d\n", depth);
+            printf("direct=%d\n", !!direct);
+            printf("bytes_per_sec=%llu\n", total_len * 1000000000ULL /
+                   (clock_ns(CLOCK_MONOTONIC) - stats.start_ns + 1));
+            stats_print(total_len, 0, "bytes");
+        }
         close(fd);
 
     } else if (!strcmp(argv[1], "devices")) {
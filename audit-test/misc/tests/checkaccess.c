@@ -1,130 +1,314 @@
+/*
+ * checkaccess - ownership and mode audit of configuration trees
+ *
+ * usage: checkaccess [-s] [-j threads] [-i glob]... [-x glob]...
+ *                    [-b baseline] <file or directory>...
+ *
+ * Every root given and every file under it (see fswalk.h, -j threads,
+ * one per CPU by default) must be owned by root and must not be writable
+ * by group or world.  Symlinks are skipped.
+ *
+ *   -i glob      only check the paths matching one of the -i globs
+ *   -x glob      do not check the paths matching one of the -x globs
+ *                (fnmatch(3), '*' matches '/' too)
+ *   -s           summary only: the FAIL lines and a summary line, no PASS
+ *                and INFO ones
+ *   -b baseline  skip the entries that passed last time and did not change
+ *                since (same inode, mode, owner and mtime), then write the
+ *                entries that passed to the baseline file for the next run
+ *
+ * The baseline is a text file, one "inode mode uid mtime_ns path" line per
+ * entry.
+ */
+
 #include <sys/types.h>
-#include <sys/dir.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+#include "fswalk.h"
+
+#define MAXGLOBS 64
 
-extern int alphasort ();
+struct bentry {
+  char *path;
+  unsigned long long ino, mtime;
+  unsigned int mode, uid;
+  int seen;
+};
+
+struct audit {
+  int summary;
+  int nincl, nexcl;
+  const char *incl[MAXGLOBS];
+  const char *excl[MAXGLOBS];
+
+  /* the previous baseline, a read-only hash table during the walk */
+  struct bentry *base;
+  size_t basesize;
+
+  /* the next one */
+  FILE *next;
+  pthread_mutex_t lock;
+
+  unsigned long checked, passed, failed, symlinks, excluded, unchanged;
+};
 
 int g_rc = 0;
 
-/*
- * Do not include . or .. in directory list.
- */
-int file_select (const struct direct *entry)
+static unsigned long hash (const char *s)
+{
+  unsigned long h = 14695981039346656037UL;
+
+  while (*s)
+    h = (h ^ (unsigned char)*s++) * 1099511628211UL;
+  return h;
+}
+
+static struct bentry *base_find (struct audit *a, const char *path)
 {
-  if ((strcmp (entry->d_name, ".") == 0)
-      || (strcmp (entry->d_name, "..") == 0))
-    return (0);
-  else
-    return (1);
+  size_t i;
+
+  if (!a->basesize)
+    return NULL;
+  for (i = hash(path) % a->basesize; a->base[i].path;
+       i = (i + 1) % a->basesize)
+    if (!strcmp(a->base[i].path, path))
+      return &a->base[i];
+  return NULL;
 }
 
+/* load the baseline, a missing one is an empty one */
+static int base_load (struct audit *a, const char *file)
+{
+  FILE *f;
+  char *line = NULL;
+  size_t len = 0, n = 0, i;
+  struct bentry e;
+  int off;
+
+  if (!(f = fopen(file, "r")))
+    return errno == ENOENT ? 0 : -1;
+  while (getline(&line, &len, f) > 0)
+    n++;
+  a->basesize = n * 2 + 1;
+  if (!(a->base = calloc(a->basesize, sizeof(*a->base)))) {
+    fclose(f);
+    return -1;
+  }
+
+  rewind(f);
+  while (getline(&line, &len, f) > 0) {
+    line[strcspn(line, "\n")] = '\0';
+    memset(&e, 0, sizeof(e));
+    if (sscanf(line, "%llu %o %u %llu %n", &e.ino, &e.mode, &e.uid,
+               &e.mtime, &off) != 4 || !line[off])
+      continue;
+    if (base_find(a, line + off))
+      continue;
+    e.path = strdup(line + off);
+    for (i = hash(e.path) % a->basesize; a->base[i].path;
+         i = (i + 1) % a->basesize)
+      ;
+    a->base[i] = e;
+  }
+  free(line);
+  fclose(f);
+  return 0;
+}
+
+static int matches (const char *const *globs, int n, const char *path)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    if (!fnmatch(globs[i], path, 0))
+      return 1;
+  return 0;
+}
+
+#define COUNT(a, field) __atomic_add_fetch(&(a)->field, 1, __ATOMIC_RELAXED)
+
 /*
  * Check access.
  *
- * This method will recursively scan directories and check
- * that the file owner is root and that the file is not
- * writable by group or world.
+ * Called by the walker (see fswalk.h) for every file under the
+ * target, checks that the file owner is root and that the file is
+ * not writable by group or world.
  */
-int check_access (char *pathname)
+int check_access (const struct fswalk_ent *ent, void *arg)
 {
-  int count = 0;
-  int i = 0;
-  int rc;
-  int file_select ();
-  char entry[MAXPATHLEN];
-  struct dirent **entries;
-  struct stat statbuf;
-
-
-  //
-  // Check if pathname is file or directory.
-  //
-  if ((rc = stat(pathname, &statbuf)) == -1) {
-    printf("FAIL: %s. Could not obtain file status\n", pathname);
-    goto EXIT;
+  struct audit *a = arg;
+  struct bentry *b;
+  unsigned long long mtime;
+
+  // still there, checked or not
+  if ((b = base_find(a, ent->path)))
+    b->seen = 1;
+
+  if (a->nincl && !matches(a->incl, a->nincl, ent->path)) {
+    COUNT(a, excluded);
+    return 0;
+  }
+  if (matches(a->excl, a->nexcl, ent->path)) {
+    COUNT(a, excluded);
+    return 0;
   }
 
-  //
-  // If not directory, just check file permissions.
-  //
-  if (!(statbuf.st_mode & S_IFDIR)) {
-    if (statbuf.st_uid != 0) {
-      printf ("FAIL: %s. Invalid owner\n", entry);
-      rc = -1;
-      goto EXIT;
-    }
-    if ((statbuf.st_mode & S_IWGRP) || (statbuf.st_mode & S_IWOTH)) {
-      printf ("FAIL: %s. Invalid write access\n", entry);
-      rc = -1;
-      goto EXIT;
-    }
-    printf ("PASS: %s\n", pathname);
-    goto EXIT;
+  COUNT(a, checked);
+  if (ent->err) {
+    printf("FAIL: %s. Could not obtain file status\n", ent->path);
+    COUNT(a, failed);
+    g_rc = -1;
+    return 0;
   }
 
-  //
-  // If directory, recurse through all subdirectories, checking all files.
-  //
-  if ((count = scandir (pathname, &entries, file_select, alphasort)) == -1) {
-    rc = count;
-    goto EXIT;
+  // ignore symlinks
+  if (S_ISLNK(ent->st.st_mode)) {
+    if (!a->summary)
+      printf("INFO: %s. Skipping symlink\n", ent->path);
+    COUNT(a, symlinks);
+    return 0;
   }
-  for (i = 0; i < count; i++) {
-    sprintf(entry, "%s/%s", pathname, entries[i]->d_name);
-    if (entries[i]->d_type == DT_DIR) {
-      if ((rc = check_access (entry)) == -1) {
-	goto EXIT;
-      }
-    } else {
-      // ignore symlinks
-      rc = lstat(entry, &statbuf);
-      if(rc == 0 && S_ISLNK(statbuf.st_mode) == 1) {
-    printf("INFO: %s/%s. Skipping symlink\n", pathname, entries[i]->d_name);
-    continue;
-      }
-      if ((rc = stat(entry, &statbuf)) == -1) {
-	printf("FAIL: %s. Could not obtain file status\n", entry);
-	g_rc = -1;
-	continue;
-      }
-      if (statbuf.st_uid != 0) {
-	printf ("FAIL: %s. Invalid owner\n", entry);
-	g_rc = -1;
-	continue;
-      }
-      if ((statbuf.st_mode & S_IWGRP) || (statbuf.st_mode & S_IWOTH)) {
-	printf ("FAIL: %s. Invalid write access\n", entry);
-	g_rc = -1;
-	continue;
-      }
-
-      printf ("PASS: %s\n", entry);
-    }
+
+  // unchanged since it passed last time
+  mtime = ent->st.st_mtim.tv_sec * 1000000000ULL + ent->st.st_mtim.tv_nsec;
+  if (b && b->ino == ent->st.st_ino && b->mode == ent->st.st_mode &&
+      b->uid == ent->st.st_uid && b->mtime == mtime) {
+    COUNT(a, unchanged);
+    COUNT(a, passed);
+    goto PASS;
+  }
+
+  if (ent->st.st_uid != 0) {
+    printf ("FAIL: %s. Invalid owner\n", ent->path);
+    COUNT(a, failed);
+    g_rc = -1;
+    return 0;
+  }
+  if ((ent->st.st_mode & S_IWGRP) || (ent->st.st_mode & S_IWOTH)) {
+    printf ("FAIL: %s. Invalid write access\n", ent->path);
+    COUNT(a, failed);
+    g_rc = -1;
+    return 0;
   }
 
-EXIT:
+  COUNT(a, passed);
+  if (!a->summary)
+    printf ("PASS: %s\n", ent->path);
 
-  return rc;
+ PASS:
+  if (a->next) {
+    pthread_mutex_lock(&a->lock);
+    fprintf(a->next, "%llu %o %u %llu %s\n",
+            (unsigned long long)ent->st.st_ino, ent->st.st_mode,
+            ent->st.st_uid, mtime, ent->path);
+    pthread_mutex_unlock(&a->lock);
+  }
+  return 0;
 }
 
 int main (int argc, char *argv[])
 {
-  int rc;
+  int rc = 0;
+  int opt, i;
+  int nthreads = 0;
+  unsigned long removed = 0;
+  const char *baseline = NULL;
+  char *next = NULL;
+  struct fswalk_ent ent;
+  struct audit a;
+
+  memset(&a, 0, sizeof(a));
+  pthread_mutex_init(&a.lock, NULL);
 
-  if (argc != 2) {
-    printf("Please enter target file or directory");
+  while ((opt = getopt(argc, argv, "sj:i:x:b:")) != -1) {
+    switch (opt) {
+    case 's':
+      a.summary = 1;
+      break;
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    case 'i':
+      if (a.nincl == MAXGLOBS)
+        goto USAGE;
+      a.incl[a.nincl++] = optarg;
+      break;
+    case 'x':
+      if (a.nexcl == MAXGLOBS)
+        goto USAGE;
+      a.excl[a.nexcl++] = optarg;
+      break;
+    case 'b':
+      baseline = optarg;
+      break;
+    default:
+      goto USAGE;
+    }
+  }
+  if (optind == argc) {
+USAGE:
+    printf("usage: %s [-s] [-j <threads>] [-i <glob>]... [-x <glob>]... "
+           "[-b <baseline>] <file or directory>...\n", argv[0]);
     rc = -1;
     goto EXIT;
   }
 
-  rc = check_access (argv[1]);
-  return rc;
+  if (baseline) {
+    if (base_load(&a, baseline) == -1 ||
+        asprintf(&next, "%s.new", baseline) == -1 ||
+        !(a.next = fopen(next, "w"))) {
+      printf("ERROR: unable to use baseline %s: %s\n", baseline,
+             strerror(errno));
+      rc = -1;
+      goto EXIT;
+    }
+  }
+
+  for (i = optind; i < argc; i++) {
+    // the directories themselves, the walk reports what is in them
+    if (stat(argv[i], &ent.st) == 0 && S_ISDIR(ent.st.st_mode)) {
+      ent.dirfd = AT_FDCWD;
+      ent.name = ent.path = argv[i];
+      ent.err = 0;
+      check_access(&ent, &a);
+    }
+    if (fswalk(argv[i], nthreads, check_access, &a) != 0)
+      rc = -1;
+  }
+
+  for (i = 0; i < (int)a.basesize; i++) {
+    if (!a.base[i].path || a.base[i].seen)
+      continue;
+    if (!a.summary)
+      printf("INFO: %s. Removed since the baseline\n", a.base[i].path);
+    removed++;
+  }
+
+  if (a.next) {
+    // a failed run leaves the previous baseline alone
+    if (fclose(a.next) != 0 || rc != 0 || rename(next, baseline) != 0) {
+      printf("ERROR: unable to write baseline %s\n", baseline);
+      unlink(next);
+      rc = -1;
+    }
+  }
+
+  if (a.summary || baseline)
+    printf("checked=%lu passed=%lu failed=%lu symlinks=%lu excluded=%lu "
+           "unchanged=%lu removed=%lu\n", a.checked, a.passed, a.failed,
+           a.symlinks, a.excluded, a.unchanged, removed);
 
  EXIT:
+  free(next);
   /*
    ** The reason for 2 return codes:
    ** g_rc represents a failure of the tested function.
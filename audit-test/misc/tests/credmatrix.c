@@ -0,0 +1,535 @@
+/* credmatrix.c - credential matrix access checks for the permission tests
+ *
+ * See credmatrix.h.  The workers take the credential for good (real,
+ * effective and saved ids), the capabilities they keep survive the switch
+ * through PR_SET_KEEPCAPS.  Requests and replies are single datagrams on
+ * a SOCK_SEQPACKET socketpair.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/capability.h>
+
+#include "credmatrix.h"
+
+#define CM_ARGS		4096
+#define CM_OUT		4096
+
+enum { REQ_CHECK, REQ_BATCH, REQ_RUN, REQ_EXIT };
+
+struct request {
+	int type;
+	int ops;
+	cm_op_fn fn;		/* batch: the operation, */
+	size_t size;		/* the size of an object in args */
+	mode_t mode;		/* file type of path */
+	char path[PATH_MAX];
+	int argc;		/* or the number of objects */
+	char args[CM_ARGS];	/* NUL separated, or the objects */
+};
+
+struct reply {
+	int status;		/* errno of the request, wait status for a run */
+	struct cm_result res;
+	char out[CM_OUT];	/* or the batch results */
+};
+
+#define CM_BATCH	(CM_OUT / sizeof(struct cm_result))
+
+extern char **environ;
+
+static int
+xchg(int sock, struct request *req, struct reply *rep)
+{
+	ssize_t n;
+
+	if (req && send(sock, req, sizeof(*req), 0) != sizeof(*req))
+		return -1;
+	do {
+		n = recv(sock, rep, sizeof(*rep), 0);
+	} while (n == -1 && errno == EINTR);
+	if (n != sizeof(*rep)) {
+		errno = n == -1 ? errno : EPROTO;
+		return -1;
+	}
+	return 0;
+}
+
+static int
+set_cred(const struct cm_cred *c)
+{
+	struct __user_cap_header_struct hdr = { _LINUX_CAPABILITY_VERSION_3, 0 };
+	struct __user_cap_data_struct data[2];
+	int i;
+
+	if (prctl(PR_SET_KEEPCAPS, 1, 0, 0, 0) == -1 ||
+	    setgroups(c->ngroups, c->groups) == -1 ||
+	    setresgid(c->gid, c->gid, c->gid) == -1 ||
+	    setresuid(c->uid, c->uid, c->uid) == -1 ||
+	    syscall(SYS_capget, &hdr, data) == -1)
+		return -1;
+	for (i = 0; i < 2; i++) {
+		data[i].permitted &= (uint32_t)(c->caps >> (32 * i));
+		data[i].effective = data[i].permitted;
+		data[i].inheritable = 0;
+	}
+	return syscall(SYS_capset, &hdr, data);
+}
+
+/* run argv with stdout into out (or /dev/null), returns the wait status */
+static int
+run(char *const argv[], char *out, size_t len, int *err)
+{
+	int p[2], e[2], null, status = -1;
+	ssize_t n;
+	size_t got = 0;
+	pid_t pid;
+
+	*err = 0;
+	if (pipe2(p, O_CLOEXEC) == -1)
+		return -1;
+	if (pipe2(e, O_CLOEXEC) == -1) {
+		close(p[0]);
+		close(p[1]);
+		return -1;
+	}
+	pid = fork();
+	if (pid == 0) {
+		null = open("/dev/null", O_RDWR);
+		dup2(null, 0);
+		dup2(out ? p[1] : null, 1);
+		dup2(null, 2);
+		execve(argv[0], argv, environ);
+		/* tell the exec failure from the command's own */
+		n = errno;
+		if (write(e[1], &n, sizeof(n)))
+			;
+		_exit(127);
+	}
+	close(p[1]);
+	close(e[1]);
+	if (pid == -1) {
+		*err = errno;
+		close(p[0]);
+		close(e[0]);
+		return -1;
+	}
+	while (out && got < len - 1 &&
+	       (n = read(p[0], out + got, len - 1 - got)) > 0)
+		got += n;
+	if (out)
+		out[got] = '\0';
+	if (read(e[0], &n, sizeof(n)) == sizeof(n))
+		*err = n;
+	close(p[0]);
+	close(e[0]);
+	while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+		;
+	return status;
+}
+
+/* try one operation, returns 0 or the errno */
+static int
+try_op(const char *path, mode_t mode, int op)
+{
+	char buf[PATH_MAX + 32];
+	char *argv[] = { (char *)path, NULL };
+	int fd, err;
+
+	switch (op) {
+	case CM_READ:
+		fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY |
+			  (S_ISDIR(mode) ? O_DIRECTORY : 0));
+		break;
+	case CM_WRITE:
+		if (!S_ISDIR(mode)) {
+			fd = open(path, O_WRONLY | O_NONBLOCK | O_NOCTTY);
+			break;
+		}
+		snprintf(buf, sizeof(buf), "%s/.credmatrix.%d", path, getpid());
+		fd = open(buf, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		if (fd != -1)
+			unlink(buf);
+		break;
+	case CM_EXEC:
+		if (S_ISDIR(mode)) {
+			snprintf(buf, sizeof(buf), "%s/.", path);
+			fd = open(buf, O_PATH);
+			break;
+		}
+		run(argv, NULL, 0, &err);
+		return err;
+	default:
+		return EINVAL;
+	}
+	if (fd == -1)
+		return errno;
+	close(fd);
+	return 0;
+}
+
+/* a denial is EACCES or EPERM, anything else got past the checks */
+static void
+result(struct cm_result *res, int i, int err)
+{
+	res->err[i] = err;
+	if (err != EACCES && err != EPERM)
+		res->granted |= 1 << i;
+}
+
+static void
+worker(struct cm_cred *c, int sock)
+{
+	struct request req;
+	struct reply rep;
+	struct cm_result *res;
+	char *argv[CM_ARGS / 2 + 1], *p;
+	int i, j, op;
+
+	memset(&rep, 0, sizeof(rep));
+	rep.status = set_cred(c) == -1 ? errno : 0;
+	if (send(sock, &rep, sizeof(rep), 0) != sizeof(rep) || rep.status)
+		_exit(1);
+
+	while (recv(sock, &req, sizeof(req), 0) == sizeof(req)) {
+		memset(&rep, 0, sizeof(rep));
+		switch (req.type) {
+		case REQ_CHECK:
+			for (i = 0; i < CM_OPS; i++) {
+				op = 1 << i;
+				if (req.ops & op)
+					result(&rep.res, i,
+					       try_op(req.path, req.mode, op));
+			}
+			break;
+		case REQ_BATCH:
+			res = (struct cm_result *)rep.out;
+			for (j = 0; j < req.argc; j++) {
+				p = req.args + j * req.size;
+				for (i = 0; i < CM_OPS; i++) {
+					op = 1 << i;
+					if (req.ops & op)
+						result(&res[j], i, req.fn(p, op));
+				}
+			}
+			break;
+		case REQ_RUN:
+			for (i = 0, p = req.args; i < req.argc; i++) {
+				argv[i] = p;
+				p += strlen(p) + 1;
+			}
+			argv[i] = NULL;
+			rep.status = run(argv, rep.out, sizeof(rep.out),
+					 &rep.res.err[0]);
+			break;
+		default:
+			_exit(0);
+		}
+		if (send(sock, &rep, sizeof(rep), 0) != sizeof(rep))
+			_exit(1);
+	}
+	_exit(0);
+}
+
+void
+cm_std_creds(struct cm_cred *creds, uid_t uid, gid_t gid,
+	     uid_t uid_nobody, gid_t gid_nobody)
+{
+	memset(creds, 0, CM_NSTD * sizeof(*creds));
+	creds[0].name = "user";
+	creds[0].uid = uid;
+	creds[0].gid = gid;
+	creds[1].name = "nobody+group";
+	creds[1].uid = uid_nobody;
+	creds[1].gid = gid_nobody;
+	creds[1].ngroups = 1;
+	creds[1].groups[0] = gid;
+	creds[2].name = "root";
+	creds[2].caps = CM_ALLCAPS;
+	creds[3].name = "root-nocaps";
+}
+
+int
+cm_start(struct cm_cred *creds, int ncreds)
+{
+	struct reply rep;
+	int i, j, sv[2];
+
+	/* the workers must not flush what the caller has buffered */
+	fflush(NULL);
+	for (i = 0; i < ncreds; i++) {
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1)
+			goto fail;
+		creds[i].pid = fork();
+		if (creds[i].pid == 0) {
+			/* keep the other workers' sockets from staying open */
+			for (j = 0; j < i; j++)
+				close(creds[j].sock);
+			close(sv[0]);
+			worker(&creds[i], sv[1]);
+		}
+		close(sv[1]);
+		creds[i].sock = sv[0];
+		if (creds[i].pid == -1) {
+			close(sv[0]);
+			goto fail;
+		}
+		rep.status = 0;
+		if (xchg(creds[i].sock, NULL, &rep) == -1 || rep.status) {
+			if (rep.status)
+				errno = rep.status;
+			fprintf(stderr, "credmatrix: unable to switch to %s: %s\n",
+				creds[i].name, strerror(errno));
+			i++;
+			goto fail;
+		}
+	}
+	return 0;
+
+fail:
+	cm_stop(creds, i);
+	return -1;
+}
+
+void
+cm_stop(struct cm_cred *creds, int ncreds)
+{
+	struct request req = { .type = REQ_EXIT };
+	int i;
+
+	for (i = 0; i < ncreds; i++) {
+		if (creds[i].pid <= 0)
+			continue;
+		send(creds[i].sock, &req, sizeof(req), MSG_NOSIGNAL);
+		close(creds[i].sock);
+		waitpid(creds[i].pid, NULL, 0);
+		creds[i].pid = 0;
+	}
+}
+
+int
+cm_check(struct cm_cred *creds, int ncreds, const char *path, int ops,
+	 struct cm_result *res)
+{
+	struct request req = { .type = REQ_CHECK, .ops = ops };
+	struct reply rep;
+	struct stat st;
+	int i, rc = 0;
+
+	if (lstat(path, &st) == -1)
+		return -1;
+	req.mode = st.st_mode;
+	snprintf(req.path, sizeof(req.path), "%s", path);
+
+	/* all the workers at once, then the replies */
+	for (i = 0; i < ncreds; i++)
+		if (send(creds[i].sock, &req, sizeof(req), MSG_NOSIGNAL) !=
+		    sizeof(req))
+			return -1;
+	for (i = 0; i < ncreds; i++) {
+		if (xchg(creds[i].sock, NULL, &rep) == -1)
+			rc = -1;
+		else
+			res[i] = rep.res;
+	}
+	return rc;
+}
+
+int
+cm_check_batch(struct cm_cred *creds, int ncreds, cm_op_fn fn,
+	       const void *objs, size_t size, int nobjs, int ops,
+	       struct cm_result *res)
+{
+	struct request req = { .type = REQ_BATCH, .ops = ops, .fn = fn,
+			       .size = size };
+	struct reply rep;
+	int i, j, n, done, rc = 0;
+
+	if (!size || size > sizeof(req.args)) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (done = 0; done < nobjs; done += n) {
+		n = nobjs - done;
+		if (n > (int)(sizeof(req.args) / size))
+			n = sizeof(req.args) / size;
+		if (n > (int)CM_BATCH)
+			n = CM_BATCH;
+		req.argc = n;
+		memcpy(req.args, (const char *)objs + done * size, n * size);
+
+		for (i = 0; i < ncreds; i++)
+			if (send(creds[i].sock, &req, sizeof(req),
+				 MSG_NOSIGNAL) != sizeof(req))
+				return -1;
+		for (i = 0; i < ncreds; i++) {
+			if (xchg(creds[i].sock, NULL, &rep) == -1) {
+				rc = -1;
+				continue;
+			}
+			for (j = 0; j < n; j++)
+				res[(done + j) * ncreds + i] =
+					((struct cm_result *)rep.out)[j];
+		}
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+int
+cm_expect(const struct cm_cred *cred, const struct stat *st, int ops)
+{
+	mode_t mode = st->st_mode;
+	int i, bits, granted = 0, ingroup = cred->gid == st->st_gid;
+
+	for (i = 0; i < cred->ngroups; i++)
+		if (cred->groups[i] == st->st_gid)
+			ingroup = 1;
+
+	/* one class only, the owner bits even if the group ones allow more */
+	if (cred->uid == st->st_uid)
+		bits = (mode >> 6) & 7;
+	else if (ingroup)
+		bits = (mode >> 3) & 7;
+	else
+		bits = mode & 7;
+	if (bits & 4)
+		granted |= CM_READ;
+	if (bits & 2)
+		granted |= CM_WRITE;
+	if (bits & 1)
+		granted |= CM_EXEC;
+
+	if (cred->caps & CM_CAP(CAP_DAC_OVERRIDE)) {
+		granted |= CM_READ | CM_WRITE;
+		if (S_ISDIR(mode) || (mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+			granted |= CM_EXEC;
+	}
+	if (cred->caps & CM_CAP(CAP_DAC_READ_SEARCH)) {
+		granted |= CM_READ;
+		if (S_ISDIR(mode))
+			granted |= CM_EXEC;
+	}
+
+	/* only regular files execute, entries are added through a search */
+	if (!S_ISDIR(mode) && !S_ISREG(mode))
+		granted &= ~CM_EXEC;
+	if (S_ISDIR(mode) && !(granted & CM_EXEC))
+		granted &= ~CM_WRITE;
+
+	return granted & ops;
+}
+
+static void
+opstr(char *buf, int granted, int ops)
+{
+	static const char letter[CM_OPS] = { 'r', 'w', 'x' };
+	int i;
+
+	for (i = 0; i < CM_OPS; i++)
+		buf[i] = !(ops & (1 << i)) ? ' ' :
+			 (granted & (1 << i)) ? letter[i] : '-';
+	buf[i] = '\0';
+}
+
+int
+cm_report(struct cm_cred *creds, int ncreds, const char *path, int ops,
+	  const struct cm_result *res)
+{
+	struct stat st;
+	char got[CM_OPS + 1], exp[CM_OPS + 1];
+	int i, expected, failed = 0;
+
+	if (lstat(path, &st) == -1)
+		return -1;
+	cm_fileinfo(path);
+	for (i = 0; i < ncreds; i++) {
+		expected = cm_expect(&creds[i], &st, ops);
+		opstr(got, res[i].granted, ops);
+		opstr(exp, expected, ops);
+		printf("  %-12s actual: %s  expected: %s  %s\n", creds[i].name,
+		       got, exp,
+		       (res[i].granted & ops) == expected ? "PASS" : "FAIL");
+		if ((res[i].granted & ops) != expected)
+			failed++;
+	}
+	printf("\n");
+	return failed;
+}
+
+int
+cm_run(struct cm_cred *cred, char *const argv[], char *out, size_t len)
+{
+	struct request req = { .type = REQ_RUN };
+	struct reply rep;
+	size_t used = 0, n;
+
+	for (req.argc = 0; argv[req.argc]; req.argc++) {
+		n = strlen(argv[req.argc]) + 1;
+		if (used + n > sizeof(req.args) || req.argc >= CM_ARGS / 2) {
+			errno = E2BIG;
+			return -1;
+		}
+		memcpy(req.args + used, argv[req.argc], n);
+		used += n;
+	}
+	if (xchg(cred->sock, &req, &rep) == -1)
+		return -1;
+	if (rep.res.err[0]) {
+		errno = rep.res.err[0];
+		return -1;
+	}
+	snprintf(out, len, "%s", rep.out);
+	return rep.status;
+}
+
+void
+cm_fileinfo(const char *path)
+{
+	static const char rwx[] = "rwxrwxrwx";
+	struct stat st;
+	struct passwd *pw;
+	struct group *gr;
+	char mode[11], uname[16], gname[16];
+	int i;
+
+	if (lstat(path, &st) == -1) {
+		printf("%s: %s\n", path, strerror(errno));
+		return;
+	}
+	mode[0] = S_ISDIR(st.st_mode) ? 'd' : S_ISCHR(st.st_mode) ? 'c' :
+		  S_ISBLK(st.st_mode) ? 'b' : S_ISFIFO(st.st_mode) ? 'p' :
+		  S_ISLNK(st.st_mode) ? 'l' : S_ISSOCK(st.st_mode) ? 's' : '-';
+	for (i = 0; i < 9; i++)
+		mode[i + 1] = (st.st_mode & (0400 >> i)) ? rwx[i] : '-';
+	mode[10] = '\0';
+	if (st.st_mode & S_ISUID)
+		mode[3] = (st.st_mode & S_IXUSR) ? 's' : 'S';
+	if (st.st_mode & S_ISGID)
+		mode[6] = (st.st_mode & S_IXGRP) ? 's' : 'S';
+	if (st.st_mode & S_ISVTX)
+		mode[9] = (st.st_mode & S_IXOTH) ? 't' : 'T';
+
+	if ((pw = getpwuid(st.st_uid)))
+		snprintf(uname, sizeof(uname), "%s", pw->pw_name);
+	else
+		snprintf(uname, sizeof(uname), "%d", st.st_uid);
+	if ((gr = getgrgid(st.st_gid)))
+		snprintf(gname, sizeof(gname), "%s", gr->gr_name);
+	else
+		snprintf(gname, sizeof(gname), "%d", st.st_gid);
+
+	printf("%s %s %s %s\n", mode, uname, gname, path);
+}
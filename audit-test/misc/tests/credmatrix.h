@@ -0,0 +1,90 @@
+/* credmatrix.h - credential matrix access checks for the permission tests
+ *
+ * cm_start() forks one worker per credential (uid, gid, supplementary
+ * groups, capabilities); each worker switches to its credential once and
+ * then serves requests over a socket.  cm_check() has every worker try
+ * the requested operations on an object at the same time and collects a
+ * row of results per credential, cm_expect() computes the rows the DAC
+ * rules call for from the object's mode and owner, cm_report() prints
+ * both and counts the rows that differ.
+ *
+ * The operations are real: open() for reading and writing (O_NONBLOCK,
+ * a fifo without a reader counts as granted), execve() of files, and for
+ * directories a listing, a file created and removed in it, and a lookup
+ * through it.  An operation is denied when it fails with EACCES or EPERM.
+ *
+ * cm_check_batch() does the same for objects that are not files: the
+ * workers call fn (a function of the caller's, the workers are forks) for
+ * every operation on every object of the batch, the objects are copied to
+ * the workers in as few requests as fit.
+ *
+ * cm_std_creds() fills in the CM_NSTD credentials the file permission
+ * tests check: the test user, nobody with the test user's group as a
+ * supplementary group, and root with and without its capabilities.
+ *
+ * cm_run() runs a command as one of the credentials and returns its
+ * output, cm_fileinfo() prints the mode and owner of an object the way
+ * the tests did with ls -l.
+ */
+
+#ifndef _CREDMATRIX_H
+#define _CREDMATRIX_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define CM_READ		0x1
+#define CM_WRITE	0x2
+#define CM_EXEC		0x4	/* execute a file, search a directory */
+#define CM_OPS		3
+
+#define CM_MAXGROUPS	16
+
+/* capabilities the worker keeps, CM_ALLCAPS for a full root */
+#define CM_CAP(cap)	(1ULL << (cap))
+#define CM_ALLCAPS	(~0ULL)
+
+struct cm_cred {
+	const char *name;	/* row label */
+	uid_t uid;
+	gid_t gid;
+	int ngroups;
+	gid_t groups[CM_MAXGROUPS];
+	uint64_t caps;
+
+	/* the worker, set by cm_start() */
+	pid_t pid;
+	int sock;
+};
+
+struct cm_result {
+	int granted;		/* CM_* operations that succeeded */
+	int err[CM_OPS];	/* errno of the failed ones, by bit number */
+};
+
+#define CM_NSTD		4
+
+void cm_std_creds(struct cm_cred *creds, uid_t uid, gid_t gid,
+		  uid_t uid_nobody, gid_t gid_nobody);
+int cm_start(struct cm_cred *creds, int ncreds);
+void cm_stop(struct cm_cred *creds, int ncreds);
+
+int cm_check(struct cm_cred *creds, int ncreds, const char *path, int ops,
+	     struct cm_result *res);
+int cm_expect(const struct cm_cred *cred, const struct stat *st, int ops);
+
+/* one operation on an object, returns 0 or the errno */
+typedef int (*cm_op_fn)(const void *obj, int op);
+
+/* res holds nobjs rows of ncreds results */
+int cm_check_batch(struct cm_cred *creds, int ncreds, cm_op_fn fn,
+		   const void *objs, size_t size, int nobjs, int ops,
+		   struct cm_result *res);
+int cm_report(struct cm_cred *creds, int ncreds, const char *path, int ops,
+	      const struct cm_result *res);
+
+int cm_run(struct cm_cred *cred, char *const argv[], char *out, size_t len);
+void cm_fileinfo(const char *path);
+
+#endif /* _CREDMATRIX_H */
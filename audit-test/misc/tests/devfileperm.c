@@ -8,14 +8,17 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "credmatrix.h"
+
 mode_t user_access[]  = {S_IRUSR, S_IWUSR, 0};
 mode_t group_access[] = {S_IRGRP, S_IWGRP, 0};
 mode_t other_access[] = {S_IROTH, S_IWOTH, 0};
 
 static char* devfile = "/dev/devtestfile";
-static char* output   = "./output";
-static int   READ     = 0;
-static int   WRITE    = 1;
+static int   ops     = CM_READ | CM_WRITE;
+
+struct cm_cred creds[CM_NSTD];
+#define NCREDS CM_NSTD
 
 struct passwd *pw;
 struct group *gr;
@@ -26,94 +29,25 @@ gid_t gid;
 int g_rc  = 0;
 
 /*
- * This is a cheap way to display the file
- * permissions and owner information.
- */
-void fileinfo() {
-
-    int fd;
-    char readbuf[80];
-    char lscommand[80];
-
-    memset(readbuf, '\0', sizeof(readbuf));
-    memset(lscommand, '\0', sizeof(lscommand));
-
-    sprintf(lscommand, "ls -l %s >%s", devfile, output);
-    system(lscommand);
-
-    fd = open(output, O_RDONLY);
-    read(fd, readbuf, sizeof(readbuf));
-    printf(readbuf);
-    printf("\n");
-    close(fd);
-}
-
-/*
- * Perform read, write and execute checks.
+ * Perform read and write checks, execute is never granted on a device.
  */
 int access_check(mode_t access[]) {
 
     int i;
     int rc = 0;
-    int fd;
-    char result[80];
+    struct cm_result res[NCREDS];
 
     for (i = 0; i < 3; i++) {
         if ((rc = chmod(devfile, access[i])) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(gid)) == -1) {
-            goto EXIT;
-        }
-        if ((rc = seteuid(uid)) == -1) {
-            goto EXIT;
-        }
 
-        // Display current permission/owner info
-        fileinfo();
-
-        // Try open for read
-        fd = open(devfile, O_RDONLY);
-
-        if ((fd != -1 && access[i] == access[READ]) ||
-            (fd == -1 && access[i] != access[READ])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        if (fd != -1) {
-            if ((rc == close(fd)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        // Try open for write
-        fd = open(devfile, O_WRONLY);
-
-        if ((fd != -1 && access[i] == access[WRITE]) ||
-            (fd == -1 && access[i] != access[WRITE])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        if (fd != -1) {
-            if ((rc == close(fd)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        printf("\n");
-
-        // Reset uid/gid
-        if ((rc = seteuid(0)) == -1) {
+        // Try all the accesses with all the credentials at once
+        if ((rc = cm_check(creds, NCREDS, devfile, ops, res)) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(0)) == -1) {
-            goto EXIT;
+        if (cm_report(creds, NCREDS, devfile, ops, res) != 0) {
+	    g_rc = -1;
         }
     }
 
@@ -175,6 +109,11 @@ int main(int argc, char *argv[]) {
     }
     gid_nobody = gr->gr_gid;
 
+    cm_std_creds(creds, uid, gid, uid_nobody, gid_nobody);
+    if ((rc = cm_start(creds, NCREDS)) == -1) {
+        goto EXIT;
+    }
+
     /*
      * Create victim device file (major=1, minor=5).
      */
@@ -218,8 +157,8 @@ int main(int argc, char *argv[]) {
     rc = 0;
 
 EXIT:
+    cm_stop(creds, NCREDS);
     unlink(devfile);
-    unlink(output);
 
     /*
     ** The reason for 2 return codes:
@@ -3,12 +3,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
-#include <dirent.h>
 #include <pwd.h>
 #include <grp.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "credmatrix.h"
+
 /*
  * Directories must have "X" as well as "R" or "W" for access.
  */
@@ -16,13 +17,12 @@ mode_t user_access[]  = {S_IRUSR | S_IXUSR, S_IWUSR | S_IXUSR, S_IXUSR};
 mode_t group_access[] = {S_IRGRP | S_IXGRP, S_IWGRP | S_IXGRP, S_IXGRP};
 mode_t other_access[] = {S_IROTH | S_IXOTH, S_IWOTH | S_IXOTH, S_IXOTH};
 
-static char* filename  = "./dactestdir/dactestfile";
 static char* workdir   = "./workdir";
 static char* dirname   = "./dactestdir";
-static char* output    = "./output";
-static int   READ   = 0;
-static int   WRITE  = 1;
-static int   SEARCH = 2;
+static int   ops       = CM_READ | CM_WRITE | CM_EXEC;
+
+struct cm_cred creds[CM_NSTD];
+#define NCREDS CM_NSTD
 
 struct passwd *pw;
 struct group  *gr;
@@ -33,110 +33,25 @@ gid_t gid;
 int g_rc = 0;
 
 /*
- * This is a cheap way to display the file
- * permissions and owner information.
- */
-void dirinfo() {
-
-    int fd;
-    char readbuf[80];
-    char lscommand[80];
-
-    memset(readbuf, '\0', sizeof(readbuf));
-    memset(lscommand, '\0', sizeof(lscommand));
-
-    sprintf(lscommand, "ls -ld %s >%s", dirname, output);
-    system(lscommand);
-
-    fd = open(output, O_RDONLY);
-    read(fd, readbuf, sizeof(readbuf));
-    printf(readbuf);
-    printf("\n");
-    close(fd);
-    unlink(output);
-}
-
-/*
- * Perform read, write and execute checks.
+ * Perform read, write (create a file) and search checks.
  */
 int access_check(mode_t access[]) {
 
     int i;
     int rc = 0;
-    int fd;
-    char result[80];
-    DIR *dir;
+    struct cm_result res[NCREDS];
 
     for (i = 0; i < 3; i++) {
         if ((rc = chmod(dirname, access[i])) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(gid)) == -1) {
-            goto EXIT;
-        }
-        if ((rc = seteuid(uid)) == -1) {
-            goto EXIT;
-        }
-
-	memset(result, '\0', sizeof(result));
-
-        // Display current permission/owner info
-        dirinfo();
-
-        // Try read access
-        dir = opendir(dirname);
-
-        if ((dir != NULL && access[i] == access[READ]) ||
-            (dir == NULL && access[i] != access[READ])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        if (dir != NULL) {
-            if ((rc == closedir(dir)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        // Try write access
-        fd = creat(filename, O_WRONLY);
-
-        if ((fd != -1 && access[i] == access[WRITE]) ||
-            (fd == -1 && access[i] != access[WRITE])) {
-        } else {
-	    g_rc = -1;
-        }
 
-        printf(result);
-
-        if (fd != -1) {
-            if ((rc == unlink(filename)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        // Try cd
-	rc = chdir(dirname);
-
-        if ((rc != -1) || (rc == -1 && access[i] != access[SEARCH])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        printf("\n");
-
-	if (rc != -1) chdir("..");
-
-        // Reset uid/gid
-        if ((rc = seteuid(0)) == -1) {
+        // Try all the accesses with all the credentials at once
+        if ((rc = cm_check(creds, NCREDS, dirname, ops, res)) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(0)) == -1) {
-            goto EXIT;
+        if (cm_report(creds, NCREDS, dirname, ops, res) != 0) {
+	    g_rc = -1;
         }
     }
 
@@ -215,6 +130,11 @@ int main(int argc, char *argv[]) {
     }
     cd = 1;
 
+    cm_std_creds(creds, uid, gid, uid_nobody, gid_nobody);
+    if ((rc = cm_start(creds, NCREDS)) == -1) {
+        goto EXIT;
+    }
+
     /*
      * Create victim directory.
      */
@@ -259,6 +179,7 @@ int main(int argc, char *argv[]) {
 
 EXIT:
 
+    cm_stop(creds, NCREDS);
     rmdir(dirname);
     if (cd == 1) chdir("..");
     rmdir(workdir);
@@ -8,18 +8,18 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "credmatrix.h"
+
 mode_t user_access[]  = {S_IRUSR, S_IWUSR, S_IXUSR};
 mode_t group_access[] = {S_IRGRP, S_IWGRP, S_IXGRP};
 mode_t other_access[] = {S_IROTH, S_IWOTH, S_IXOTH};
 
 static char* filename = "./dactestfile";
-static char* output   = "./output";
-static char* execfile = "./dactestfile 2>/dev/null";
-static char* command  = "date >/dev/null\n";
-static int   access_error = 32256;
-static int   READ    = 0;
-static int   WRITE   = 1;
-static int   EXECUTE = 2;
+static int   ops      = CM_READ | CM_WRITE | CM_EXEC;
+static char* command  = "#!/bin/sh\ndate >/dev/null\n";
+
+struct cm_cred creds[CM_NSTD];
+#define NCREDS CM_NSTD
 
 struct passwd *pw;
 struct group *gr;
@@ -29,26 +29,6 @@ gid_t gid;
 
 int g_rc  = 0;
 
-/*
- * This is a cheap way to display the file
- * permissions and owner information.
- */
-void fileinfo() {
-
-    int fd;
-    char readbuf[80];
-    char lscommand[80];
-
-    sprintf(lscommand, "ls -l %s >%s", filename, output);
-    system(lscommand);
-
-    fd = open(output, O_RDONLY);
-    read(fd, readbuf, sizeof(readbuf));
-    printf(readbuf);
-    printf("\n");
-    close(fd);
-}
-
 /*
  * Perform read, write and execute checks.
  */
@@ -56,76 +36,19 @@ int access_check(mode_t access[]) {
 
     int i;
     int rc = 0;
-    int fd;
-    char result[80];
+    struct cm_result res[NCREDS];
 
     for (i = 0; i < 3; i++) {
         if ((rc = chmod(filename, access[i])) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(gid)) == -1) {
-            goto EXIT;
-        }
-        if ((rc = seteuid(uid)) == -1) {
-            goto EXIT;
-        }
-
-        // Display current permission/owner info
-        fileinfo();
-
-        // Try open for read
-        fd = open(filename, O_RDONLY);
-
-        if ((fd != -1 && access[i] == access[READ]) ||
-            (fd == -1 && access[i] != access[READ])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
 
-        if (fd != -1) {
-            if ((rc == close(fd)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        // Try open for write
-        fd = open(filename, O_WRONLY);
-
-        if ((fd != -1 && access[i] == access[WRITE]) ||
-            (fd == -1 && access[i] != access[WRITE])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        if (fd != -1) {
-            if ((rc == close(fd)) == -1) {
-                goto EXIT;
-            }
-        }
-
-        // Try execute
-        rc = system(execfile);
-
-        if ((rc != access_error && access[i] == access[EXECUTE]) ||
-            (rc == access_error && access[i] != access[EXECUTE])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        printf("\n");
-
-        // Reset uid/gid
-        if ((rc = seteuid(0)) == -1) {
+        // Try all the accesses with all the credentials at once
+        if ((rc = cm_check(creds, NCREDS, filename, ops, res)) == -1) {
             goto EXIT;
         }
-        if ((rc = setegid(0)) == -1) {
-            goto EXIT;
+        if (cm_report(creds, NCREDS, filename, ops, res) != 0) {
+	    g_rc = -1;
         }
     }
 
@@ -187,6 +110,11 @@ int main(int argc, char *argv[]) {
     }
     gid_nobody = gr->gr_gid;
 
+    cm_std_creds(creds, uid, gid, uid_nobody, gid_nobody);
+    if ((rc = cm_start(creds, NCREDS)) == -1) {
+        goto EXIT;
+    }
+
     /*
      * Create victim file containing the "date" command.
      */
@@ -194,10 +122,10 @@ int main(int argc, char *argv[]) {
         rc = fd;
         goto EXIT;
     }
-    if ((rc == write(fd, command, strlen(command))) == -1) {
+    if ((rc = write(fd, command, strlen(command))) == -1) {
         goto EXIT;
     }
-    if ((rc == close(fd)) == -1) {
+    if ((rc = close(fd)) == -1) {
         goto EXIT;
     }
 
@@ -237,8 +165,8 @@ int main(int argc, char *argv[]) {
     rc = 0;
 
 EXIT:
+    cm_stop(creds, NCREDS);
     unlink(filename);
-    unlink(output);
 
     /*
     ** The reason for 2 return codes:
@@ -0,0 +1,344 @@
+/* fswalk.c - parallel filesystem walker for the permission tests
+ *
+ * See fswalk.h.  A queued directory holds a reference on its parent, so the
+ * parent fd stays open until all its subdirectories have been opened with
+ * openat().  Workers take their own work depth first (LIFO), which keeps
+ * the number of open directories low, and steal breadth first (FIFO),
+ * which hands out the large subtrees.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#include "fswalk.h"
+
+#define DENTS_SIZE	32768
+
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct dir {
+	struct dir *parent;
+	int fd;
+	int refs;
+	char *path;
+	char *name;		/* within parent->path */
+};
+
+struct deque {
+	pthread_mutex_t lock;
+	struct dir **items;
+	size_t head, tail, size;	/* steal at head, push/pop at tail */
+};
+
+struct walk {
+	fswalk_fn fn;
+	void *arg;
+	int nthreads;
+	struct deque *deques;
+	int pending;		/* directories queued or being listed */
+	int stop;		/* callback return value */
+};
+
+struct worker {
+	struct walk *walk;
+	int id;
+};
+
+static void
+dir_put(struct dir *d)
+{
+	struct dir *parent;
+
+	while (d && __atomic_sub_fetch(&d->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		parent = d->parent;
+		if (d->fd >= 0)
+			close(d->fd);
+		free(d->path);
+		free(d);
+		d = parent;
+	}
+}
+
+static int
+deque_push(struct deque *q, struct dir *d)
+{
+	struct dir **items;
+	size_t n;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->tail == q->size) {
+		/* compact, or grow */
+		n = q->tail - q->head;
+		if (q->head > q->size / 2) {
+			memmove(q->items, q->items + q->head, n * sizeof(*items));
+		} else {
+			items = realloc(q->items, (q->size * 2 + 64) *
+					sizeof(*items));
+			if (!items) {
+				pthread_mutex_unlock(&q->lock);
+				return -1;
+			}
+			q->items = items;
+			q->size = q->size * 2 + 64;
+			memmove(q->items, q->items + q->head, n * sizeof(*items));
+		}
+		q->head = 0;
+		q->tail = n;
+	}
+	q->items[q->tail++] = d;
+	pthread_mutex_unlock(&q->lock);
+	return 0;
+}
+
+static struct dir *
+deque_take(struct deque *q, int steal)
+{
+	struct dir *d = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail)
+		d = steal ? q->items[q->head++] : q->items[--q->tail];
+	pthread_mutex_unlock(&q->lock);
+	return d;
+}
+
+static int
+queue_dir(struct walk *w, int id, struct dir *parent, const char *name)
+{
+	struct dir *d;
+	size_t plen = strlen(parent->path), nlen = strlen(name);
+
+	d = calloc(1, sizeof(*d));
+	if (!d || !(d->path = malloc(plen + nlen + 2))) {
+		free(d);
+		return -1;
+	}
+	memcpy(d->path, parent->path, plen);
+	d->path[plen] = '/';
+	memcpy(d->path + plen + 1, name, nlen + 1);
+	d->name = d->path + plen + 1;
+	d->parent = parent;
+	d->fd = -1;
+	d->refs = 1;
+	__atomic_add_fetch(&parent->refs, 1, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&w->pending, 1, __ATOMIC_RELAXED);
+	if (deque_push(&w->deques[id], d) < 0) {
+		__atomic_sub_fetch(&w->pending, 1, __ATOMIC_RELAXED);
+		dir_put(d);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+set_stop(struct walk *w, int rc)
+{
+	int zero = 0;
+
+	__atomic_compare_exchange_n(&w->stop, &zero, rc, 0,
+				    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/* report an entry, returns non-zero to stop */
+static int
+report(struct walk *w, struct fswalk_ent *ent)
+{
+	int rc = w->fn(ent, w->arg);
+
+	if (rc)
+		set_stop(w, rc);
+	return rc;
+}
+
+/* list one directory, queueing its subdirectories */
+static void
+list_dir(struct walk *w, int id, struct dir *d)
+{
+	char buf[DENTS_SIZE];
+	struct linux_dirent64 *de;
+	struct fswalk_ent ent;
+	long n, pos;
+
+	d->fd = openat(d->parent ? d->parent->fd : AT_FDCWD,
+		       d->parent ? d->name : d->path,
+		       O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	/* the parent fd is not needed anymore */
+	if (d->parent) {
+		dir_put(d->parent);
+		d->parent = NULL;
+	}
+	if (d->fd < 0) {
+		memset(&ent, 0, sizeof(ent));
+		ent.dirfd = AT_FDCWD;
+		ent.name = ent.path = d->path;
+		ent.st.st_mode = S_IFDIR;
+		ent.err = errno;
+		report(w, &ent);
+		return;
+	}
+
+	while (!w->stop &&
+	       (n = syscall(SYS_getdents64, d->fd, buf, sizeof(buf))) > 0) {
+		for (pos = 0; pos < n && !w->stop; pos += de->d_reclen) {
+			de = (struct linux_dirent64 *)(buf + pos);
+			if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+				continue;
+
+			/* no need to stat what is known to be a directory */
+			if (de->d_type == DT_DIR) {
+				if (queue_dir(w, id, d, de->d_name) < 0)
+					set_stop(w, -1);
+				continue;
+			}
+
+			memset(&ent, 0, sizeof(ent));
+			ent.dirfd = d->fd;
+			ent.name = de->d_name;
+			if (fstatat(d->fd, de->d_name, &ent.st,
+				    AT_SYMLINK_NOFOLLOW) < 0)
+				ent.err = errno;
+			else if (S_ISDIR(ent.st.st_mode)) {
+				if (queue_dir(w, id, d, de->d_name) < 0)
+					set_stop(w, -1);
+				continue;
+			}
+
+			/* the full path only for what gets reported */
+			{
+				size_t plen = strlen(d->path);
+				char path[plen + strlen(de->d_name) + 2];
+
+				memcpy(path, d->path, plen);
+				path[plen] = '/';
+				strcpy(path + plen + 1, de->d_name);
+				ent.path = path;
+				report(w, &ent);
+			}
+		}
+	}
+}
+
+static void *
+worker(void *arg)
+{
+	struct worker *me = arg;
+	struct walk *w = me->walk;
+	struct dir *d;
+	int i, idle = 0;
+
+	while (!w->stop) {
+		d = deque_take(&w->deques[me->id], 0);
+		for (i = 1; !d && i < w->nthreads; i++)
+			d = deque_take(&w->deques[(me->id + i) % w->nthreads], 1);
+
+		if (!d) {
+			if (__atomic_load_n(&w->pending, __ATOMIC_ACQUIRE) == 0)
+				break;
+			/* others are still listing, their work is to come */
+			if (++idle < 100)
+				sched_yield();
+			else
+				usleep(100);
+			continue;
+		}
+		idle = 0;
+
+		list_dir(w, me->id, d);
+		dir_put(d);
+		__atomic_sub_fetch(&w->pending, 1, __ATOMIC_ACQ_REL);
+	}
+
+	/* drop what is left after a stop */
+	while ((d = deque_take(&w->deques[me->id], 0)))
+		dir_put(d);
+	return NULL;
+}
+
+int
+fswalk(const char *root, int nthreads, fswalk_fn fn, void *arg)
+{
+	struct walk w = { .fn = fn, .arg = arg };
+	struct fswalk_ent ent;
+	struct worker *workers;
+	pthread_t *threads;
+	struct dir *d;
+	struct rlimit rlim;
+	int i;
+
+	memset(&ent, 0, sizeof(ent));
+	ent.dirfd = AT_FDCWD;
+	ent.name = ent.path = root;
+	if (stat(root, &ent.st) < 0) {
+		ent.err = errno;
+		return fn(&ent, arg);
+	}
+	if (!S_ISDIR(ent.st.st_mode))
+		return fn(&ent, arg);
+
+	/* room for the open directories */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+	    rlim.rlim_cur < rlim.rlim_max) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+
+	if (nthreads < 1)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads < 1)
+		nthreads = 1;
+	w.nthreads = nthreads;
+	w.deques = calloc(nthreads, sizeof(*w.deques));
+	workers = calloc(nthreads, sizeof(*workers));
+	threads = calloc(nthreads, sizeof(*threads));
+	d = calloc(1, sizeof(*d));
+	if (!w.deques || !workers || !threads || !d || !(d->path = strdup(root)))
+		return -1;
+	for (i = 0; i < nthreads; i++)
+		pthread_mutex_init(&w.deques[i].lock, NULL);
+
+	d->fd = -1;
+	d->refs = 1;
+	w.pending = 1;
+	deque_push(&w.deques[0], d);
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].walk = &w;
+		workers[i].id = i;
+		if (i > 0 && pthread_create(&threads[i], NULL, worker,
+					    &workers[i]) != 0) {
+			set_stop(&w, -1);
+			nthreads = i;
+			break;
+		}
+	}
+	worker(&workers[0]);
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i < w.nthreads; i++) {
+		while ((d = deque_take(&w.deques[i], 0)))
+			dir_put(d);
+		pthread_mutex_destroy(&w.deques[i].lock);
+		free(w.deques[i].items);
+	}
+	free(w.deques);
+	free(workers);
+	free(threads);
+	return w.stop;
+}
@@ -0,0 +1,39 @@
+/* fswalk.h - parallel filesystem walker for the permission tests
+ *
+ * fswalk() walks the tree under root with nthreads worker threads (0 for
+ * one per CPU).  Directories are listed with getdents64(), unsorted, and
+ * their entries examined with fstatat() relative to the directory fd; every
+ * directory found is queued on the deque of the worker that found it, idle
+ * workers steal from the other deques.
+ *
+ * The callback is called from the worker threads, concurrently, for every
+ * entry that is not a directory (symlinks included, they are not
+ * followed), for a root that is not a directory, and for the directories
+ * that could not be opened (with err set).  A non-zero return stops the
+ * walk, fswalk() then returns it.
+ *
+ * Credentials: glibc's seteuid() and friends change all the threads of the
+ * process, a callback checking access as another user should switch the
+ * calling thread only, with setfsuid() / setfsgid() or the raw setresuid /
+ * setresgid syscalls (what /proc/sys checks).
+ */
+
+#ifndef _FSWALK_H
+#define _FSWALK_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+struct fswalk_ent {
+	int dirfd;		/* directory of the entry, for the *at() calls */
+	const char *name;	/* name relative to dirfd */
+	const char *path;	/* full path */
+	struct stat st;		/* lstat() of the entry, stat() for the root */
+	int err;		/* errno of a failed stat or open, else 0 */
+};
+
+typedef int (*fswalk_fn)(const struct fswalk_ent *ent, void *arg);
+
+int fswalk(const char *root, int nthreads, fswalk_fn fn, void *arg);
+
+#endif /* _FSWALK_H */
@@ -0,0 +1,401 @@
+/* =======================================================================
+ *   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of version 2 the GNU General Public License as
+ *   published by the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ *
+ * ipcperm: SysV IPC permission checks
+ *
+ * One message queue, semaphore set and shared memory segment is created
+ * (as the creator user) for every combination of the read and write bits
+ * of the owner, group and other classes, owned by the test user and the
+ * creator's group.  Every object is then accessed by a set of credentials
+ * at once (see credmatrix.h), each from its own worker process:
+ *
+ *   owner        the test user
+ *   creator      the creator, who has the owner rights too (cuid)
+ *   group        nobody, with the creator's group as a supplementary group
+ *   other        nobody
+ *   root         with all its capabilities (CAP_IPC_OWNER)
+ *   root-nocaps  without any, which makes it an other
+ *
+ * The operations are real: msgrcv() / msgsnd(), a wait-for-zero semop() /
+ * an increment and decrement, shmat() read-only / read-write (which takes
+ * the read permission too), all of them non-blocking; only EACCES and EPERM
+ * count as denied.
+ *
+ * The output is a table, one line per object with what each credential
+ * got (actual:expected where they differ) and PASS or FAIL, then a summary
+ * line.  The exit status is 0 if all the objects passed, 1 if any failed
+ * and 2 on errors.  With -n, everything is done in a new IPC namespace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <linux/capability.h>
+
+#include "credmatrix.h"
+
+enum type { T_MSG, T_SEM, T_SHM, T_MAX };
+
+static const char *type_names[T_MAX] = { "msg", "sem", "shm" };
+
+/* what the workers get, copied */
+struct obj {
+    int type;
+    int id;
+    mode_t mode;
+};
+
+union semun {
+    int val;
+    struct semid_ds *buf;
+    unsigned short *array;
+};
+
+static struct cm_cred creds[] = {
+    { .name = "owner" },
+    { .name = "creator" },
+    { .name = "group", .ngroups = 1 },
+    { .name = "other" },
+    { .name = "root", .caps = CM_ALLCAPS },
+    { .name = "root-nocaps" },
+};
+#define NCREDS (sizeof(creds) / sizeof(creds[0]))
+
+/* the read and write bits of all three classes */
+#define NMODES 64
+
+static struct obj objs[T_MAX * NMODES];
+static int nobjs;
+static uid_t owner_uid, creator_uid;
+static gid_t group_gid;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n] <user> <creator> [msg|sem|shm]...\n"
+            "\n"
+            "  -n  run in a new IPC namespace\n"
+            "\n"
+            "Checks every read/write mode of each IPC object type (all by\n"
+            "default) with several credentials, see the source.\n", prog);
+}
+
+static mode_t nth_mode(int n)
+{
+    /* bits 0-5 of n: ug rw, then the other rw */
+    return ((n & 3) << 7) | (((n >> 2) & 3) << 4) | (((n >> 4) & 3) << 1);
+}
+
+/* create an object as the creator, hand it over to the owner */
+static int create_obj(struct obj *o)
+{
+    struct ipc_perm *perm;
+    struct msqid_ds msq;
+    struct semid_ds sem;
+    struct shmid_ds shm;
+    union semun arg = { .buf = &sem };
+    int rc = -1;
+
+    o->id = -1;
+    if (setegid(group_gid) == -1 || seteuid(creator_uid) == -1)
+        return -1;
+    switch (o->type) {
+    case T_MSG:
+        o->id = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+        break;
+    case T_SEM:
+        o->id = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600);
+        break;
+    case T_SHM:
+        o->id = shmget(IPC_PRIVATE, getpagesize(), IPC_CREAT | 0600);
+        break;
+    }
+    if (seteuid(0) == -1 || setegid(0) == -1 || o->id == -1)
+        return -1;
+
+    switch (o->type) {
+    case T_MSG:
+        perm = &msq.msg_perm;
+        rc = msgctl(o->id, IPC_STAT, &msq);
+        break;
+    case T_SEM:
+        perm = &sem.sem_perm;
+        rc = semctl(o->id, 0, IPC_STAT, arg);
+        break;
+    case T_SHM:
+        perm = &shm.shm_perm;
+        rc = shmctl(o->id, IPC_STAT, &shm);
+        break;
+    }
+    if (rc == -1)
+        return -1;
+    perm->uid = owner_uid;
+    perm->gid = group_gid;
+    perm->mode = o->mode;
+    switch (o->type) {
+    case T_MSG: return msgctl(o->id, IPC_SET, &msq);
+    case T_SEM: return semctl(o->id, 0, IPC_SET, arg);
+    case T_SHM: return shmctl(o->id, IPC_SET, &shm);
+    }
+    return -1;
+}
+
+static void remove_objs(void)
+{
+    int i;
+
+    for (i = 0; i < nobjs; i++) {
+        if (objs[i].id == -1)
+            continue;
+        switch (objs[i].type) {
+        case T_MSG: msgctl(objs[i].id, IPC_RMID, NULL); break;
+        case T_SEM: semctl(objs[i].id, 0, IPC_RMID); break;
+        case T_SHM: shmctl(objs[i].id, IPC_RMID, NULL); break;
+        }
+    }
+}
+
+/* run in the workers: one operation, 0 or the errno */
+static int ipc_op(const void *arg, int op)
+{
+    const struct obj *o = arg;
+    struct { long mtype; char mtext[8]; } msg = { 1, "x" };
+    struct sembuf sops[2] = {
+        { 0, 1, IPC_NOWAIT | SEM_UNDO }, { 0, -1, IPC_NOWAIT | SEM_UNDO }
+    };
+    struct sembuf zero = { 0, 0, IPC_NOWAIT };
+    void *addr;
+    int rc = -1;
+
+    switch (o->type) {
+    case T_MSG:
+        if (op == CM_READ)
+            rc = msgrcv(o->id, &msg, sizeof(msg.mtext), 0,
+                        IPC_NOWAIT | MSG_NOERROR);
+        else
+            rc = msgsnd(o->id, &msg, 1, IPC_NOWAIT);
+        break;
+    case T_SEM:
+        /* waiting for zero needs read, altering write permission */
+        if (op == CM_READ)
+            rc = semop(o->id, &zero, 1);
+        else
+            rc = semop(o->id, sops, 2);
+        break;
+    case T_SHM:
+        addr = shmat(o->id, NULL, op == CM_READ ? SHM_RDONLY : 0);
+        if (addr != (void *)-1)
+            rc = shmdt(addr);
+        break;
+    }
+    return rc == -1 ? errno : 0;
+}
+
+/* the ipcperms() rules, owner or creator, then group, then other */
+static int expect(const struct cm_cred *c, const struct obj *o)
+{
+    int i, bits, ingroup = c->gid == group_gid;
+
+    if (c->caps & CM_CAP(CAP_IPC_OWNER))
+        return CM_READ | CM_WRITE;
+
+    for (i = 0; i < c->ngroups; i++)
+        if (c->groups[i] == group_gid)
+            ingroup = 1;
+    if (c->uid == owner_uid || c->uid == creator_uid)
+        bits = o->mode >> 6;
+    else if (ingroup)
+        bits = o->mode >> 3;
+    else
+        bits = o->mode;
+    /* a read-write shmat() needs both */
+    if (o->type == T_SHM && !(bits & 4))
+        bits &= ~2;
+    return ((bits & 4) ? CM_READ : 0) | ((bits & 2) ? CM_WRITE : 0);
+}
+
+static void opstr(char *buf, int granted)
+{
+    buf[0] = (granted & CM_READ) ? 'r' : '-';
+    buf[1] = (granted & CM_WRITE) ? 'w' : '-';
+    buf[2] = '\0';
+}
+
+/* one line per object, returns the number of failed objects */
+static int report(const struct cm_result *res)
+{
+    static const char rw[] = "rwxrwxrwx";
+    char mode[10], got[3], exp[3], cell[8];
+    int i, j, expected, failed = 0, bad;
+
+    printf("%-4s %-10s %-9s", "type", "id", "mode");
+    for (j = 0; j < (int)NCREDS; j++)
+        printf(" %-11s", creds[j].name);
+    printf("\n");
+
+    for (i = 0; i < nobjs; i++) {
+        for (j = 0; j < 9; j++)
+            mode[j] = (objs[i].mode & (0400 >> j)) ? rw[j] : '-';
+        mode[9] = '\0';
+        printf("%-4s %-10d %-9s", type_names[objs[i].type], objs[i].id,
+               mode);
+
+        bad = 0;
+        for (j = 0; j < (int)NCREDS; j++) {
+            expected = expect(&creds[j], &objs[i]);
+            opstr(got, res[i * NCREDS + j].granted);
+            if (res[i * NCREDS + j].granted == expected) {
+                printf(" %-11s", got);
+                continue;
+            }
+            opstr(exp, expected);
+            snprintf(cell, sizeof(cell), "%s:%s", got, exp);
+            printf(" %-11s", cell);
+            bad = 1;
+        }
+        printf(" %s\n", bad ? "FAIL" : "PASS");
+        failed += bad;
+    }
+    return failed;
+}
+
+static int lookup(const char *user, uid_t *uid, gid_t *gid)
+{
+    struct passwd *pw = getpwnam(user);
+
+    if (!pw) {
+        fprintf(stderr, "unknown user: %s\n", user);
+        return -1;
+    }
+    *uid = pw->pw_uid;
+    *gid = pw->pw_gid;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int types[T_MAX] = { 0 };
+    int opt, i, t, m, failed, newns = 0;
+    uid_t nobody_uid;
+    gid_t owner_gid, creator_gid, nobody_gid;
+    struct group *gr;
+    struct cm_result *res;
+    struct timespec start, stop;
+
+    while ((opt = getopt(argc, argv, "nh")) != -1) {
+        switch (opt) {
+        case 'n': newns = 1; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    for (i = optind + 2; i < argc; i++) {
+        for (t = 0; t < T_MAX; t++)
+            if (!strcmp(argv[i], type_names[t]))
+                break;
+        if (t == T_MAX) {
+            usage(argv[0]);
+            return 2;
+        }
+        types[t] = 1;
+    }
+    if (optind + 2 == argc)
+        for (t = 0; t < T_MAX; t++)
+            types[t] = 1;
+
+    if (lookup(argv[optind], &owner_uid, &owner_gid) == -1 ||
+        lookup(argv[optind + 1], &creator_uid, &creator_gid) == -1 ||
+        lookup("nobody", &nobody_uid, &nobody_gid) == -1)
+        return 2;
+    if ((gr = getgrnam("nobody")))
+        nobody_gid = gr->gr_gid;
+    group_gid = creator_gid;
+
+    creds[0].uid = owner_uid;
+    creds[0].gid = owner_gid;
+    creds[1].uid = creator_uid;
+    creds[1].gid = creator_gid;
+    creds[2].uid = nobody_uid;
+    creds[2].gid = nobody_gid;
+    creds[2].groups[0] = group_gid;
+    creds[3].uid = nobody_uid;
+    creds[3].gid = nobody_gid;
+
+    printf("owner: %s, creator: %s, group: %d%s\n\n", argv[optind],
+           argv[optind + 1], group_gid, newns ? ", new IPC namespace" : "");
+
+    /* the workers are forked into the namespace too */
+    if (newns && unshare(CLONE_NEWIPC) == -1) {
+        perror("unshare(CLONE_NEWIPC)");
+        return 2;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t = 0; t < T_MAX; t++) {
+        if (!types[t])
+            continue;
+        for (m = 0; m < NMODES; m++) {
+            objs[nobjs].type = t;
+            objs[nobjs].mode = nth_mode(m);
+            if (create_obj(&objs[nobjs++]) == -1) {
+                fprintf(stderr, "unable to create %s object with mode "
+                        "%03o: %s\n", type_names[t], nth_mode(m),
+                        strerror(errno));
+                remove_objs();
+                return 2;
+            }
+        }
+    }
+
+    res = calloc(nobjs * NCREDS, sizeof(*res));
+    if (!res || cm_start(creds, NCREDS) == -1) {
+        remove_objs();
+        return 2;
+    }
+    if (cm_check_batch(creds, NCREDS, ipc_op, objs, sizeof(*objs), nobjs,
+                       CM_READ | CM_WRITE, res) == -1) {
+        perror("cm_check_batch");
+        cm_stop(creds, NCREDS);
+        remove_objs();
+        return 2;
+    }
+    cm_stop(creds, NCREDS);
+    remove_objs();
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    failed = report(res);
+    printf("\nobjects=%d checks=%d mismatched=%d elapsed_ms=%ld\n",
+           nobjs, nobjs * (int)NCREDS * 2, failed,
+           (stop.tv_sec - start.tv_sec) * 1000 +
+           (stop.tv_nsec - start.tv_nsec) / 1000000);
+    free(res);
+    return failed ? 1 : 0;
+}
@@ -5,19 +5,20 @@
 #include <stdio.h>
 #include <pwd.h>
 #include <grp.h>
-#include <pthread.h>
-#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "credmatrix.h"
+
 mode_t user_access[]  = {S_IRUSR, S_IWUSR};
 mode_t group_access[] = {S_IRGRP, S_IWGRP};
 mode_t other_access[] = {S_IROTH, S_IWOTH};
 
 static char* fifoname = "./dactestfifo";
-static char* output   = "./output";
-static int   READ    = 0;
-static int   WRITE   = 1;
+static int   ops      = CM_READ | CM_WRITE;
+
+struct cm_cred creds[CM_NSTD];
+#define NCREDS CM_NSTD
 
 struct passwd *pw;
 struct group *gr;
@@ -27,145 +28,33 @@ gid_t gid;
 
 int g_rc  = 0;
 
-pthread_mutex_t pt_mutex;
-pthread_cond_t pt_cond;
-
-void open_fifo(void *name) {
-  int fd;
-  int rc;
-  char readbuff[10];
-
-  fd = open((char *)name, O_RDWR);
-  if (fd > 0) {
-      if ((rc = pthread_cond_signal(&pt_cond)) != 0)
-          pthread_exit(NULL);
-      read(fd, readbuff, sizeof(readbuff));
-      close(fd);
-  } else
-      pthread_exit(NULL);
-  pthread_exit(NULL);
-}
-
-/*
- * This is a cheap way to display the file
- * permissions and owner information.
- */
-void fifoinfo() {
-
-    int fd;
-    char readbuf[80];
-    char lscommand[80];
-
-    memset(readbuf, '\0', sizeof(readbuf));
-    memset(lscommand, '\0', sizeof(lscommand));
-
-    sprintf(lscommand, "ls -l %s >%s", fifoname, output);
-    system(lscommand);
-
-    fd = open(output, O_RDONLY);
-    if (fd >= 0) {
-      read(fd, readbuf, sizeof(readbuf));
-      printf(readbuf);
-      printf("\n");
-      close(fd);
-    }
-}
-
 /*
- * Perform read, write and execute checks.
+ * Perform read and write checks.
+ *
+ * The opens do not block, a write open without a reader fails with
+ * ENXIO only once access has been granted.
  */
 int access_check(mode_t access[]) {
 
     int i;
     int rc = 0;
-    int fd;
-    char result[80];
-    pthread_t open_thread;
-    struct timespec timeout;
-
-    // Spawn a new thread to listen on the other end of the fifo and wait
-    // for 5 seconds for the thread to open the fifo before running the tests
-    pthread_mutex_lock(&pt_mutex);
-    if (clock_gettime(CLOCK_REALTIME, &timeout) < 0) {
-        rc = -1;
-	goto EXIT;
-    }
-    timeout.tv_sec += 5;
-    rc = pthread_create(&open_thread, NULL, (void*)&open_fifo, (void*)fifoname);
-    if (rc != 0) {
-	pthread_mutex_unlock(&pt_mutex);
-        goto EXIT;
-    }
-    rc = pthread_cond_timedwait(&pt_cond, &pt_mutex, &timeout);
-    pthread_mutex_unlock(&pt_mutex);
-    if (rc != 0) {
-        goto EXIT;
-    }
+    struct cm_result res[NCREDS];
 
     for (i = 0; i < 2; i++) {
         if ((rc = chmod(fifoname, access[i])) < 0) {
             goto EXIT;
         }
 
-        if ((rc = setegid(gid)) < 0) {
+        // Try all the accesses with all the credentials at once
+        if ((rc = cm_check(creds, NCREDS, fifoname, ops, res)) < 0) {
             goto EXIT;
         }
-        if ((rc = seteuid(uid)) < 0) {
-            goto EXIT;
-        }
-
-        // Display current permission/owner info
-        fifoinfo();
-
-        // Try open for read
-        fd = open(fifoname, O_RDONLY);
-
-        if ((fd >= 0 && access[i] == access[READ]) ||
-            (fd < 0 && access[i] != access[READ])) {
-        } else {
+        if (cm_report(creds, NCREDS, fifoname, ops, res) != 0) {
 	    g_rc = -1;
         }
-
-        printf(result);
-
-        if (fd >= 0) {
-            if ((rc == close(fd)) < 0) {
-                goto EXIT;
-            }
-        }
-
-        // Try open for write
-        fd = open(fifoname, O_WRONLY);
-
-        if ((fd >= 0 && access[i] == access[WRITE]) ||
-            (fd < 0 && access[i] != access[WRITE])) {
-        } else {
-	    g_rc = -1;
-        }
-
-        printf(result);
-
-        if (fd >= 0) {
-            if ((rc == close(fd)) < 0) {
-                goto EXIT;
-            }
-        }
-
-        printf("\n");
-
-        // Reset uid/gid
-        if ((rc = seteuid(0)) < 0) {
-            goto EXIT;
-        }
-        if ((rc = setegid(0)) < 0) {
-            goto EXIT;
-        }
     }
 
-    // Open FIFO and send exit message.
-    fd = open(fifoname, O_RDWR);
-    write(fd, "Exit\n\n", 6);
-    close(fd);
+    rc = 0;
 
 EXIT:
 
@@ -186,18 +75,6 @@ int main(int argc, char *argv[]) {
         goto EXIT;
     }
 
-    /*
-     * pthread setup
-     */
-    if ((rc = pthread_mutex_init(&pt_mutex, NULL)) != 0) {
-      printf("Failed to initialize pthread mutex.");
-      goto EXIT;
-    }
-    if ((rc = pthread_cond_init(&pt_cond, NULL)) != 0) {
-      printf("Failed to initialize pthread condition variable.");
-      goto EXIT;
-    }
-
     /*
      * Get test user uid/gid.
      */
@@ -234,6 +111,11 @@ int main(int argc, char *argv[]) {
     }
     gid_nobody = gr->gr_gid;
 
+    cm_std_creds(creds, uid, gid, uid_nobody, gid_nobody);
+    if ((rc = cm_start(creds, NCREDS)) < 0) {
+        goto EXIT;
+    }
+
     /*
      * Create victim FIFO.
      */
@@ -274,8 +156,8 @@ int main(int argc, char *argv[]) {
     rc = 0;
 
 EXIT:
+    cm_stop(creds, NCREDS);
     unlink(fifoname);
-    unlink(output);
 
     /*
     ** The reason for 2 return codes:
@@ -22,15 +22,12 @@
 #include <stdarg.h>
 
 #include "testmacros.h"
+#include "zerocheck.h"
 
 void
 verify_zeroes(char *buf, int size)
 {
-	int j;
-
-	for (j=0; j<size; j++) {
-		DIE_IF(buf[j] != 0);
-	}
+	DIE_UNLESS_ZERO(buf, size);
 }
 
 int
@@ -30,24 +30,14 @@
 #include <stdarg.h>
 
 #include "testmacros.h"
+#include "zerocheck.h"
 
 void
 verify_zeroes(int fd, int size)
 {
-	int j;
-
-	SYSCALL( lseek(fd, 0, SEEK_SET) );
-
-	for (j=0; j<size; j++) {
-		unsigned char c = 1;
-		int r;
-
-		SYSCALL( r=read(fd, &c, 1) );
-
-		/* If ftruncate can't extend files, we get EOF,
-		 * otherwise the returned character must be NUL */
-		DIE_IF( r > 0 && c != 0);
-	}
+	/* If ftruncate can't extend files, we get EOF,
+	 * otherwise the returned bytes must be NUL */
+	DIE_UNLESS_ZERO_FD(fd, size);
 }
 
 int
@@ -28,20 +28,16 @@
 #include <stdarg.h>
 
 #include "testmacros.h"
+#include "zerocheck.h"
 
 void
 verify_zeroes(int fd, int size)
 {
-	int j;
+	struct stat st;
 
-	SYSCALL( lseek(fd, 0, SEEK_SET) );
-
-	for (j=0; j<size; j++) {
-		unsigned char c = 1;
-
-		SYSCALL( read(fd, &c, 1) );
-		DIE_IF(c != 0);
-	}
+	SYSCALL( fstat(fd, &st) );
+	DIE_UNLESS(st.st_size == size);
+	DIE_UNLESS_ZERO_FD(fd, size);
 }
 
 int
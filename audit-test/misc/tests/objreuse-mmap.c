@@ -26,16 +26,13 @@
 #include <sys/stat.h>
 
 #include "testmacros.h"
+#include "zerocheck.h"
 
 #define FILENAME "mmapfile"
 
 void verify_zeroes(char *buf, int size)
 {
-	int j;
-
-	for (j=0; j<size; j++) {
-		DIE_IF(buf[j] != 0);
-	}
+	DIE_UNLESS_ZERO(buf, size);
 }
 
 int main(int argc, char *argv[])
@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "testmacros.h"
+#include "zerocheck.h"
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 #ifndef PAGE_SIZE
@@ -41,11 +42,7 @@ static char* shmmaxfile = "/proc/sys/kernel/shmmax";
 
 void verify_zeroes(char *buf, int size)
 {
-	int j;
-
-	for (j=0; j<size; j++) {
-		DIE_IF(buf[j] != 0);
-	}
+	DIE_UNLESS_ZERO(buf, size);
 
 	return;
 }
@@ -0,0 +1,464 @@
+/* objreuse-stress.c - objects must be zeroed under concurrent allocation
+ *
+ * Purpose: verify that the object reuse mechanism works as documented
+ *	when many objects of different kinds are allocated and released at
+ *	the same time, so that the kernel hands out memory and blocks that
+ *	were just released by another process or thread.
+ *
+ * Method: -p processes (or just this one) with -t threads each allocate
+ *	objects of random sizes (log-uniform up to -m) for -d seconds,
+ *	verify that each one contains only zeroes and fill it with a
+ *	pattern before releasing it.  Any pattern left over shows up as
+ *	a non-zero byte in some later allocation.  The object kinds (-k,
+ *	comma separated) are:
+ *
+ *	mmap     anonymous private mapping
+ *	thp      anonymous mapping, 2 MiB aligned, madvise(MADV_HUGEPAGE)
+ *	hugetlb  MAP_HUGETLB mapping, skipped if no huge pages are reserved
+ *	memfd    memfd_create() file, extended with ftruncate() and mapped
+ *	shm      SysV shared memory segment
+ *	file     unlinked file in -D, extended with ftruncate() and read back
+ *	sem      SysV semaphore set of random size, the values must be zero
+ *
+ *	Objects which cannot be allocated (limits, no huge pages) are
+ *	counted as skipped.  A summary line per kind is printed at the end,
+ *	followed by the totals and the bytes verified per second.
+ *
+ * Expected result: exit code 0 indicates that all tests worked as
+ *	expected, each object with a non-zero byte is reported as a FAIL
+ *	line and the exit code is then 1.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "testmacros.h"
+#include "zerocheck.h"
+
+#define HUGE_SIZE	(2UL << 20)
+#define SEM_MAX		250
+#define PATTERN		0xa5
+#define SEM_PATTERN	0x2a5a	/* must not exceed SEMVMX */
+#define FILEBUF		(1 << 20)
+
+enum kind { K_MMAP, K_THP, K_HUGETLB, K_MEMFD, K_SHM, K_FILE, K_SEM, K_MAX };
+
+static const char *kind_names[K_MAX] = {
+	"mmap", "thp", "hugetlb", "memfd", "shm", "file", "sem"
+};
+
+struct stats {
+	unsigned long long allocs;
+	unsigned long long bytes;
+	unsigned long long residue;
+	unsigned long long skipped;
+};
+
+union semun {
+	int val;
+	struct semid_ds *buf;
+	unsigned short *array;
+};
+
+/* one worker = one thread, it has its own slot in the shared results */
+struct worker {
+	int id;
+	struct stats *stats;	/* [K_MAX] */
+};
+
+static int kinds[K_MAX];
+static int nkinds;
+static size_t max_size = 16UL << 20;
+static const char *dir = "/tmp";
+static unsigned int seed;
+static struct timespec deadline;
+
+/* log-uniform size in [1, max], small sizes are as likely as large ones */
+static size_t rand_size(unsigned int *rs, size_t max)
+{
+	unsigned int bits = 0;
+	size_t size;
+
+	while ((2UL << bits) <= max)
+		bits++;
+	size = 1UL << (rand_r(rs) % (bits + 1));
+	size += rand_r(rs) % size;
+	return size > max ? max : size;
+}
+
+static void report(struct stats *st, int kind, size_t size, size_t off)
+{
+	st->residue++;
+	printf("FAIL: residue kind=%s size=%zu offset=%zu\n",
+	       kind_names[kind], size, off);
+	fflush(stdout);
+}
+
+/* check and dirty a mapping */
+static void verify_zeroes(struct stats *st, int kind, void *mem, size_t size)
+{
+	size_t off = zero_span(mem, size);
+
+	if (off < size)
+		report(st, kind, size, off);
+	memset(mem, PATTERN, size);
+	st->allocs++;
+	st->bytes += size;
+}
+
+/* same for a file, its contents are checked with pread() */
+static int verify_zeroes_fd(struct stats *st, int fd, size_t size)
+{
+	off_t span, got;
+
+	span = zero_span_fd(fd, 0, size, &got);
+	if (span < 0 || got != size)
+		return -1;
+	if (span < got)
+		report(st, K_FILE, size, span);
+	st->allocs++;
+	st->bytes += size;
+	return 0;
+}
+
+static void test_mmap(struct stats *st, int kind, size_t size)
+{
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	size_t len = size;
+	char *mem, *aligned;
+
+	switch (kind) {
+	case K_HUGETLB:
+		size = len = (size + HUGE_SIZE - 1) & ~(HUGE_SIZE - 1);
+		flags |= MAP_HUGETLB;
+		break;
+	case K_THP:
+		size = (size + HUGE_SIZE - 1) & ~(HUGE_SIZE - 1);
+		len = size + HUGE_SIZE;
+		break;
+	}
+
+	mem = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (mem == MAP_FAILED) {
+		st->skipped++;
+		return;
+	}
+	aligned = mem;
+	if (kind == K_THP) {
+		aligned = (char *)(((unsigned long)mem + HUGE_SIZE - 1) &
+				   ~(HUGE_SIZE - 1));
+		madvise(aligned, size, MADV_HUGEPAGE);
+	}
+	verify_zeroes(st, kind, aligned, size);
+	munmap(mem, len);
+}
+
+static void test_memfd(struct stats *st, size_t size)
+{
+	void *mem;
+	int fd;
+
+	fd = memfd_create("objreuse-stress", MFD_CLOEXEC);
+	if (fd < 0) {
+		st->skipped++;
+		return;
+	}
+	if (ftruncate(fd, size) < 0 ||
+	    (mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0)) == MAP_FAILED) {
+		st->skipped++;
+	} else {
+		verify_zeroes(st, K_MEMFD, mem, size);
+		munmap(mem, size);
+	}
+	close(fd);
+}
+
+static void test_shm(struct stats *st, size_t size)
+{
+	void *mem;
+	int id;
+
+	/* fails over shmmax */
+	id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if (id < 0) {
+		st->skipped++;
+		return;
+	}
+	mem = shmat(id, NULL, 0);
+	shmctl(id, IPC_RMID, NULL);
+	if (mem == (void *)-1) {
+		st->skipped++;
+		return;
+	}
+	verify_zeroes(st, K_SHM, mem, size);
+	shmdt(mem);
+}
+
+/* extend, check, dirty, shrink, extend and check again */
+static void test_file(struct stats *st, size_t size)
+{
+	static __thread char *buf;
+	char path[4096];
+	size_t off, len;
+	int fd;
+
+	if (!buf) {
+		buf = malloc(FILEBUF);
+		DIE_IF(buf == NULL);
+		memset(buf, PATTERN, FILEBUF);
+	}
+
+	snprintf(path, sizeof(path), "%s/objreuse-stress.XXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd < 0) {
+		st->skipped++;
+		return;
+	}
+	unlink(path);
+
+	if (ftruncate(fd, size) < 0 || verify_zeroes_fd(st, fd, size) < 0)
+		goto skip;
+	for (off = 0; off < size; off += len) {
+		len = size - off < FILEBUF ? size - off : FILEBUF;
+		if (pwrite(fd, buf, len, off) < 0)
+			goto skip;
+	}
+	if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0 ||
+	    verify_zeroes_fd(st, fd, size) < 0)
+		goto skip;
+	close(fd);
+	return;
+
+skip:
+	st->skipped++;
+	close(fd);
+}
+
+static void test_sem(struct stats *st, unsigned int *rs)
+{
+	unsigned short vals[SEM_MAX];
+	union semun arg = { .array = vals };
+	int nsems = 1 + rand_r(rs) % SEM_MAX;
+	int id, i;
+
+	id = semget(IPC_PRIVATE, nsems, IPC_CREAT | 0600);
+	if (id < 0) {
+		st->skipped++;
+		return;
+	}
+	for (i = 0; i < SEM_MAX; i++)
+		vals[i] = SEM_PATTERN;
+	if (semctl(id, 0, GETALL, arg) < 0) {
+		st->skipped++;
+	} else {
+		for (i = 0; i < nsems && vals[i] == 0; i++)
+			;
+		if (i < nsems)
+			report(st, K_SEM, nsems, i);
+		/* dirty it for the next set */
+		for (i = 0; i < nsems; i++)
+			vals[i] = SEM_PATTERN;
+		SYSCALL( semctl(id, 0, SETALL, arg) );
+		st->allocs++;
+		st->bytes += nsems * sizeof(vals[0]);
+	}
+	semctl(id, 0, IPC_RMID);
+}
+
+static int expired(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec > deadline.tv_sec ||
+	       (now.tv_sec == deadline.tv_sec &&
+		now.tv_nsec >= deadline.tv_nsec);
+}
+
+static void *run_worker(void *arg)
+{
+	struct worker *w = arg;
+	unsigned int rs = seed + w->id;
+	struct stats *st;
+	size_t size;
+	int kind;
+
+	while (!expired()) {
+		kind = kinds[rand_r(&rs) % nkinds];
+		st = &w->stats[kind];
+		size = rand_size(&rs, max_size);
+		switch (kind) {
+		case K_MMAP:
+		case K_THP:
+		case K_HUGETLB:	test_mmap(st, kind, size); break;
+		case K_MEMFD:	test_memfd(st, size); break;
+		case K_SHM:	test_shm(st, size); break;
+		case K_FILE:	test_file(st, size); break;
+		case K_SEM:	test_sem(st, &rs); break;
+		}
+	}
+	return NULL;
+}
+
+/* run workers first .. first+n-1 as threads of this process */
+static void run_threads(struct stats *results, int first, int n)
+{
+	struct worker *w;
+	pthread_t *threads;
+	int i;
+
+	w = calloc(n, sizeof(*w));
+	threads = calloc(n, sizeof(*threads));
+	DIE_IF(w == NULL || threads == NULL);
+
+	for (i = 0; i < n; i++) {
+		w[i].id = first + i;
+		w[i].stats = &results[(first + i) * K_MAX];
+		if ((errno = pthread_create(&threads[i], NULL, run_worker,
+					    &w[i]))) {
+			_MSGN; perror("pthread_create");
+			exit(1);
+		}
+	}
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	free(w);
+}
+
+static void parse_kinds(char *list)
+{
+	char *tok;
+	int i;
+
+	for (tok = strtok(list, ","); tok && nkinds < K_MAX;
+	     tok = strtok(NULL, ",")) {
+		for (i = 0; i < K_MAX && strcmp(kind_names[i], tok); i++)
+			;
+		if (i == K_MAX) {
+			fprintf(stderr, "unsupported object kind: %s\n", tok);
+			exit(2);
+		}
+		kinds[nkinds++] = i;
+	}
+}
+
+static size_t parse_size(const char *arg)
+{
+	char *end;
+	size_t size = strtoull(arg, &end, 0);
+
+	switch (*end) {
+	case 'g': case 'G': size <<= 10; /* fall through */
+	case 'm': case 'M': size <<= 10; /* fall through */
+	case 'k': case 'K': size <<= 10; break;
+	}
+	return size;
+}
+
+int main(int argc, char *argv[])
+{
+	int nthreads = 1, nprocs = 0, duration = 10;
+	char all[] = "mmap,thp,hugetlb,memfd,shm,file,sem";
+	struct stats *results, tot[K_MAX], sum;
+	int nworkers, status, opt, i, k;
+	struct timespec start, stop;
+	double secs;
+	pid_t pid;
+
+	seed = time(NULL);
+	while ((opt = getopt(argc, argv, "t:p:d:m:k:D:s:")) != -1) {
+		switch (opt) {
+		case 't': nthreads = atoi(optarg); break;
+		case 'p': nprocs = atoi(optarg); break;
+		case 'd': duration = atoi(optarg); break;
+		case 'm': max_size = parse_size(optarg); break;
+		case 'k': parse_kinds(optarg); break;
+		case 'D': dir = optarg; break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-p procs] "
+				"[-d seconds] [-m max_size] [-k kind,...] "
+				"[-D dir] [-s seed]\n", argv[0]);
+			exit(2);
+		}
+	}
+	if (!nkinds)
+		parse_kinds(all);
+	DIE_IF(nthreads < 1 || nprocs < 0 || duration < 1 || max_size < 1);
+
+	/* the results of all workers, shared with the forked processes */
+	nworkers = nthreads * (nprocs ? nprocs : 1);
+	results = mmap(NULL, nworkers * K_MAX * sizeof(*results),
+		       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+		       -1, 0);
+	DIE_IF(results == MAP_FAILED);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	deadline = start;
+	deadline.tv_sec += duration;
+	if (!nprocs)
+		run_threads(results, 0, nthreads);
+	for (i = 0; i < nprocs; i++) {
+		SYSCALL( pid = fork() );
+		if (pid == 0) {
+			run_threads(results, i * nthreads, nthreads);
+			exit(0);
+		}
+	}
+	for (i = 0; i < nprocs; i++) {
+		SYSCALL( wait(&status) );
+		DIE_UNLESS(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	secs = (stop.tv_sec - start.tv_sec) +
+	       (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+	memset(tot, 0, sizeof(tot));
+	memset(&sum, 0, sizeof(sum));
+	for (i = 0; i < nworkers * K_MAX; i++) {
+		k = i % K_MAX;
+		tot[k].allocs += results[i].allocs;
+		tot[k].bytes += results[i].bytes;
+		tot[k].residue += results[i].residue;
+		tot[k].skipped += results[i].skipped;
+	}
+	for (i = 0; i < nkinds; i++) {
+		k = kinds[i];
+		printf("kind=%s allocs=%llu bytes=%llu residue=%llu "
+		       "skipped=%llu\n", kind_names[k], tot[k].allocs,
+		       tot[k].bytes, tot[k].residue, tot[k].skipped);
+		sum.allocs += tot[k].allocs;
+		sum.bytes += tot[k].bytes;
+		sum.residue += tot[k].residue;
+		sum.skipped += tot[k].skipped;
+	}
+	printf("workers=%d seed=%u duration=%.3f\n", nworkers, seed, secs);
+	printf("allocs=%llu bytes=%llu bytes_per_sec=%.0f residue=%llu "
+	       "skipped=%llu\n", sum.allocs, sum.bytes, sum.bytes / secs,
+	       sum.residue, sum.skipped);
+
+	if (sum.residue) {
+		printf("%s: FAIL\n", __FILE__);
+		return 1;
+	}
+	printf("%s: PASS\n", __FILE__);
+	return 0;
+}
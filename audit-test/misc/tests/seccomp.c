@@ -31,6 +31,12 @@
  * command line arguments then select the syscall, tested syscall action,
  * ruleset type (rule arrangement / options) and precedence type
  *
+ * with "bench" as the first argument, the tester instead measures the cost
+ * of a filter of a given size and layout (see bench_usage() below), printing
+ * a single key=value line, ie. "rules=256 layout=tree log=0 threads=4
+ * calls=123456 ns_per_call=85 calls_per_sec=..."; it exits with 3 if the
+ * libseccomp it was built with cannot build the requested filter
+ *
  */
 
 #include <stdio.h>
@@ -41,10 +47,13 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <seccomp.h>
 
 #include <unistd.h>
+#include <sys/syscall.h>
 
 
 /*
@@ -204,6 +213,180 @@ bool open_success(struct syscall_info *si)
 }
 
 
+/*
+ * filter cost benchmark
+ */
+
+/* the benchmarked syscall, cheap and with nothing to set up */
+#define BENCH_SYSCALL     SYS_getppid
+/* argument values of the filler rules, never used by anything */
+#define BENCH_MAGIC       0x5eccb000
+
+/* libseccomp 2.4 added SCMP_ACT_LOG, 2.5 the binary tree layout */
+#if defined(SCMP_VER_MAJOR) && \
+    (SCMP_VER_MAJOR > 2 || (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 4))
+#define HAVE_SCMP_ACT_LOG
+#endif
+#if defined(SCMP_VER_MAJOR) && \
+    (SCMP_VER_MAJOR > 2 || (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 5))
+#define HAVE_SCMP_OPTIMIZE
+#endif
+
+volatile int bench_stop = 0;
+
+struct bench_thread {
+    pthread_t thread;
+    unsigned long long calls;
+};
+
+void bench_usage(char *prog)
+{
+    fprintf(stderr,
+            "usage: %s bench [-n rules] [-l layout] [-L] [-t threads] [-d seconds]\n"
+            "\n"
+            "  -n rules    filler rules in the filter (0), each matching an\n"
+            "              argument value of another syscall, never used\n"
+            "  -l layout   none (no filter loaded at all), linear (default)\n"
+            "              or tree (binary tree of syscalls, libseccomp 2.5)\n"
+            "  -L          log the benchmarked syscall (SCMP_ACT_LOG)\n"
+            "  -t threads  threads calling the syscall (1)\n"
+            "  -d seconds  duration (5)\n"
+            , prog);
+}
+
+/* add nrules filler rules, spread over all the syscalls known to
+ * libseccomp except the benchmarked one, so that the filter has to walk
+ * past them (the linear layout) or down the tree to get to its action */
+int bench_fill(scmp_filter_ctx ctx, int nrules)
+{
+    int nr, added = 0, progress;
+    char *name;
+
+    while (added < nrules) {
+        progress = 0;
+        for (nr = 0; nr < 1024 && added < nrules; nr++) {
+            if (nr == BENCH_SYSCALL)
+                continue;
+            name = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, nr);
+            if (!name)
+                continue;
+            free(name);
+            /* multiplexed or otherwise special syscalls may be refused */
+            if (seccomp_rule_add(ctx, SCMP_ACT_ERRNO(TESTING_SCERRNO), nr, 1,
+                                 SCMP_CMP(0, SCMP_CMP_EQ,
+                                          BENCH_MAGIC + added)) < 0)
+                continue;
+            added++;
+            progress = 1;
+        }
+        if (!progress)
+            return -1;
+    }
+    return 0;
+}
+
+void *bench_thread(void *arg)
+{
+    struct bench_thread *bt = arg;
+    unsigned long long calls = 0;
+    int i;
+
+    while (!bench_stop) {
+        for (i = 0; i < 1024; i++)
+            syscall(BENCH_SYSCALL);
+        calls += 1024;
+    }
+    bt->calls = calls;
+    return NULL;
+}
+
+int bench(int argc, char **argv)
+{
+    int nrules = 0, nthreads = 1, duration = 5, log = 0, opt, i;
+    const char *layout = "linear";
+    scmp_filter_ctx ctx;
+    struct bench_thread *threads;
+    struct timespec start, stop;
+    unsigned long long calls = 0, ns;
+
+    /* argv[1] is "bench" */
+    optind = 2;
+    while ((opt = getopt(argc, argv, "n:l:Lt:d:")) != -1) {
+        switch (opt) {
+        case 'n': nrules = atoi(optarg); break;
+        case 'l': layout = optarg; break;
+        case 'L': log = 1; break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'd': duration = atoi(optarg); break;
+        default:
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nrules < 0 || nthreads < 1 || duration < 1 ||
+        (strcmp(layout, "none") && strcmp(layout, "linear") &&
+         strcmp(layout, "tree"))) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(layout, "none")) {
+        ctx = seccomp_init(SCMP_ACT_ALLOW);
+        if (ctx == NULL)
+            return 1;
+        if (!strcmp(layout, "tree")) {
+#ifdef HAVE_SCMP_OPTIMIZE
+            if (seccomp_attr_set(ctx, SCMP_FLTATR_CTL_OPTIMIZE, 2) < 0)
+                return 3;
+#else
+            return 3;
+#endif
+        }
+        if (bench_fill(ctx, nrules) < 0)
+            return 1;
+        if (log) {
+#ifdef HAVE_SCMP_ACT_LOG
+            if (seccomp_rule_add(ctx, SCMP_ACT_LOG, BENCH_SYSCALL, 0) < 0)
+                return 3;
+#else
+            return 3;
+#endif
+        }
+        if (seccomp_load(ctx) < 0)
+            return 1;
+        seccomp_release(ctx);
+    }
+
+    /* the threads inherit the filter */
+    threads = calloc(nthreads, sizeof(*threads));
+    if (!threads)
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < nthreads; i++)
+        if (pthread_create(&threads[i].thread, NULL, bench_thread,
+                           &threads[i]) != 0)
+            return 1;
+    sleep(duration);
+    bench_stop = 1;
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        calls += threads[i].calls;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    /* per call, as seen by one thread */
+    ns = (stop.tv_sec - start.tv_sec) * 1000000000ULL +
+         stop.tv_nsec - start.tv_nsec;
+    printf("rules=%d layout=%s log=%d threads=%d calls=%llu "
+           "ns_per_call=%llu calls_per_sec=%llu\n",
+           nrules, layout, log, nthreads, calls,
+           calls ? ns * nthreads / calls : 0,
+           calls * 1000000000ULL / ns);
+    free(threads);
+    return 0;
+}
+
+
 /*
  * main
  */
@@ -215,6 +398,9 @@ int main(int argc, char **argv)
 
     struct syscall_info sinfo = { 0 };
 
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return bench(argc, argv);
+
     if (argc < 6) {
         fprintf(stderr,
                 "usage: %s <syscall> <action> <ruleset> <arg> <precedence>\n"
@@ -241,7 +427,9 @@ int main(int argc, char **argv)
                 "  x-before-trap        - testing rule added before a TRAP rule\n"
                 "  x-after-kill         - testing rule added after a KILL rule\n"
                 "  x-before-kill        - testing rule added before a KILL rule\n"
-                , argv[0]);
+                "\n"
+                "or: %s bench [options], see \"%s bench -h\"\n"
+                , argv[0], argv[0], argv[0]);
         exit(1);
     }
 
@@ -14,60 +14,209 @@
  * /dev/shm -> tmpfs
  * /boot -> vfat (on Itanium)
  *
+ * usage: sparse_file [-f] [-s <hole size>[k|m|g]] <path> [<path>...]
+ *
+ * The hole is checked segment by segment as SEEK_DATA / SEEK_HOLE report
+ * them, the FIEMAP extents are shown where supported.  Every segment with
+ * blocks behind it (written zeroes or unwritten extents - where residual
+ * data could show) is read back completely in large chunks, the real holes
+ * one page per MiB, or completely as well with -f.  All of it must be zero.
  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
+#include "zerocheck.h"
 
 #define DATA_BEGIN "Blafasel"
 #define DATA_END "Faselbla"
 #define SEEK 10000000
 
-#define RESULT '\0'
+#define FIEMAP_EXTENTS 256
+#define HOLE_PAGE 4096
+#define HOLE_STRIDE (1 << 20)
 
-int test(char *);
+int test(char *, off_t, int);
 
 int main(int argc, char **argv) {
     const char *filename = "/sparse_file";
-    char *path;
-	int ret=0;
+    char *path, *end;
+    off_t hole = SEEK - sizeof(DATA_BEGIN);
+    int opt, i, ret = 0, rc, full = 0;
 
-    if(argc != 2) {
+    while ((opt = getopt(argc, argv, "fs:")) != -1) {
+        switch (opt) {
+        case 'f':
+            full = 1;
+            break;
+        case 's':
+            hole = strtoll(optarg, &end, 0);
+            switch (*end) {
+            case 'g': case 'G': hole <<= 10; /* fall through */
+            case 'm': case 'M': hole <<= 10; /* fall through */
+            case 'k': case 'K': hole <<= 10; break;
+            }
+            if (hole <= 0) {
+                fprintf(stderr, "Invalid hole size %s\n", optarg);
+                exit(1);
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-f] [-s <hole size>] <path>...\n",
+                    argv[0]);
+            exit(1);
+        }
+    }
+    if(optind >= argc) {
         fprintf(stderr, "No test path given as argument!\n");
         exit(1);
     }
 
-    path = malloc(sizeof(char)*(strlen(argv[1])+strlen(filename))+1);
-    strcpy(path, argv[1]);
-    strcat(path, filename);
-    ret = test(path);
-    free(path);
-
-	if(ret) {
-        return ret;
+    for (i = optind; i < argc; i++) {
+        path = malloc(sizeof(char)*(strlen(argv[i])+strlen(filename))+1);
+        strcpy(path, argv[i]);
+        strcat(path, filename);
+        rc = test(path, hole, full);
+        free(path);
+        if (rc)
+            ret = rc;
     }
 
-    return 0;
+    return ret;
+}
+
+/* zero check [lo, hi), returns the first non-zero offset, hi if none */
+off_t scan(int fd, off_t lo, off_t hi) {
+	off_t span, got;
+
+	span = zero_span_fd(fd, lo, hi - lo, &got);
+	if (span == -1)
+		return -1;
+	if (got != hi - lo) {
+		errno = EIO;	/* short read within the file */
+		return -1;
+	}
+	return lo + span;
+}
+
+/*
+ * Check the hole [start, end) segment by segment: what SEEK_DATA finds as
+ * data (allocated blocks, where residual data could show) is read
+ * completely, the real holes one page every HOLE_STRIDE unless full is set.
+ * Returns the offset of the first non-zero byte, end if none, -1 on errors.
+ */
+off_t check_hole(int fd, off_t start, off_t end, int full) {
+	off_t pos = start, data, hole, off, lim, at;
+
+	if (lseek(fd, start, SEEK_HOLE) == -1) {
+		printf("layout: SEEK_HOLE not supported: %s\n", strerror(errno));
+		return scan(fd, start, end);
+	}
+	while (pos < end) {
+		data = lseek(fd, pos, SEEK_DATA);
+		if (data == -1 || data > end)
+			data = end;	/* ENXIO, a hole up to the end */
+		if (data > pos) {
+			printf("layout: hole %lld..%lld\n",
+			       (long long)pos, (long long)data);
+			for (off = pos; off < data; off += HOLE_STRIDE) {
+				lim = (full || data - off < HOLE_PAGE) ?
+				      data : off + HOLE_PAGE;
+				at = scan(fd, off, lim);
+				if (at != lim)
+					return at;
+				if (full)
+					break;
+			}
+			/* and the very end of it */
+			if (!full && data - pos > HOLE_PAGE) {
+				at = scan(fd, data - HOLE_PAGE, data);
+				if (at != data)
+					return at;
+			}
+		}
+		if (data >= end)
+			break;
+		hole = lseek(fd, data, SEEK_HOLE);
+		if (hole == -1 || hole > end)
+			hole = end;
+		printf("layout: data %lld..%lld\n",
+		       (long long)data, (long long)hole);
+		at = scan(fd, data, hole);
+		if (at != hole)
+			return at;
+		pos = hole;
+	}
+	return end;
 }
 
-int test(char *file) {
+/* print the extents FIEMAP finds in the hole */
+void show_extents(int fd, off_t start, off_t end) {
+	struct fiemap *fm;
+	struct fiemap_extent *fe;
+	unsigned int i, extents = 0;
+	unsigned long long alloc = 0, lo, hi;
+	__u64 pos = 0;
+	int last = 0;
+
+	fm = malloc(sizeof(*fm) + FIEMAP_EXTENTS * sizeof(*fe));
+	if (!fm)
+		return;
+	while (!last) {
+		memset(fm, 0, sizeof(*fm));
+		fm->fm_start = pos;
+		fm->fm_length = FIEMAP_MAX_OFFSET - pos;
+		fm->fm_flags = FIEMAP_FLAG_SYNC;
+		fm->fm_extent_count = FIEMAP_EXTENTS;
+		if (ioctl(fd, FS_IOC_FIEMAP, fm) == -1) {
+			printf("fiemap: not supported: %s\n", strerror(errno));
+			free(fm);
+			return;
+		}
+		if (fm->fm_mapped_extents == 0)
+			break;
+		for (i = 0; i < fm->fm_mapped_extents; i++) {
+			fe = &fm->fm_extents[i];
+			extents++;
+			/* the part of the extent within the hole */
+			lo = fe->fe_logical > start ? fe->fe_logical : start;
+			hi = fe->fe_logical + fe->fe_length;
+			if (hi > end)
+				hi = end;
+			if (hi > lo)
+				alloc += hi - lo;
+			if (fe->fe_flags & FIEMAP_EXTENT_LAST)
+				last = 1;
+			pos = fe->fe_logical + fe->fe_length;
+		}
+	}
+	printf("fiemap: %u extents, %llu bytes allocated in the hole\n",
+	       extents, alloc);
+	free(fm);
+}
+
+int test(char *file, off_t hole, int full) {
 	int fd;
-	long ret, i;
+	long ret;
+	off_t seek = sizeof(DATA_BEGIN) + hole;
+	off_t at;
 	char buf1[sizeof(DATA_BEGIN)];
 	char buf2[sizeof(DATA_END)];
-	char buf3[1];
     extern int errno;
 
 	snprintf(buf1, sizeof(DATA_BEGIN), DATA_BEGIN);
 	snprintf(buf2, sizeof(DATA_END), DATA_END);
 
-	printf("Testing file %s\n", file);
+	printf("Testing file %s, hole of %lld bytes\n", file, (long long)hole);
 
 	unlink(file);
 
@@ -81,20 +230,22 @@ int test(char *file) {
 		printf("write begin failed: %s\n", strerror(errno));
 		return 3;
 	}
-	ret = lseek(fd, SEEK, SEEK_SET);
+	ret = lseek(fd, seek, SEEK_SET);
 	if(ret == -1) {
 		printf("lseek failed: %s\n", strerror(errno));
-		return 2;
+		return (errno == EFBIG || errno == EINVAL) ? 9 : 2;
 	}
 	ret = write(fd, buf2, sizeof(buf2));
 	if(ret == -1) {
-		printf("write end failed\n");
-		return 4;
+		printf("write end failed: %s\n", strerror(errno));
+		unlink(file);
+		/* the file would be larger than the filesystem allows */
+		return (errno == EFBIG || errno == EINVAL) ? 9 : 4;
 	}
+	/* read it back from the filesystem, not from the page cache */
+	fsync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
 	close(fd);
-	sync();
-	sync();
-	sync();
 
 	/******************/
 
@@ -102,28 +253,36 @@ int test(char *file) {
 	ret = read(fd, buf1, sizeof(buf1));
 	if(ret == -1) {
 		printf("read begin failed\n");
+		unlink(file);
 		return 5;
 	}
 
-	for (i=sizeof(DATA_BEGIN); i<SEEK; i++) {
-		ret = lseek(fd, i, SEEK_SET);
-		if(ret == -1) {
-			printf("lseek failed\n");
-			return 6;
-		}
-		ret = read(fd, buf3, 1);
-		if(ret != 1) {
-			printf("read in lseek failed: %ld\n", ret);
-			return 7;
-		}
-		if(buf3[0] != RESULT) {
-			printf("data %i does not mach expected result\n", buf3[0]);
-			return -1;
-		}
+	show_extents(fd, sizeof(DATA_BEGIN), seek);
+
+	/* the hole must read back as zeroes */
+	at = check_hole(fd, sizeof(DATA_BEGIN), seek, full);
+	if(at == -1) {
+		printf("read in hole failed: %s\n", strerror(errno));
+		unlink(file);
+		return 7;
+	}
+	if(at < seek) {
+		printf("data at %lld does not mach expected result\n",
+		       (long long)at);
+		close(fd);
+		unlink(file);
+		return -1;
+	}
+	ret = lseek(fd, seek, SEEK_SET);
+	if(ret == -1) {
+		printf("lseek failed\n");
+		unlink(file);
+		return 6;
 	}
 	ret = read(fd, buf2, sizeof(buf2));
 	if(ret != sizeof(buf2)) {
 		printf("read begin failed\n");
+		unlink(file);
 		return 8;
 	}
 	if(!(strncmp(buf2, DATA_BEGIN, sizeof(buf2)) && strncmp(buf2, DATA_END, sizeof(buf2)))) {
@@ -7,34 +7,66 @@
 #include <grp.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
+
+#include "credmatrix.h"
 
 static char* filename = "./id";
-static char* output   = "/tmp/output";
+
+/*
+ * The credentials ./id is run with, filled in by main()
+ */
+struct cm_cred creds[] = {
+    { .name = "root", .caps = CM_ALLCAPS },
+    { .name = "nobody" },
+};
+
 struct passwd *pw;
 struct group *gr;
 
 int g_rc  = 0;
 
 /*
- * This is a cheap way to display the file
- * permissions and owner information.
+ * Copy the id program, preserving nothing but the content.
  */
-void fileinfo() {
+int copy_file(const char *from, const char *to) {
 
-    int fd;
-    char readbuf[80];
-    char lscommand[80];
+    int in, out;
+    int rc = -1;
+    struct stat st;
 
-    memset(readbuf, '\0', sizeof(readbuf));
-    sprintf(lscommand, "ls -l %s >%s", filename, output);
-    system(lscommand);
+    if ((in = open(from, O_RDONLY)) == -1) {
+        return (-1);
+    }
+    if ((out = open(to, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU)) == -1) {
+        close(in);
+        return (-1);
+    }
+    if (fstat(in, &st) == 0 &&
+        sendfile(out, in, NULL, st.st_size) == st.st_size) {
+        rc = 0;
+    }
+    close(in);
+    close(out);
 
-    fd = open(output, O_RDONLY);
-    read(fd, readbuf, sizeof(readbuf));
-    printf(readbuf);
-    printf("\n");
-    close(fd);
-    unlink(output);
+    return (rc);
+}
+
+/*
+ * Run ./id with the given option as root or nobody, the first line of
+ * its output goes to result.
+ */
+int run_id(char *option, int nobody, char *result, size_t len) {
+
+    int rc;
+    char *argv[] = { (char *)filename, option, NULL };
+
+    if ((rc = cm_run(&creds[nobody ? 1 : 0], argv, result, len)) == -1) {
+        return (rc);
+    }
+    result[strcspn(result, "\n")] = '\0';
+
+    return (0);
 }
 
 /*
@@ -43,7 +75,6 @@ void fileinfo() {
 int check_id(mode_t mode, char *uname, char *gname, int nobody) {
 
     int rc = 0;
-    int fd;
     char result[20];
 
 
@@ -51,31 +82,15 @@ int check_id(mode_t mode, char *uname, char *gname, int nobody) {
         goto EXIT;
     }
 
-    fileinfo();
+    cm_fileinfo(filename);
 
     /*
      * Check effective user
      */
-    if (nobody) {
-        if ((rc = system("su -s /bin/bash -c './id -un >/tmp/output' nobody")) == -1) {
-          goto EXIT;
-        }
-    }
-    else {
-        if ((rc = system("./id -un >/tmp/output")) == -1) {
-          goto EXIT;
-        }
-    }
-    memset(result, '\0', sizeof(result));
-    if ((fd = open(output, O_RDONLY)) == -1) {
-      rc = -1;
-      goto EXIT;
-    }
-    if ((rc = read(fd, result, strlen(uname))) == -1) {
-      goto EXIT;
+    if ((rc = run_id("-un", nobody, result, sizeof(result))) == -1) {
+        goto EXIT;
     }
-    close(fd);
-    if ((rc = strncmp(result, uname, strlen(uname))) != 0) {
+    if ((rc = strcmp(result, uname)) != 0) {
       printf("expected user:  %s | actual user:  %s | FAIL\n", uname, result);
       g_rc = -1;
     } else {
@@ -85,26 +100,10 @@ int check_id(mode_t mode, char *uname, char *gname, int nobody) {
     /*
      * Check effective group
      */
-    if (nobody) {
-         if ((rc = system("su -s /bin/bash -c './id -gn >/tmp/output' nobody")) == -1) {
-          goto EXIT;
-        }
-    }
-    else {
-        if ((rc = system("./id -gn >/tmp/output")) == -1) {
-          goto EXIT;
-        }
-    }
-    memset(result, '\0', sizeof(result));
-    if ((fd = open(output, O_RDONLY)) == -1) {
-      rc = -1;
-      goto EXIT;
-    }
-    if ((rc = read(fd, result, strlen(gname))) == -1) {
-      goto EXIT;
+    if ((rc = run_id("-gn", nobody, result, sizeof(result))) == -1) {
+        goto EXIT;
     }
-    close(fd);
-    if ((rc = strncmp(result, gname, strlen(gname))) != 0) {
+    if ((rc = strcmp(result, gname)) != 0) {
       printf("expected group: %s | actual group: %s | FAIL\n", gname, result);
       g_rc = -1;
     } else {
@@ -113,7 +112,6 @@ int check_id(mode_t mode, char *uname, char *gname, int nobody) {
     printf("\n");
 
 EXIT:
-    unlink(output);
 
     return (rc);
 }
@@ -141,10 +139,18 @@ int main(int argc, char *argv[]) {
     }
     gid_nobody = gr->gr_gid;
 
+    creds[1].uid = uid_nobody;
+    creds[1].gid = gid_nobody;
+    if ((rc = cm_start(creds, 2)) == -1) {
+        goto EXIT;
+    }
+
     /*
      * Create local id file - nobody:nobody
      */
-    system("cp /usr/bin/id .");
+    if ((rc = copy_file("/usr/bin/id", filename)) == -1) {
+        goto EXIT;
+    }
     if ((rc = chown(filename, uid_nobody, gid_nobody)) == -1) {
         goto EXIT;
     }
@@ -187,6 +193,7 @@ int main(int argc, char *argv[]) {
     check_id(S_ISUID | S_ISGID, "root", "root", 1);
 
 EXIT:
+    cm_stop(creds, 2);
     unlink(filename);
 
     rc = 0;
@@ -43,15 +43,20 @@
 **
 **           In all cases, links are skipped.
 **
+**           Both passes are made on a file before moving to the next one,
+**           the tree is walked by -j threads (one per CPU by default, see
+**           fswalk.h).  The access checks switch the euid/egid of the
+**           calling thread only, the output of a file is printed at once.
+**
 **
 **  HISTORY:
 **    10/04 originated by Dan Jones (danjones@us.ibm.com)
 **
 **********************************************************************/
 #include <sys/types.h>
-#include <sys/dir.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
@@ -61,45 +66,55 @@
 #include <errno.h>
 #include <stdlib.h>
 
-extern int alphasort ();
+#include "fswalk.h"
+
+#define NTESTS 2
 
 static int perms[] = {S_IRUSR, S_IWUSR, S_IXUSR,
                       S_IRGRP, S_IWGRP, S_IXGRP,
                       S_IROTH, S_IWOTH, S_IXOTH};
 static char *ptext[] = {"r", "w", "x", "r", "w", "x", "r", "w", "x"};
 
-int totalpass = 0;
-int totalfail = 0;
-int totalskip = 0;
+/* per test, updated from all the walker threads */
+int totalpass[NTESTS];
+int totalfail[NTESTS];
+int totalskip[NTESTS];
 uid_t uid_nobody = 65534;
 gid_t gid_nobody = 65533;
 
-int test = 0;
 static char *test_description[] = {"Check default permissions",
 				   "chown files to testuser/testgroup"};
 
-/*
- * Do not include . or .. in directory list.
- */
-int file_select (const struct direct *entry)
-{
-  if ((strcmp (entry->d_name, ".") == 0)
-      || (strcmp (entry->d_name, "..") == 0))
-    return (0);
-  else
-    return (1);
-}
+struct testuser {
+  uid_t uid;
+  gid_t gid;
+};
+
+#define COUNT(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_RELAXED)
 
 /*
- * Set euid, egid
+ * Set euid, egid of the calling thread
+ *
+ * The raw syscalls change the calling thread only, glibc's seteuid()
+ * would change all of them.  setfsuid() is not enough, the sysctl
+ * permission check in /proc/sys looks at the euid.
  */
-void setids(uid_t uid, gid_t gid) {
+#ifdef SYS_setresuid32
+#define SYS_SETRESUID SYS_setresuid32
+#define SYS_SETRESGID SYS_setresgid32
+#else
+#define SYS_SETRESUID SYS_setresuid
+#define SYS_SETRESGID SYS_setresgid
+#endif
 
-  int rc = 0;
+void setids(uid_t uid, gid_t gid) {
 
-  if ((rc = setegid(gid)) == -1)
+  // back to root first, a non-root euid could not change the egid
+  if (syscall(SYS_SETRESUID, -1, 0, -1) == -1)
+    printf("\nERROR: unable to set uid. errno = %d\n", errno);
+  if (syscall(SYS_SETRESGID, -1, gid, -1) == -1)
     printf("\nERROR: unable to set gid. errno = %d\n", errno);
-  if ((rc = seteuid(uid)) == -1)
+  if (syscall(SYS_SETRESUID, -1, uid, -1) == -1)
     printf("\nERROR: unable to set uid. errno = %d\n", errno);
 
   return;
@@ -107,89 +122,81 @@ void setids(uid_t uid, gid_t gid) {
 
 /*
  * Check actual vs. expected access using open system call
+ *
+ * O_NONBLOCK keeps a fifo from blocking the thread, the permission
+ * check comes before it in open.
  */
-void testaccess(char *pathname, int mode, int expected, char *outbuf) {
+void testaccess(const struct fswalk_ent *ent, int test, int mode,
+                int expected, FILE *out) {
 
   int testrc = 0;
   int myerr = 0;
 
   if (expected == -1) {
-    strcat(outbuf, "expected: fail  ");
+    fprintf(out, "expected: fail  ");
   } else {
-    strcat(outbuf, "expected: pass  ");
+    fprintf(out, "expected: pass  ");
   }
 
-  if ((testrc = open(pathname, mode)) == -1) {
+  if ((testrc = openat(ent->dirfd, ent->name,
+                       mode | O_NONBLOCK | O_NOCTTY | O_NOFOLLOW)) == -1) {
     myerr = errno;
-    strcat(outbuf, "actual: fail");
+    fprintf(out, "actual: fail");
   } else {
-    strcat(outbuf, "actual: pass");
+    fprintf(out, "actual: pass");
     close(testrc);
   }
 
   if (myerr == ENODEV) {
-    sprintf(&(outbuf[strlen(outbuf)]), "\tresult: SKIP : no device : %s\n", pathname);
-    totalskip++;
+    fprintf(out, "\tresult: SKIP : no device : %s\n", ent->path);
+    COUNT(totalskip[test]);
   } else if (myerr == EBUSY) {
-    sprintf(&(outbuf[strlen(outbuf)]), "\tresult: SKIP : device busy : %s\n", pathname);
-    totalskip++;
+    fprintf(out, "\tresult: SKIP : device busy : %s\n", ent->path);
+    COUNT(totalskip[test]);
   } else if (expected == 0) {
     if (testrc != -1)
-      strcat(outbuf, "\tresult: PASS\n");
+      fprintf(out, "\tresult: PASS\n");
     else
-      strcat(outbuf, "\tresult: PASS (MORE RESTRICTIVE)\n");
-    totalpass++;
+      fprintf(out, "\tresult: PASS (MORE RESTRICTIVE)\n");
+    COUNT(totalpass[test]);
   } else if ((expected == -1) && (testrc == -1)) {
-    strcat(outbuf, "\tresult: PASS\n");
-    totalpass++;
+    fprintf(out, "\tresult: PASS\n");
+    COUNT(totalpass[test]);
   } else {
-    sprintf(&(outbuf[strlen(outbuf)]), "\tresult: FAIL : errno = %d : %s\n", errno, pathname);
-    totalfail++;
+    fprintf(out, "\tresult: FAIL : errno = %d : %s\n", myerr, ent->path);
+    COUNT(totalfail[test]);
   }
 
-  printf("%s", outbuf);
-
   return;
 }
 
 /*
  * Test access for owner, group, other
  */
-void testall(struct stat *ostatbufp, char *pathname, uid_t uid, gid_t gid) {
+void testall(const struct fswalk_ent *ent, int test, uid_t uid, gid_t gid,
+             FILE *out) {
 
   int i;
-  int rc = 0;
-  char outbuf[256];
   struct passwd passwd;
   struct passwd *passwdp;
   struct group group;
   struct group *groupp;
   struct stat statbuf;
   struct stat *statbufp = &statbuf;
-  char *pbuf;
-  char *gbuf;
-
-  passwdp = (struct passwd *)malloc(sizeof(passwd));
-  groupp  = (struct group *)malloc(sizeof(group));
-  pbuf = (char *)malloc(4096);
-  gbuf = (char *)malloc(4096);
+  char pbuf[4096];
+  char gbuf[4096];
 
-  if (!passwdp || !groupp || !pbuf || !gbuf) {
-    printf("ERROR: unable to allocate enough memory\n");
-    goto EXIT;
-  }
-
-  *pbuf = '\0';
-  *gbuf = '\0';
-
-  setids(0,0);
-  printf("\n%s\n", pathname);
+  setids(0, 0);
+  fprintf(out, "\n%s\n", ent->path);
+  if (test == 1)
+    fprintf(out, "Test: %s\n", test_description[test]);
 
   // For test 1 we chown the file owner/group
   if (test == 1) {
-    if ((rc = chown(pathname, uid, gid)) == -1) {
-      printf("ERROR: unable to chown %s to %d:%d\n", pathname, uid, gid);
-      goto EXIT;
+    if (fchownat(ent->dirfd, ent->name, uid, gid,
+                 AT_SYMLINK_NOFOLLOW) == -1) {
+      fprintf(out, "ERROR: unable to chown %s to %d:%d\n", ent->path, uid, gid);
+      return;
     }
   }
 
@@ -197,214 +204,183 @@ void testall(struct stat *ostatbufp, char *pathname, uid_t uid, gid_t gid) {
   memset(&statbuf, '\0', sizeof(statbuf));
 
   // Get file stat info to determine actual owner and group
-  stat(pathname, &statbuf);
+  if (test == 1)
+    fstatat(ent->dirfd, ent->name, &statbuf, AT_SYMLINK_NOFOLLOW);
+  else
+    statbuf = ent->st;
 
   // If we successfully chow'd the file, but the owner hasn't changed
   // log it and skip.
   if ((test == 1) && ((statbufp->st_uid != uid) || (statbufp->st_gid != gid))) {
-    printf("INFO: chown success, but file owner did not change: %s\n", pathname);
-    totalskip++;
-    goto EXIT;
+    fprintf(out, "INFO: chown success, but file owner did not change: %s\n", ent->path);
+    COUNT(totalskip[test]);
+    return;
   }
 
-  strcpy(outbuf, "MODE: ");
+  fprintf(out, "MODE: ");
   for (i = 0; i < sizeof(perms)/sizeof(int); i++) {
     if (statbufp->st_mode & perms[i]) {
-      strcat(outbuf, ptext[i]);
+      fprintf(out, "%s", ptext[i]);
     } else {
-      strcat(outbuf, "-");
+      fprintf(out, "-");
     }
   }
-  getpwuid_r(statbufp->st_uid, &passwd, pbuf, 4096, &passwdp);
-  getgrgid_r(statbufp->st_gid, &group, gbuf, 4096, &groupp);
-
-  sprintf(&(outbuf[strlen(outbuf)]), "  %s:%s\n", passwd.pw_name, group.gr_name);
-  printf("%s", outbuf);
+  if (getpwuid_r(statbufp->st_uid, &passwd, pbuf, sizeof(pbuf), &passwdp) || !passwdp)
+    snprintf(passwd.pw_name = pbuf, sizeof(pbuf), "%d", statbufp->st_uid);
+  if (getgrgid_r(statbufp->st_gid, &group, gbuf, sizeof(gbuf), &groupp) || !groupp)
+    snprintf(group.gr_name = gbuf, sizeof(gbuf), "%d", statbufp->st_gid);
+  fprintf(out, "  %s:%s\n", passwd.pw_name, group.gr_name);
 
   // Check owner access for read/write
   setids(statbufp->st_uid, gid_nobody);
-  strcpy(outbuf, "Owner read\t");
+  fprintf(out, "Owner read\t");
   // If we are root, we expect to succeed event
   // without explicit permission.
   if ((statbufp->st_mode & S_IRUSR) || (statbufp->st_uid == 0)) {
-    testaccess(pathname, O_RDONLY, 0, outbuf);
+    testaccess(ent, test, O_RDONLY, 0, out);
   } else {
-    testaccess(pathname, O_RDONLY, -1, outbuf);
+    testaccess(ent, test, O_RDONLY, -1, out);
   }
-  strcpy(outbuf, "Owner write\t");
+  fprintf(out, "Owner write\t");
   // If we are root, we expect to succeed event
   // without explicit permission.
   if ((statbufp->st_mode & S_IWUSR) || (statbufp->st_uid == 0)) {
-    testaccess(pathname, O_WRONLY, 0, outbuf);
+    testaccess(ent, test, O_WRONLY, 0, out);
   } else {
-    testaccess(pathname, O_WRONLY, -1, outbuf);
+    testaccess(ent, test, O_WRONLY, -1, out);
   }
 
   // Check group access for read/write
-  setids(0, 0);
   setids(uid_nobody, statbufp->st_gid);
-  strcpy(outbuf, "Group read\t");
+  fprintf(out, "Group read\t");
   if (statbufp->st_mode & S_IRGRP) {
-    testaccess(pathname, O_RDONLY, 0, outbuf);
+    testaccess(ent, test, O_RDONLY, 0, out);
   } else {
-    testaccess(pathname, O_RDONLY, -1, outbuf);
+    testaccess(ent, test, O_RDONLY, -1, out);
   }
-  strcpy(outbuf, "Group write\t");
+  fprintf(out, "Group write\t");
   if (statbufp->st_mode & S_IWGRP) {
-    testaccess(pathname, O_WRONLY, 0, outbuf);
+    testaccess(ent, test, O_WRONLY, 0, out);
   } else {
-    testaccess(pathname, O_WRONLY, -1, outbuf);
+    testaccess(ent, test, O_WRONLY, -1, out);
   }
 
   // Check other access for read/write
-  setids(0, 0);
   setids(uid_nobody, gid_nobody);
-  strcpy(outbuf, "Other read\t");
+  fprintf(out, "Other read\t");
   if (statbufp->st_mode & S_IROTH) {
-    testaccess(pathname, O_RDONLY, 0, outbuf);
+    testaccess(ent, test, O_RDONLY, 0, out);
   } else {
-    testaccess(pathname, O_RDONLY, -1, outbuf);
+    testaccess(ent, test, O_RDONLY, -1, out);
   }
-  strcpy(outbuf, "Other write\t");
+  fprintf(out, "Other write\t");
   if (statbufp->st_mode & S_IWOTH) {
-    testaccess(pathname, O_WRONLY, 0, outbuf);
+    testaccess(ent, test, O_WRONLY, 0, out);
   } else {
-    testaccess(pathname, O_WRONLY, -1, outbuf);
+    testaccess(ent, test, O_WRONLY, -1, out);
   }
 
   setids(0, 0);
 
   if (test == 1) {
-    chown(pathname, ostatbufp->st_uid, ostatbufp->st_gid);
+    fchownat(ent->dirfd, ent->name, ent->st.st_uid, ent->st.st_gid,
+             AT_SYMLINK_NOFOLLOW);
   }
 
-EXIT:
-
   return;
 }
 
 /*
  * Check access.
  *
- * This method check a file or recursively scan directories and verify
- * the file access modes are enforced.
- *
+ * Called by the walker for every file under the directory, runs both
+ * tests on it and prints what they logged in one piece.
  */
-void check_access (char *pathname, uid_t uid, gid_t gid)
+int check_access (const struct fswalk_ent *ent, void *arg)
 {
-  int count = 0;
-  int i = 0;
-  int rc = 0;
-  int file_select ();
-  char entry[MAXPATHLEN];
-  struct dirent **entries;
-  struct stat statbuf;
-
-  // Reset our extended group list
-  setgroups(0, NULL);
-
-  // Start with clean buffers
-  memset(&statbuf, '\0', sizeof(statbuf));
-
-  // Get file stat info.
-  if ((rc = lstat(pathname, &statbuf)) == -1) {
-    printf("\nERROR: %s. Could not obtain file status. errno = %d\n", pathname, errno);
-    goto EXIT;
+  struct testuser *tu = arg;
+  char *outbuf = NULL;
+  size_t outlen = 0;
+  FILE *out;
+  int test;
+
+  if (ent->err) {
+    printf("\nERROR: %s. Could not %s. errno = %d\n", ent->path,
+           S_ISDIR(ent->st.st_mode) ? "open directory" : "obtain file status",
+           ent->err);
+    return 0;
   }
 
   // If link, skip it.
-  if (S_ISLNK(statbuf.st_mode)) {
-    printf("Link: skipping %s\n", entry);
-    totalskip++;
-    goto EXIT;
+  if (S_ISLNK(ent->st.st_mode)) {
+    printf("Link: skipping %s\n", ent->path);
+    for (test = 0; test < NTESTS; test++)
+      COUNT(totalskip[test]);
+    return 0;
   }
 
-  // If not a directory, check it and leave.
-  if (!(S_ISDIR(statbuf.st_mode))) {
-    testall(&statbuf, pathname, uid, gid);
-    goto EXIT;
-  }
-
-  // If directory, recurse through all subdirectories, checking all files.
-  if ((count = scandir (pathname, &entries, file_select, alphasort)) == -1) {
-    printf("\nERROR: %s. Could not scandir. errno = %d\n", pathname, errno);
-    goto EXIT;
-  }
-  for (i = 0; i < count; i++) {
-
-    sprintf(entry, "%s/%s", pathname, entries[i]->d_name);
-
-    // If link, skip it
-    // Else if directory, call check_access() recursively
-    if (entries[i]->d_type == DT_LNK) {
-      printf("Link: skipping %s\n", entry);
-      totalskip++;
-      continue;
-    } else if (entries[i]->d_type == DT_DIR) {
-      check_access(entry, uid, gid);
-      continue;
-    }
-
-    // Clean the buffer
-    memset(&statbuf, '\0', sizeof(statbuf));
-
-    // Get file stat info.
-    if ((rc = lstat(entry, &statbuf)) == -1) {
-      printf("\nERROR: %s. Could not obtain file status. errno = %d\n", pathname, errno);
-      continue;
-    }
-
-    // The directory entry doesn't always seem to have the
-    // right info. So we check again after the stat().
-    //
-    // If link, skip it
-    // Else if directory, call check_access() recursively
-    // Else check access
-    if (S_ISLNK(statbuf.st_mode)) {
-      printf("Link: (2) skipping %s\n", entry);
-      totalskip++;
-      continue;
-    } else if (S_ISDIR(statbuf.st_mode)) {
-      check_access(entry, uid, gid);
-      continue;
-    } else {
-      testall(&statbuf, entry, uid, gid);
-      continue;
-    }
+  if ((out = open_memstream(&outbuf, &outlen)) == NULL) {
+    printf("ERROR: unable to allocate enough memory\n");
+    return 0;
   }
+  for (test = 0; test < NTESTS; test++)
+    testall(ent, test, tu->uid, tu->gid, out);
+  fclose(out);
 
-EXIT:
+  fwrite(outbuf, 1, outlen, stdout);
+  free(outbuf);
 
-  return;
+  return 0;
 }
 
 int main (int argc, char *argv[]) {
 
   int i = 0;
+  int opt;
+  int nthreads = 0;
   struct passwd *pw;
   struct group *gr;
-
-  if (argc != 4) {
-    printf("usage: %s <directory> <testuser> <testgroup>\n", argv[0]);
+  struct testuser tu;
+
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    switch (opt) {
+    case 'j':
+      nthreads = atoi(optarg);
+      break;
+    default:
+      goto USAGE;
+    }
+  }
+  if (argc - optind != 3) {
+USAGE:
+    printf("usage: %s [-j <threads>] <directory> <testuser> <testgroup>\n", argv[0]);
     goto EXIT;
   }
 
-  if ((pw = getpwnam(argv[2])) == NULL) {
-    printf("ERROR: invalid username %s\n", argv[2]);
+  if ((pw = getpwnam(argv[optind + 1])) == NULL) {
+    printf("ERROR: invalid username %s\n", argv[optind + 1]);
     goto EXIT;
   }
-  if ((gr = getgrnam(argv[3])) == NULL) {
-    printf("ERROR: invalid group %s\n", argv[3]);
+  if ((gr = getgrnam(argv[optind + 2])) == NULL) {
+    printf("ERROR: invalid group %s\n", argv[optind + 2]);
     goto EXIT;
   }
+  tu.uid = pw->pw_uid;
+  tu.gid = gr->gr_gid;
+
+  // Reset our extended group list, for all the threads
+  setgroups(0, NULL);
+
+  printf("Tests:");
+  for (i = 0; i < NTESTS; i++)
+    printf(" %s%s", test_description[i], i < NTESTS - 1 ? "," : "\n\n");
+  fflush(stdout);
+
+  fswalk(argv[optind], nthreads, check_access, &tu);
 
-  for (i = 0; i < 2; i++) {
-    totalpass = 0;
-    totalfail = 0;
-    test = i;
-    printf("Test: %s\n\n", test_description[i]);
-    check_access(argv[1], pw->pw_uid, gr->gr_gid);
-    printf("\nTEST PASSED = %d, FAILED = %d, SKIPPED = %d\n", totalpass, totalfail, totalskip);
+  for (i = 0; i < NTESTS; i++) {
+    printf("\nTest: %s\n", test_description[i]);
+    printf("TEST PASSED = %d, FAILED = %d, SKIPPED = %d\n", totalpass[i], totalfail[i], totalskip[i]);
   }
 
  EXIT:
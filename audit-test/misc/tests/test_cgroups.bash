@@ -35,7 +35,7 @@ sane_cgroup_mount()
     return 0
 }
 
-# verify that a cgroup is mounted and mount it if not
+# verify that a cgroup v1 controller is mounted and mount it if not
 # please not that we employ various tricks here to make it all work,
 # due to how cgroups work as a filesystem - if some other process/user
 # combines controllers into a single hierarchy, we're unable to mount
@@ -78,164 +78,389 @@ mount_cgroup()
 }
 
 
+# the cgroup v2 hierarchy, if mounted
+cgroup2_mount()
+{
+    awk '$3 == "cgroup2" { print $2; exit }' /proc/mounts
+}
+
+# the v2 name of a controller, none for the freezer (part of the core)
+v2_controller()
+{
+    case "$1" in
+        blkio) echo io ;;
+        freezer) ;;
+        *) echo "$1" ;;
+    esac
+}
+
+# create the testing cgroup for a controller, on v2 when the controller
+# is available there, on v1 otherwise (devices has no v2 interface files,
+# it is a BPF program there); sets ver and base
+make_cgroup()
+{
+    local cgroup="$1" root= ctrl=
+
+    root=$(cgroup2_mount)
+    ctrl=$(v2_controller "$cgroup")
+    if [ "$root" -a "$cgroup" != devices ] && \
+       { [ -z "$ctrl" ] || grep -qw "$ctrl" "$root/cgroup.controllers"; }; then
+        # enabling fails in a non-root cgroup with processes (containers)
+        if [ -z "$ctrl" ] || grep -qw "$ctrl" "$root/cgroup.subtree_control" || \
+           { echo "+$ctrl" > "$root/cgroup.subtree_control" && \
+             prepend_cleanup "echo \"-$ctrl\" > \"$root/cgroup.subtree_control\""; }; then
+            ver=2
+            base="${root}/testcg_${cgroup}_$RANDOM"
+            mkdir "$base" || return 1
+            prepend_cleanup "rmdir \"$base\""
+            # the core freezer appeared in 5.2
+            [ "$ctrl" -o -f "${base}/cgroup.freeze" ] && return 0
+        fi
+    fi
+
+    ver=1
+    base=$(mount_cgroup "$cgroup") || return 1
+    base="${base}/testcg_${cgroup}_$RANDOM"
+    mkdir "$base" || return 1
+    prepend_cleanup "rmdir \"$base\""
+}
+
+# value of a key in a flat keyed cgroup file (cpu.stat, memory.events, ...)
+cg_key()
+{
+    awk -v key="$2" '$1 == key { print $2; exit }' "$1"
+}
+
+# value of a key from the statistics cgroup_limits -s prints
+lim_key()
+{
+    sed -n "s/^$1=//p" <<<"$2"
+}
+
+# total stall time from a PSI file, "-" without PSI support
+cg_psi()
+{
+    local total=
+    [ -r "$1" ] && total=$(awk '$1 == "some" {
+        for (i = 2; i <= NF; i++)
+            if (sub(/^total=/, "", $i)) print $i
+    }' "$1" 2>/dev/null)
+    echo "${total:--}"
+}
+
+# major:minor of a device in decimal, as cgroup files want it
+devnums()
+{
+    local maj= min=
+    read maj min <<<"$(stat --format='%t %T' "$1")" || return 1
+    echo "$((0x$maj)):$((0x$min))"
+}
+
+# the tests below set up their cgroups first (in this shell, to get the
+# cleanup right), then measure concurrently in sibling cgroups
 #
-# main
-#
+# cpu and blkio check what the limited process accounted itself (its CPU
+# clock, the bytes it read, cgroup_limits -s) against what the limit allows
+# for its run time, the others compare reference runs (outside cgroups) with
+# runs under cgroups; on v2, the limits are also checked against what the
+# cgroup itself accounted (cpu.stat, memory.events, io.stat), the PSI stall
+# times are logged along
+
+setup_cpu()
+{
+    quota_us=1000     # 0.001sec CPU time
+    period_us=100000  # each 0.1sec real time
+
+    if [ "$ver" = 2 ]; then
+        echo "$quota_us $period_us" > "$base"/cpu.max
+    else
+        echo "$quota_us" > "$base"/cpu.cfs_quota_us && \
+        echo "$period_us" > "$base"/cpu.cfs_period_us
+    fi
+}
 
-cgroup="$1"
-case "$cgroup" in
-    cpu|memory|blkio|devices|freezer) ;;
-    *) exit_error "unsupported controller: $1" ;;
-esac
-
-# mount the controller and create a custom testing cgroup
-base=$(mount_cgroup "$cgroup") || exit_error "failed mounting cgroup fs"
-base="${base}/testcg_$RANDOM"
-prepend_cleanup "rmdir \"$base\""
-mkdir "$base" || exit_error "cannot create cgroup"
-
-# the tests below work by comparing reference runs (outside cgroups) with
-# runs under cgroups - the latter ones should be limited by the scope
-# of each given cgroup controller
-
-case "$cgroup" in
-
-    cpu)
-        # logic: increment counter in an infinite loop, interrupt
-        # after a certain time
-        quota_us=1000     # 0.001sec CPU time
-        period_us=100000  # each 0.1sec real time
-
-        # reference: run at unrestricted speed
-        ref=$(timeout --preserve-status -s INT 3 ./cgroup_limits cpu)
-        [ $? -eq 0 -a "$ref" ] || exit_fail "reference run failed"
-
-        # limited: run at reduced speed
-        echo "$quota_us" > "$base"/cpu.cfs_quota_us || exit_error
-        echo "$period_us" > "$base"/cpu.cfs_period_us || exit_error
-        limited=$(timeout --preserve-status -s INT 3 ./cgroup_exec "$base"/tasks ./cgroup_limits cpu)
-        [ $? -eq 0 -a "$limited" ] || exit_error "limited run failed"
-
-        # result: 'ref' clocked theoretical 0.1sec CPU time each 0.1sec
-        # of real time, 'limited' only 1/100th of that, meaning that the
-        # resulting counter from 'limit' should be 100 times smaller
-        # - accept anything under 1/50th due to scheduler
-        ref=$((ref / 50))
-        [ "$limited" -lt "$ref" ] || \
-            exit_fail "limited run ate more CPU time than expected ($limited/$ref)"
-        ;;
-
-    memory)
-        # logic: try to allocate twice as much memory as the limit allows
-        ceiling=$((2048 * 1024))  # 2 MiB
-        limit=$((1024 * 1024))    # 1 MiB
+measure_cpu()
+{
+    local out= wall= cpu= allowed= usage= throttled=
+
+    # logic: increment counter in an infinite loop, interrupt after
+    # a certain time; the process may use quota_us of CPU time per
+    # period_us, plus the period the run ends in and the one it started in
+    # - accept 1.5 times that due to scheduler tick granularity
+    out=$(timeout --preserve-status -s INT 1 ./cgroup_exec "$procs" ./cgroup_limits -s cpu)
+    [ $? -eq 0 -a "$out" ] || { echo "limited run failed"; return 2; }
+    wall=$(lim_key wall_us "$out")
+    cpu=$(lim_key cpu_us "$out")
+    allowed=$((quota_us * (wall / period_us + 2) * 3 / 2))
+    echo "cpu: wall_us=$wall cpu_us=$cpu allowed_us=$allowed" \
+         "per_interval_cpu_pct=$(lim_key per_interval_cpu_pct "$out")"
+    [ "$cpu" -le "$allowed" ] || \
+        { echo "limited run ate more CPU time than allowed ($cpu/$allowed)"; return 1; }
+
+    if [ "$ver" = 2 ]; then
+        # the cgroup accounting should agree
+        usage=$(cg_key "$base"/cpu.stat usage_usec)
+        throttled=$(cg_key "$base"/cpu.stat nr_throttled)
+        echo "cpu: usage_us=$usage nr_throttled=$throttled" \
+             "throttled_us=$(cg_key "$base"/cpu.stat throttled_usec)" \
+             "psi_some_us=$(cg_psi "$base"/cpu.pressure)"
+        [ "$usage" -le "$allowed" -a "$throttled" -gt 0 ] || \
+            { echo "cgroup accounted more CPU time than allowed ($usage/$allowed)"; return 1; }
+    fi
+}
+
+setup_memory()
+{
+    ceiling=$((2048 * 1024))  # 2 MiB
+    limit=$((1024 * 1024))    # 1 MiB
+
+    if [ "$ver" = 2 ]; then
+        echo "$limit" > "$base"/memory.max || return 1
+        [ ! -f "$base"/memory.swap.max ] || echo 0 > "$base"/memory.swap.max
+    else
+        echo "$limit" > "$base"/memory.limit_in_bytes && \
+        echo "$limit" > "$base"/memory.memsw.limit_in_bytes
+    fi
+}
 
+measure_memory()
+{
+    local ref= limited= rc= max= oom_kill=
+
+    # logic: try to allocate twice as much memory as the limit allows
+
+    if [ "$ver" = 1 ]; then
         # reference: allocate all requested memory
         ref=$(./cgroup_limits memory "$ceiling")
-        [ $? -eq 0 -a "$ref" = "$ceiling" ] || exit_fail "reference allocation failed"
-
-        # limited: fail allocation or get killed by OOM killer
-        echo "$limit" > "$base"/memory.limit_in_bytes || exit_error
-        echo "$limit" > "$base"/memory.memsw.limit_in_bytes || exit_error
-        limited=$(./cgroup_exec "$base"/tasks ./cgroup_limits memory "$ceiling")
-
-        # result: the proces should be SIGKILLed by an OOM daemon
-        # if memory overcommit is enabled, or return 0 as bytes allocated
-        # when the allocation failed
-        [ $? -eq 137 -o "$limited" = "0" ] || \
-            exit_fail "limited run succeeded allocation / was not killed"
-        ;;
-
-    blkio)
-        # logic: try to read as much blocks as possible from a block device
-        # within a given time frame
-        bps=40960  # 40k = 10 blocks per second for loop devices
-        total=10M
-
-        # NOTE: while we could use files, we would need to ensure O_DIRECT
-        # and aligned reads and specific amounts of bytes per read(), along
-        # with ensuring that the file is on a block device (not a tmpfs),
-        # so just use losetup instead
-        backfile=$(mktemp)
-        prepend_cleanup "rm -f \"$backfile\""
-        dd if=/dev/zero of="$backfile" bs="$total" count=1 || exit_error
-        device=$(losetup --show -f "$backfile") || exit_error
-        prepend_cleanup "losetup -d \"$device\""
-        devnums=$(stat --format='%t:%T' "$device") || exit_error
-        # much more accurate measurements: disable readahead
-        origra=$(blockdev --getra "$device") || exit_error
-        prepend_cleanup "blockdev --setra \"$origra\" \"$device\""
-        blockdev --setra 0 "$device" || exit_error
-
-        # reference: read without restrictions
-        ref=$(timeout --preserve-status -s INT 1 ./cgroup_limits blkio "$device")
-        [ $? -eq 0 -a "$ref" -gt 0 ] || exit_fail "reference read failed"
-
-        # limited: read much less bytes
-        echo "$devnums $bps" > "$base"/blkio.throttle.read_bps_device || exit_error
-        limited=$(timeout --preserve-status -s INT 1 ./cgroup_exec "$base"/tasks ./cgroup_limits blkio "$device")
-        [ $? -eq 0 -a "$limited" -gt 0 ] || exit_fail "limited read failed"
-
-        # result: the limited proces should have read 1sec * 40k worth
-        # of data, which is at most 40960/10485760th or ~ 1/256th of the
-        # reference process
-        # - accept anything under 1/100th
-        ref=$((ref / 100))
-        [ "$limited" -lt "$ref" ] || \
-            exit_fail "limited run ate more blk bandwidth than expected ($limited/$ref)"
-        ;;
-
-    devices)
-        # logic: try opening a testing device using open(2)
-        device="/dev/null"
-        devnums=$(stat --format='%t:%T' "$device") || exit_error
-
-        # reference: succeed in opening the device
-        ref=$(./cgroup_limits devices "$device")
-        [ $? -eq 0 -a "$ref" = "0" ] || exit_fail "reference device open failed"
-
-        # limited: fail at opening the device
-        echo "a $devnums rwm" > "$base"/devices.deny || exit_error
-        limited=$(./cgroup_exec "$base"/tasks ./cgroup_limits devices "$device")
-
-        # result: the errno returned should be EPERM (1)
-        [ $? -eq 0 -a "$limited" = "1" ] || \
-            exit_fail "limited run did not fail on device open"
-        ;;
-
-    freezer)
-        # logic: expect strings within certain time intervals (none will arive
-        # if the process is frozen)
-
-        # reference: run without freeze restrictions
-        coproc timeout 60 ./cgroup_limits freezer
-        freezer1=$(head -n1 <&"${COPROC[0]}")
-        pid=$(pgrep -P $!)  # the actual cgroups_limits, child of `timeout'
-        kill -INT "$pid"  # continue
-        freezer2=$(timeout 2 head -n1 <&"${COPROC[0]}") || kill "$pid"
-        kill -INT "$pid"  # continue
-        wait "$!"
-        [ $? -eq 0 -a "$freezer1" = "freezer1" -a "$freezer2" = "freezer2" ] || \
-            exit_fail "reference run failed"
-
-        # limited: freeze before signalling the process to continue
-        coproc timeout 60 ./cgroup_exec "$base"/tasks ./cgroup_limits freezer
-        freezer1=$(head -n1 <&"${COPROC[0]}")
-        pid=$(pgrep -P $!)  # the actual cgroups_limits, child of `timeout'
-        echo FROZEN > "$base"/freezer.state
-        kill -INT "$pid"  # continue
-        freezer2=$(timeout 2 head -n1 <&"${COPROC[0]}") || kill "$pid"
-        kill -INT "$pid"  # continue
-        echo THAWED > "$base"/freezer.state
-        wait "$!"
-        [ $? -eq 143 -a "$freezer1" = "freezer1" -a "$freezer2" = "" ] || \
-            exit_fail "limited run failed"
-
-        # result: limited run should be killed while still being frozen, never
-        # returning 'freezer2' (checked above)
-        ;;
-esac
+        [ $? -eq 0 -a "$ref" = "$ceiling" ] || { echo "reference allocation failed"; return 1; }
+    fi
 
+    # limited: fail allocation or get killed by OOM killer
+    limited=$(./cgroup_exec "$procs" ./cgroup_limits memory "$ceiling")
+    rc=$?
+
+    # result: the proces should be SIGKILLed by an OOM daemon
+    # if memory overcommit is enabled, or return 0 as bytes allocated
+    # when the allocation failed
+    [ $rc -eq 137 -o "$limited" = "0" ] || \
+        { echo "limited run succeeded allocation / was not killed"; return 1; }
+
+    # on v2, the cgroup must have hit its limit, and the kill be its own
+    if [ "$ver" = 2 ]; then
+        max=$(cg_key "$base"/memory.events max)
+        oom_kill=$(cg_key "$base"/memory.events oom_kill)
+        echo "memory: max_events=$max oom_kill=$oom_kill" \
+             "peak=$(cat "$base"/memory.peak 2>/dev/null || echo -)" \
+             "psi_some_us=$(cg_psi "$base"/memory.pressure)"
+        [ "$max" -gt 0 ] || { echo "memory.max was never hit"; return 1; }
+        [ $rc -ne 137 -o "$oom_kill" -gt 0 ] || \
+            { echo "killed, but not by the cgroup OOM killer"; return 1; }
+    fi
+}
+
+setup_blkio()
+{
+    local backfile= total=10M
+
+    bps=40960  # 40k = 10 blocks per second for loop devices
+
+    # NOTE: while we could use files, we would need to ensure O_DIRECT
+    # and aligned reads and specific amounts of bytes per read(), along
+    # with ensuring that the file is on a block device (not a tmpfs),
+    # so just use losetup instead
+    backfile=$(mktemp)
+    prepend_cleanup "rm -f \"$backfile\""
+    dd if=/dev/zero of="$backfile" bs="$total" count=1 || return 1
+    loopdev=$(losetup --show -f "$backfile") || return 1
+    prepend_cleanup "losetup -d \"$loopdev\""
+    loopnums=$(devnums "$loopdev") || return 1
+    # much more accurate measurements: disable readahead
+    origra=$(blockdev --getra "$loopdev") || return 1
+    prepend_cleanup "blockdev --setra \"$origra\" \"$loopdev\""
+    blockdev --setra 0 "$loopdev" || return 1
+
+    if [ "$ver" = 2 ]; then
+        echo "$loopnums rbps=$bps" > "$base"/io.max
+    else
+        echo "$loopnums $bps" > "$base"/blkio.throttle.read_bps_device
+    fi
+}
+
+measure_blkio()
+{
+    local out= wall= bytes= allowed= rbytes=
+
+    # logic: try to read as much blocks as possible from a block device
+    # within a given time frame, with O_DIRECT to bypass the page cache;
+    # the process may read bps per second, plus a second worth of
+    # throttling slice
+    out=$(timeout --preserve-status -s INT 1 ./cgroup_exec "$procs" ./cgroup_limits -s -d blkio "$loopdev")
+    [ $? -eq 0 ] || { echo "limited read failed"; return 1; }
+    wall=$(lim_key wall_us "$out")
+    bytes=$(lim_key bytes "$out")
+    [ "$bytes" ] && [ "$bytes" -gt 0 ] || { echo "limited read failed"; return 1; }
+    allowed=$((bps * (wall / 1000000 + 2)))
+    echo "blkio: wall_us=$wall bytes=$bytes ios=$(lim_key ios "$out")" \
+         "allowed=$allowed per_interval_bytes=$(lim_key per_interval_bytes "$out")"
+    [ "$bytes" -le "$allowed" ] || \
+        { echo "limited run ate more blk bandwidth than allowed ($bytes/$allowed)"; return 1; }
+
+    if [ "$ver" = 2 ]; then
+        # the cgroup accounting should agree
+        rbytes=$(awk -v dev="$loopnums" '$1 == dev {
+            for (i = 2; i <= NF; i++)
+                if (sub(/^rbytes=/, "", $i)) print $i
+        }' "$base"/io.stat)
+        echo "blkio: rbytes=${rbytes:-0} psi_some_us=$(cg_psi "$base"/io.pressure)"
+        [ "${rbytes:-0}" -gt 0 ] || { echo "no reads accounted to the cgroup"; return 1; }
+        [ "$rbytes" -le "$allowed" ] || \
+            { echo "cgroup accounted more blk bandwidth than allowed ($rbytes/$allowed)"; return 1; }
+    fi
+}
+
+setup_devices()
+{
+    nulldev="/dev/null"
+    nullnums=$(devnums "$nulldev") && \
+    echo "a $nullnums rwm" > "$base"/devices.deny
+}
+
+measure_devices()
+{
+    local ref= limited=
+
+    # logic: try opening a testing device using open(2)
+
+    # reference: succeed in opening the device
+    ref=$(./cgroup_limits devices "$nulldev")
+    [ $? -eq 0 -a "$ref" = "0" ] || { echo "reference device open failed"; return 1; }
+
+    # limited: fail at opening the device
+    limited=$(./cgroup_exec "$procs" ./cgroup_limits devices "$nulldev")
+
+    # result: the errno returned should be EPERM (1)
+    [ $? -eq 0 -a "$limited" = "1" ] || \
+        { echo "limited run did not fail on device open"; return 1; }
+}
+
+setup_freezer()
+{
+    :
+}
+
+# freeze or thaw the cgroup, on v2 wait until the kernel reports it done
+freeze()
+{
+    local i=
+
+    if [ "$ver" = 1 ]; then
+        [ "$1" = 1 ] && echo FROZEN > "$base"/freezer.state \
+                     || echo THAWED > "$base"/freezer.state
+        return
+    fi
+    echo "$1" > "$base"/cgroup.freeze || return 1
+    for ((i = 0; i < 100; i++)); do
+        [ "$(cg_key "$base"/cgroup.events frozen)" = "$1" ] && return 0
+        sleep 0.01
+    done
+    return 1
+}
+
+measure_freezer()
+{
+    local freezer1= freezer2= pid= rc=
+
+    # logic: expect strings within certain time intervals (none will arive
+    # if the process is frozen)
+
+    # reference: run without freeze restrictions
+    coproc timeout 60 ./cgroup_limits freezer
+    freezer1=$(head -n1 <&"${COPROC[0]}")
+    pid=$(pgrep -P $!)  # the actual cgroups_limits, child of `timeout'
+    kill -INT "$pid"  # continue
+    freezer2=$(timeout 2 head -n1 <&"${COPROC[0]}") || kill "$pid"
+    kill -INT "$pid"  # continue
+    wait "$!"
+    [ $? -eq 0 -a "$freezer1" = "freezer1" -a "$freezer2" = "freezer2" ] || \
+        { echo "reference run failed"; return 1; }
+
+    # limited: freeze before signalling the process to continue
+    coproc timeout 60 ./cgroup_exec "$procs" ./cgroup_limits freezer
+    freezer1=$(head -n1 <&"${COPROC[0]}")
+    pid=$(pgrep -P $!)  # the actual cgroups_limits, child of `timeout'
+    freeze 1 || { echo "cgroup not reported frozen"; rc=1; }
+    kill -INT "$pid"  # continue
+    freezer2=$(timeout 2 head -n1 <&"${COPROC[0]}") || kill "$pid"
+    kill -INT "$pid"  # continue
+    freeze 0
+    wait "$!"
+    [ $? -eq 143 -a "$freezer1" = "freezer1" -a "$freezer2" = "" ] || \
+        { echo "limited run failed"; return 1; }
+
+    # result: limited run should be killed while still being frozen, never
+    # returning 'freezer2' (checked above)
+    return ${rc:-0}
+}
+
+
+#
+# main
+#
+
+# one or more controllers, comma separated
+IFS=, read -a cgroups <<<"$1"
+[ "${#cgroups[@]}" -gt 0 ] || exit_error "no controller given"
+for cgroup in "${cgroups[@]}"; do
+    case "$cgroup" in
+        cpu|memory|blkio|devices|freezer) ;;
+        *) exit_error "unsupported controller: $cgroup" ;;
+    esac
+done
+
+# create a custom testing cgroup for each, siblings on v2, and set
+# the limits up; a controller that cannot be set up is reported as an
+# error of its own, the others are still measured
+ready=() errors=
+for cgroup in "${cgroups[@]}"; do
+    if ! make_cgroup "$cgroup"; then
+        echo "== $cgroup: cannot create the cgroup, skipped"
+        errors+=" $cgroup"
+        continue
+    fi
+    [ "$ver" = 2 ] && procs="$base"/cgroup.procs || procs="$base"/tasks
+    if ! setup_$cgroup; then
+        echo "== $cgroup (cgroup v$ver): cannot set up the cgroup, skipped"
+        errors+=" $cgroup"
+        continue
+    fi
+    eval "ver_$cgroup=$ver base_$cgroup=\"$base\" procs_$cgroup=\"$procs\""
+    ready+=("$cgroup")
+done
+
+# measure them all at once
+tmp=$(mktemp -d) || exit_error
+prepend_cleanup "rm -rf \"$tmp\""
+for cgroup in "${ready[@]}"; do
+    eval "ver=\$ver_$cgroup base=\$base_$cgroup procs=\$procs_$cgroup"
+    ( measure_$cgroup ) >"$tmp/$cgroup" 2>&1 &
+    eval "pid_$cgroup=$!"
+done
+
+failed=
+for cgroup in "${ready[@]}"; do
+    eval "wait \$pid_$cgroup"
+    rc=$?
+    eval "echo \"== $cgroup (cgroup v\$ver_$cgroup): rc=$rc\""
+    cat "$tmp/$cgroup"
+    case $rc in
+        0) ;;
+        1) failed+=" $cgroup" ;;
+        *) errors+=" $cgroup" ;;
+    esac
+done
+
+[ -z "$failed" ] || exit_fail "limits not enforced:$failed${errors:+, cannot measure:$errors}"
+[ -z "$errors" ] || exit_error "cannot measure:$errors"
 exit_pass
 
 # vim: sts=4 sw=4 et :
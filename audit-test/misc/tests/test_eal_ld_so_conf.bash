@@ -29,37 +29,31 @@
 source testcase.bash || exit 2
 
 LOG="ldsoconf.run.log"
+EXE="checkaccess"
 FILE="/etc/ld.so.conf"
+ROOTS=
 
 echo "Check $FILE access" &> $LOG
 if [ -e $FILE ]; then
-	ls -l $FILE | awk '{
-		if ($1 != "-rw-r--r--." || $3 != "root") {
-			print $9, "\tFAIL"
-		} else {
-			print $9, "\tPASS"
-		}
-	}' >> $LOG
+	ROOTS=$FILE
 else
 	echo "$FILE file does not exist." >> $LOG
 fi
 
+# the directories included from it, with the files in them
+for LDDIR in `awk '$1 == "include" {print $2}' $FILE 2>/dev/null | sed -e 's/*.*//'`; do
+	case $LDDIR in
+		/*) LDCONFDIR=$LDDIR ;;
+		*)  LDCONFDIR="/etc/$LDDIR" ;;
+	esac
+	[ -d $LDCONFDIR ] && ROOTS+=" $LDCONFDIR"
+done
 
-LDDIR=`cat /etc/ld.so.conf | awk '{print $2}' | sed -e 's/*.*//'`
-LDCONFDIR="/etc/$LDDIR"
-
-echo "Check directories listed in $FPATH" >> $LOG
-ls -ld $LDCONFDIR 2>/dev/null | awk '{
-       if ($1 != "drwxr-xr-x." || $3 != "root") {
-               print $9, "\tFAIL"
-       } else {
-               print $9, "\tPASS"
-       }
-}' >> $LOG
-
+echo "Check $ROOTS" >> $LOG
+[ -z "$ROOTS" ] || ./$EXE -s $ROOTS >> $LOG 2>&1
 
 retval+=`grep "FAIL" $LOG | wc -l`
-echo "TEST PASSED = " `grep "PASS" $LOG | wc -l` " , FAILED = " $retval
+echo "TEST PASSED = " `sed -n 's/.* passed=\([0-9]*\) .*/\1/p' $LOG` " , FAILED = " $retval
 
 #Checking status of return value
 if [ $retval -gt 0 ]; then
@@ -32,16 +32,16 @@ EXE="checkaccess"
 FILE="/etc/modprobe.conf"
 MODULE_DIR="/etc/modprobe.d"
 
+# both in one run, into one log
 if [ -e $FILE ]; then
-	./$EXE $FILE &> $LOG
+	./$EXE -s $FILE $MODULE_DIR &> $LOG
 else
 	echo "$FILE file does not exist."
+	./$EXE -s $MODULE_DIR &> $LOG
 fi
 
-./$EXE $MODULE_DIR &> $LOG
-
 retval+=`grep "FAIL" $LOG | wc -l`
-echo "TEST PASSED = " `grep "PASS" $LOG | wc -l` " , FAILED = " $retval
+echo "TEST PASSED = " `sed -n 's/.* passed=\([0-9]*\) .*/\1/p' $LOG` " , FAILED = " $retval
 
 #Checking status of return value
 if [ $retval -gt 0 ]; then
@@ -31,10 +31,10 @@ LOG="modules.conf01.run.log"
 EXE="checkaccess"
 MODULE_DIR="/lib/modules/`uname -r`"
 
-./$EXE $MODULE_DIR &> $LOG
+./$EXE -s $MODULE_DIR &> $LOG
 
 retval+=`grep "FAIL" $LOG | wc -l`
-echo "TEST PASSED = " `grep "PASS" $LOG | wc -l` " , FAILED = " $retval
+echo "TEST PASSED = " `sed -n 's/.* passed=\([0-9]*\) .*/\1/p' $LOG` " , FAILED = " $retval
 
 #Checking status of return value
 if [ $retval -gt 0 ]; then
@@ -30,10 +30,10 @@ source testcase.bash || exit 2
 LOG="sysconfig.run.log"
 EXE="checkaccess"
 
-./$EXE /etc/sysconfig &> $LOG
+./$EXE -s /etc/sysconfig &> $LOG
 
 retval+=`grep "FAIL" $LOG | wc -l`
-echo "TEST PASSED = " `grep "PASS" $LOG | wc -l` " , FAILED = " $retval
+echo "TEST PASSED = " `sed -n 's/.* passed=\([0-9]*\) .*/\1/p' $LOG` " , FAILED = " $retval
 
 #Checking status of return value
 if [ $retval -gt 0 ]; then
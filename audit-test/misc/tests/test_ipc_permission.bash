@@ -95,8 +95,9 @@ function delete_group(){
 create_group
 create_user
 
-./$FILENAME $TEST_USER $TEST_USER2 &> $FILENAME.log
-[ $? -eq 0 ] || exit_error "Test program failed to execute"
+# any options for the test program come after its name
+./$FILENAME "${@:2}" $TEST_USER $TEST_USER2 &> $FILENAME.log
+[ $? -le 1 ] || exit_error "Test program failed to execute"
 
 delete_user
 delete_group
@@ -28,13 +28,17 @@
 source testcase.bash || exit 2
 
 FILENAME=$1
+shift
 
 #
 #main
 #
 
-./$FILENAME &> $FILENAME.log
-[ $? -eq 0 ] || exit_fail "Test program failed to execute"
+# the remaining arguments are for the test program, ie. objreuse-stress
+./$FILENAME "$@" &> $FILENAME.log
+RET=$?
+cat $FILENAME.log
+[ $RET -eq 0 ] || exit_fail "Test program failed to execute"
 
 retval=`grep "FAIL" $FILENAME.log | wc -l`
 echo "TEST PASSED = " `grep "PASS" $FILENAME.log | wc -l` ", FAILED = " $retval >> $FILENAME.log
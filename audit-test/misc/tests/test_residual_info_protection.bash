@@ -28,23 +28,44 @@
 # TESTS:
 #  fs - test all available filesystems (using sparse-file.c)
 #
+# Named arguments (all optional):
+#  fstypes=FS[,FS..]  filesystem types to test, default all mounted rw ones
+#  hole=SIZE          size of the hole, ie. 4G, default about 10M
+#  full=1             read the real holes completely, not one page per MiB
+#
 
 source testcase.bash
 
+eval "$(parse_named "$@")" || exit_error "parse_named failed"
+set -- "${unnamed[@]}"
+
 # test all available file systems via sparse file
 test_fs() {
     local FSTYPES=$(mount | grep rw | sed 's|.*type \([[:alnum:]]*\).*|\1|g' | \
         sort | uniq | egrep -v "(binfmt|autofs)")
     local FS= TPATH=
+    local OPTS=( ${hole:+-s $hole} ${full:+-f} )
     local EXIT_MSGS=
 
+    [ -n "$fstypes" ] && FSTYPES=${fstypes//,/ }
+
     for FS in $FSTYPES; do
         TPATH=$(mount | grep -m1 " $FS.*rw" | awk '{print $3}')
+        if [ -z "$TPATH" ]; then
+            echo ":: No writable '$FS' filesystem mounted, skipping"
+            continue
+        fi
         echo ":: Testing filesystem '$FS' on mount point '$TPATH'"
-        ./sparse_file $TPATH; RET=$?
+        ./sparse_file "${OPTS[@]}" $TPATH; RET=$?
         case $RET in
             255) EXIT_MSGS=$(printf "%s\n%s" "$EXIT_MSGS" "Sparse files are not correct on $FS filesystem") ;;
             1|3) echo "Filesystem is not writable, skipping" ;;
+            9)
+                # only a hole size the user asked for may be too large
+                [ -n "$hole" ] || \
+                    exit_error "Filesystem $FS does not support the default file size"
+                echo "Filesystem does not support files of this size, skipping"
+                ;;
             5) echo "Filesystem seems full, skipping" ;;
             # just do nothing if test passes
             0) : ;;
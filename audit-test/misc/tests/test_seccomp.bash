@@ -60,6 +60,85 @@ update_results()
 [ -x "./seccomp" ] || exit_error "./seccomp not found/executable"
 
 
+# filter cost benchmark, only on request (see README.run): the per-call
+# cost of filters of growing size in both layouts, with and without
+# logging the benchmarked syscall, and the rate of the SECCOMP records the
+# logging produces, all with one thread per CPU
+bench_field()
+{
+	sed -n "s/.* $1=\([0-9]*\).*/\1/p" <<<"$2"
+}
+if [ "$1" = "bench" ]; then
+	duration=${2:-5}
+	threads=$(nproc)
+
+	out=$(./seccomp bench -l none -t $threads -d $duration) || \
+		exit_error "unfiltered run failed"
+	echo "$out"
+	base=$(bench_field ns_per_call "$out")
+
+	# every logged call is an audit record, with failure=2 any records lost
+	# to the backlog or rate limit would panic the system
+	log_runs="0 1"
+	if ! grep -qw log /proc/sys/kernel/seccomp/actions_logged 2>/dev/null; then
+		echo "SCMP_ACT_LOG not logged by the kernel, skipping the log runs"
+		log_runs=0
+	elif [ "$(auditctl -s | awk '$1 == "failure" {print $2}')" = 2 ]; then
+		echo "audit failure mode is panic, skipping the log runs"
+		log_runs=0
+	else
+		# millions of records, neither rotate the log in the middle of
+		# a run nor let the space actions halt the system, as in the
+		# fail-safe tests
+		append_cleanup "restart_service auditd"
+		backup "$auditd_conf"	# restore done via prepend_cleanup
+		write_config -s "$auditd_conf" \
+			max_log_file=4096 \
+			max_log_file_action=IGNORE \
+			space_left_action=IGNORE \
+			admin_space_left_action=IGNORE \
+			disk_full_action=IGNORE \
+			disk_error_action=IGNORE
+		restart_service auditd || exit_error "cannot restart auditd"
+	fi
+
+	for rules in 16 64 256 1024; do
+		for layout in linear tree; do
+			for log in $log_runs; do
+				logopt=
+				[ "$log" = 1 ] && logopt=-L
+				audit_mark
+				lost=$(auditctl -s | awk '$1 == "lost" {print $2}')
+				out=$(./seccomp bench -n $rules -l $layout $logopt \
+				      -t $threads -d $duration)
+				case $? in
+					0) ;;
+					3) echo "rules=$rules layout=$layout log=$log" \
+					        "unsupported by libseccomp, skipped"
+					   continue ;;
+					*) exit_error "seccomp bench failed" ;;
+				esac
+				# wait for auditd to write all the records out,
+				# augrok is too slow for millions of them
+				prev= records=-1
+				while [ "$records" != "$prev" ]; do
+					prev=$records
+					sleep 1
+					records=$(tail -c +$((AUDIT_MARK + 1)) "$audit_log" | \
+					          grep -c "type=SECCOMP")
+				done
+				lost=$(($(auditctl -s | awk '$1 == "lost" {print $2}') - lost))
+				echo "$out overhead_ns=$(($(bench_field ns_per_call "$out") - base))" \
+				     "audit_records=$records" \
+				     "audit_records_per_sec=$((records / duration))" \
+				     "audit_lost=$lost"
+			done
+		done
+	done
+	exit_pass
+fi
+
+
 # loop over the available syscalls, running all tests on each
 for syscall in dup2 open
 do
@@ -38,7 +38,7 @@ DIRECTORY=$2
 # main
 #
 
-./$FILENAME /$DIRECTORY $TEST_USER $TEST_USER &> $FILENAME.$DIRECTORY.log
+./$FILENAME "${@:3}" /$DIRECTORY $TEST_USER $TEST_USER &> $FILENAME.$DIRECTORY.log
 [ $? -eq 0 ] || exit_error "Test program failed to execute"
 
 retval=`grep -v "FAILED" $FILENAME.$DIRECTORY.log | grep "result: FAIL" | wc -l`
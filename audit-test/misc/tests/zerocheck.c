@@ -0,0 +1,173 @@
+/* zerocheck.c - all-zero checks for the object reuse tests
+ *
+ * See zerocheck.h.  The vector loops only tell whether a 64 byte block is
+ * all zero, the scalar tail loop then finds the exact offset.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "zerocheck.h"
+
+#define BLOCK		64
+#define CHUNK		(1 << 20)	/* zero_span_fd() read size */
+
+/* number of leading bytes in whole zero blocks */
+typedef size_t (*span_fn)(const unsigned char *, size_t);
+
+static size_t
+span_bytes(const unsigned char *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len && buf[i] == 0; i++)
+		;
+	return i;
+}
+
+static size_t
+span_words(const unsigned char *buf, size_t len)
+{
+	size_t i, j;
+	unsigned long w[BLOCK / sizeof(unsigned long)], acc;
+
+	for (i = 0; i + BLOCK <= len; i += BLOCK) {
+		memcpy(w, buf + i, BLOCK);
+		for (j = 0, acc = 0; j < BLOCK / sizeof(unsigned long); j++)
+			acc |= w[j];
+		if (acc)
+			break;
+	}
+	return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+static size_t
+span_sse2(const unsigned char *buf, size_t len)
+{
+	size_t i;
+	__m128i v;
+
+	for (i = 0; i + BLOCK <= len; i += BLOCK) {
+		v = _mm_or_si128(
+			_mm_or_si128(_mm_loadu_si128((const __m128i *)(buf + i)),
+				     _mm_loadu_si128((const __m128i *)(buf + i + 16))),
+			_mm_or_si128(_mm_loadu_si128((const __m128i *)(buf + i + 32)),
+				     _mm_loadu_si128((const __m128i *)(buf + i + 48))));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()))
+		    != 0xffff)
+			break;
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+span_avx2(const unsigned char *buf, size_t len)
+{
+	size_t i;
+	__m256i v;
+
+	for (i = 0; i + BLOCK <= len; i += BLOCK) {
+		v = _mm256_or_si256(
+			_mm256_loadu_si256((const __m256i *)(buf + i)),
+			_mm256_loadu_si256((const __m256i *)(buf + i + 32)));
+		if (!_mm256_testz_si256(v, v))
+			break;
+	}
+	return i;
+}
+#elif defined(__aarch64__)
+static size_t
+span_neon(const unsigned char *buf, size_t len)
+{
+	size_t i;
+	uint8x16_t v;
+
+	for (i = 0; i + BLOCK <= len; i += BLOCK) {
+		v = vorrq_u8(vorrq_u8(vld1q_u8(buf + i), vld1q_u8(buf + i + 16)),
+			     vorrq_u8(vld1q_u8(buf + i + 32),
+				      vld1q_u8(buf + i + 48)));
+		if (vmaxvq_u8(v))
+			break;
+	}
+	return i;
+}
+#endif
+
+/* pick the widest implementation the CPU supports, once */
+static span_fn
+span_select(void)
+{
+	static span_fn fn;
+
+	if (fn)
+		return fn;
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (getenv("ZEROCHECK_SCALAR"))
+		fn = span_words;
+	else if (__builtin_cpu_supports("avx2"))
+		fn = span_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		fn = span_sse2;
+	else
+		fn = span_words;
+#elif defined(__aarch64__)
+	fn = getenv("ZEROCHECK_SCALAR") ? span_words : span_neon;
+#else
+	fn = span_words;
+#endif
+	return fn;
+}
+
+size_t
+zero_span(const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	size_t i;
+
+	i = span_select()(p, len);
+	return i + span_bytes(p + i, len - i);
+}
+
+off_t
+zero_span_fd(int fd, off_t off, off_t len, off_t *nread)
+{
+	static __thread unsigned char *buf;
+	off_t done = 0;
+	ssize_t r;
+	size_t span;
+
+	if (!buf && !(buf = malloc(CHUNK)))
+		return -1;
+
+	*nread = 0;
+	while (done < len) {
+		r = pread(fd, buf, (len - done < CHUNK) ? len - done : CHUNK,
+			  off + done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (r == 0)
+			break;
+		*nread += r;
+		span = zero_span(buf, r);
+		done += span;
+		if (span < r)
+			break;
+	}
+	return done;
+}
@@ -0,0 +1,51 @@
+/* zerocheck.h - all-zero checks for the object reuse tests
+ *
+ * zero_span() returns the number of leading zero bytes of a buffer, ie. the
+ * offset of the first non-zero byte or the buffer size if all of it is zero.
+ * It works on whole vectors (AVX2 or SSE2 on x86, NEON on ARM64, machine
+ * words elsewhere) and looks at single bytes only to locate a non-zero one.
+ *
+ * zero_span_fd() does the same for a file range, reading it in large
+ * chunks with pread().  It stops early at end-of-file, *nread is set to the
+ * number of bytes actually read, so a result equal to *nread means that
+ * everything read was zero.  Returns -1 (with errno set) on read errors.
+ * It keeps a read buffer per thread.
+ *
+ * DIE_UNLESS_ZERO() fails the test like the testmacros.h checks, reporting
+ * the offset of the first non-zero byte.  DIE_UNLESS_ZERO_FD() does the same
+ * for the first len bytes of a file, or up to end-of-file if it is shorter,
+ * and fails on read errors too.
+ */
+
+#ifndef _ZEROCHECK_H
+#define _ZEROCHECK_H
+
+#include <sys/types.h>
+#include <stddef.h>
+
+#include "testmacros.h"
+
+size_t zero_span(const void *buf, size_t len);
+off_t zero_span_fd(int fd, off_t off, off_t len, off_t *nread);
+
+#define DIE_UNLESS_ZERO(buf, len) do { \
+	size_t _off = zero_span((buf), (len)); \
+	if (_off < (size_t)(len)) { \
+		_MSGN; fprintf(stderr, "non-zero byte at offset %zu of %zu\n", \
+			       _off, (size_t)(len)); \
+		exit(1); \
+	} } while(0)
+
+#define DIE_UNLESS_ZERO_FD(fd, len) do { \
+	off_t _got, _off = zero_span_fd((fd), 0, (len), &_got); \
+	if (_off < 0) { \
+		_MSGN; perror("zero_span_fd"); \
+		exit(1); \
+	} \
+	if (_off < _got) { \
+		_MSGN; fprintf(stderr, "non-zero byte at offset %lld of %lld\n", \
+			       (long long)_off, (long long)(len)); \
+		exit(1); \
+	} } while(0)
+
+#endif /* _ZEROCHECK_H */
@@ -20,6 +20,7 @@
 # This file is identical to the one in the network directory by the same name
 # however two new routines have been added to support the network filtering
 # functional testing.  Those routines are do_ping, and do_nc.
+# Both send their packets with nf_probe (see tests/nf_probe.c).
 #
 
 source testcase.bash || exit 2
@@ -107,28 +108,33 @@ function get_sockcall_num_hex {
     printf "%x" $(get_sockcall_num $1)
 }
 
+# usage: do_probe [nf_probe options] <probe>[,<probe>...] <addr> [<addr>...]
+#  send a matrix of probes with nf_probe, one batch for all of them rather
+#  than a ping or netcat timeout per packet
+function do_probe {
+    "$TOPDIR/netfilter/tests/nf_probe" "$@"
+}
+
 # send a ping so we can test filtering on ICMP packets
 function do_ping {
    declare ipv_arg=$2 host_arg=$3 intf=$4
-   declare rc
+   declare rc addr proto port res cnt
+   declare -a opts=(-n 3 -t 3)
    case $ipv_arg in
         ipv4)
-            rc=$(ping -c 3 -w 3 "$1" | grep -cw 0%)
             ;;
         ipv6)
-            if [[ $host_arg == local ]]; then
-                 rc=$(ping6 -c 3 -w 3 "$1" | grep -cw 0%)
-            else
-                 rc=$(ping6 -I $intf -c 3 -w 3 "$1" | grep -cw 0%)
-            fi
+            [[ $host_arg == local ]] || opts+=(-I $intf)
             ;;
            *)
             exit_error
             ;;
    esac
+   read addr proto port res cnt <<< "$(do_probe "${opts[@]}" icmp "$1")"
 
    pidnum=$(ps -C run.bash -o pid=)
-   if [[ $rc != 0 ]]; then
+   # all three echo requests answered, as "0% packet loss" from ping
+   if [[ $cnt == 3/3 ]]; then
      rc=0
      printf "%d %d %d\n", "$rc" "$rc" "$pidnum"
    else
@@ -138,9 +144,10 @@ function do_ping {
    return $rc
    }
 
-# This function causes netcat data to be sent. Doing this over the local
-# loopback device allows us to generate various TCP flags and states we
-# need to test in the filtering
+# This function opens a TCP connection to generate various TCP flags and
+# states we need to test in the filtering, over the local loopback device.
+# The connection is refused (RST) or, if there is a listener, the data string
+# is sent (PSH) and the connection closed (FIN).
 
 function do_nc {
    declare ipv_arg=$2 tnum=$3 port=$4
@@ -149,19 +156,9 @@ function do_nc {
    case $ipv_arg in
         # for tnum 47,48 - listening is set up by setup_default on port 4100
         # for tnum 45,46 - lblnet_tst_server on port 4000 is used
-        ipv4)
-            if [[ $tnum == 47 ]]; then
-               rc="$(nc -w 3 "$1" "$port" <<< $data_str)"
-            else
-               rc="$(nc -w 3 "$1" "$port")"
-            fi
-            ;;
-        ipv6)
-            if [[ $tnum == 48 ]]; then
-               rc="$(nc -6 -w 3 "$1" "$port" <<< $data_str)"
-            else
-               rc="$(nc -6 -w 3 "$1" "$port")"
-            fi
+        ipv4|ipv6)
+            do_probe -t 3 -q -d "$data_str" tcp:$port "$1" >/dev/null
+            rc=$?
             ;;
            *)
             exit_error
@@ -169,11 +166,8 @@ function do_nc {
    esac
 
    pidnum=$(ps -C run.bash -o pid=)
-   if [[ 46 < $tnum && $tnum < 49 ]]; then
-      printf "%d %d %d\n", "$rc" "$rc" "$pidnum"
-      return $rc
-   fi
-   if [[ $rc != 0 ]]; then
+   # the packets went out, whether the connection was accepted or not
+   if ((rc <= 1)); then
      rc=0
      printf "%d %d %d\n", "$rc" "$rc" "$pidnum"
    else
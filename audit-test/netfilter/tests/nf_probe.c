@@ -0,0 +1,800 @@
+/*  Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of version 2 the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * nf_probe - send probes across a protocol/port/address matrix
+ *
+ * usage: nf_probe [-t <secs>] [-n <count>] [-d <data>] [-I <ifname>] [-q]
+ *                 [-S] <probe>[,<probe>...] <addr> [<addr>...]
+ *
+ * probes:
+ *
+ *  icmp               ICMP (ICMPv6) echo request
+ *  udp:<port>[-<port>] UDP datagram with <data>
+ *  tcp:<port>[-<port>] TCP connection, sending <data> (if not empty) once
+ *                     connected
+ *
+ * Every probe is sent to every address, <count> times for ICMP and UDP.  The
+ * ICMP and UDP probes go out in batches with sendmmsg(), all the TCP
+ * connections are started at once, and the replies are collected with
+ * recvmmsg() / poll() until all the probes are answered or the timeout
+ * (default 3 seconds) expires, so a whole ruleset is checked in one pass
+ * rather than with a netcat or ping timeout per cell.
+ *
+ * One line is printed for each cell of the matrix:
+ *
+ *  <addr> icmp|udp|tcp <port>|- reply|refused|none <answered>/<sent>
+ *
+ * "reply" means an echo reply, UDP data or an accepted connection,
+ * "refused" an ICMP error or a TCP reset and "none" that nothing came back,
+ * ie. the probe (or its reply) was dropped.  -q prints nothing but the
+ * summary, -S adds a summary line:
+ *
+ *  sent=<n> answered=<n> usecs=<n> pps=<n>
+ *
+ * The exit status is 0 if every cell got an answer, 1 if some did not and
+ * 2 on errors.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/icmp6.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/errqueue.h>
+
+#define VLEN                    64      /* datagrams per syscall */
+#define MSG_SIZE_MAX            65536
+#define TCP_OPEN_MAX            512     /* connections in progress */
+#define DATA_DEFAULT            "nf_probe"
+
+/* cell results */
+#define RES_NONE                0
+#define RES_REFUSED             1
+#define RES_REPLY               2
+
+const char *res_name[] = { "none", "refused", "reply" };
+
+/* one cell of the matrix */
+struct cell {
+	struct sockaddr_storage addr;   /* including the port */
+	socklen_t addr_len;
+	int proto;                      /* IPPROTO_ICMP, _UDP or _TCP */
+	int port;                       /* 0 for ICMP */
+	int sock;                       /* TCP connection, -1 if none */
+	unsigned int sent;
+	unsigned int answered;
+	int result;
+};
+
+/* datagram sockets, per address family */
+struct dgram {
+	int family;
+	int proto;
+	int sock;
+};
+
+/* command line */
+unsigned int timeout_sec = 3;
+unsigned int count = 1;
+const char *data = DATA_DEFAULT;
+const char *ifname = NULL;
+int quiet = 0;
+int summary = 0;
+
+struct cell *cells = NULL;
+unsigned int cell_cnt = 0;
+struct dgram dgrams[4];
+unsigned int dgram_cnt = 0;
+uint16_t probe_id;
+
+/**
+ * fatal - Print an error message with the errno description and exit
+ * @msg: message
+ *
+ */
+void fatal(const char *msg)
+{
+	perror(msg);
+	exit(2);
+}
+
+/**
+ * die - Print an error message and exit
+ * @msg: message
+ *
+ */
+void die(const char *msg)
+{
+	fprintf(stderr, "error: %s\n", msg);
+	exit(2);
+}
+
+/**
+ * time_us - Get the current monotonic time in microseconds
+ *
+ */
+long long time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * addr_port - Get the port of a socket address
+ *
+ */
+int addr_port(const struct sockaddr_storage *addr)
+{
+	if (addr->ss_family == AF_INET)
+		return ntohs(((struct sockaddr_in *)addr)->sin_port);
+	return ntohs(((struct sockaddr_in6 *)addr)->sin6_port);
+}
+
+/**
+ * addr_eq - Compare the addresses (not the ports) of two socket addresses
+ *
+ */
+int addr_eq(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+	if (a->ss_family != b->ss_family)
+		return 0;
+	if (a->ss_family == AF_INET)
+		return (((struct sockaddr_in *)a)->sin_addr.s_addr ==
+			((struct sockaddr_in *)b)->sin_addr.s_addr);
+	return (memcmp(&((struct sockaddr_in6 *)a)->sin6_addr,
+		       &((struct sockaddr_in6 *)b)->sin6_addr,
+		       sizeof(struct in6_addr)) == 0);
+}
+
+/**
+ * cell_find - Find the cell of a reply
+ * @proto: protocol
+ * @addr: remote address
+ * @port: remote port, ignored for ICMP
+ *
+ * Description:
+ * Returns the cell or NULL if the reply is not for any of them.
+ *
+ */
+struct cell *cell_find(int proto, const struct sockaddr_storage *addr,
+		       int port)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < cell_cnt; iter++)
+		if (cells[iter].proto == proto &&
+		    (proto == IPPROTO_ICMP || cells[iter].port == port) &&
+		    addr_eq(&cells[iter].addr, addr))
+			return &cells[iter];
+	return NULL;
+}
+
+/**
+ * cell_answer - Record an answer to a probe
+ * @cell: cell
+ * @result: RES_REPLY or RES_REFUSED
+ *
+ */
+void cell_answer(struct cell *cell, int result)
+{
+	if (cell->answered < cell->sent)
+		cell->answered++;
+	if (result > cell->result)
+		cell->result = result;
+}
+
+/**
+ * dgram_sock - Get the datagram socket for a cell
+ * @cell: cell, ICMP or UDP
+ *
+ */
+int dgram_sock(struct cell *cell)
+{
+	unsigned int iter;
+	struct dgram *dg;
+	int on = 1;
+	int family = cell->addr.ss_family;
+
+	for (iter = 0; iter < dgram_cnt; iter++)
+		if (dgrams[iter].family == family &&
+		    dgrams[iter].proto == cell->proto)
+			return dgrams[iter].sock;
+
+	dg = &dgrams[dgram_cnt++];
+	dg->family = family;
+	dg->proto = cell->proto;
+	if (cell->proto == IPPROTO_UDP) {
+		dg->sock = socket(family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+		if (dg->sock < 0)
+			fatal("socket");
+		/* the ICMP errors tell the closed and rejected ports */
+		if (family == AF_INET)
+			setsockopt(dg->sock, IPPROTO_IP, IP_RECVERR,
+				   &on, sizeof(on));
+		else
+			setsockopt(dg->sock, IPPROTO_IPV6, IPV6_RECVERR,
+				   &on, sizeof(on));
+	} else {
+		dg->sock = socket(family, SOCK_RAW | SOCK_NONBLOCK,
+				  (family == AF_INET ?
+				   IPPROTO_ICMP : IPPROTO_ICMPV6));
+		if (dg->sock < 0)
+			fatal("socket");
+	}
+	if (ifname != NULL &&
+	    setsockopt(dg->sock, SOL_SOCKET, SO_BINDTODEVICE,
+		       ifname, strlen(ifname) + 1) < 0)
+		fatal("SO_BINDTODEVICE");
+
+	return dg->sock;
+}
+
+/**
+ * icmp_cksum - Compute the ICMP (v4) checksum
+ *
+ */
+uint16_t icmp_cksum(const void *buf, size_t len)
+{
+	const uint16_t *word = buf;
+	uint32_t sum = 0;
+
+	for (; len > 1; len -= 2)
+		sum += *word++;
+	if (len == 1)
+		sum += *(const uint8_t *)word;
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+
+	return ~sum;
+}
+
+/**
+ * send_dgrams - Send the ICMP and UDP probes
+ * @sock: datagram socket
+ * @family: address family of @sock
+ * @proto: IPPROTO_ICMP or IPPROTO_UDP
+ *
+ * Description:
+ * Send <count> probes to every cell of @sock, VLEN datagrams per sendmmsg().
+ * Returns the number of datagrams sent.
+ *
+ */
+unsigned int send_dgrams(int sock, int family, int proto)
+{
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovs[VLEN];
+	struct cell *batch[VLEN];
+	unsigned char pkts[VLEN][sizeof(struct icmphdr) + 64];
+	unsigned int iter, round, vlen, sent = 0;
+	size_t data_len = strlen(data);
+	struct icmphdr *icmp4;
+	struct icmp6_hdr *icmp6;
+	struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+	int rc, done;
+
+	if (data_len > 64 && proto == IPPROTO_ICMP)
+		data_len = 64;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (round = 0; round < count; round++) {
+		iter = 0;
+		while (iter < cell_cnt) {
+			/* fill the batch */
+			for (vlen = 0; vlen < VLEN && iter < cell_cnt; iter++) {
+				struct cell *cell = &cells[iter];
+
+				if (cell->proto != proto ||
+				    cell->addr.ss_family != family)
+					continue;
+				batch[vlen] = cell;
+				msgs[vlen].msg_hdr.msg_name = &cell->addr;
+				msgs[vlen].msg_hdr.msg_namelen = cell->addr_len;
+				msgs[vlen].msg_hdr.msg_iov = &iovs[vlen];
+				msgs[vlen].msg_hdr.msg_iovlen = 1;
+				if (proto == IPPROTO_UDP) {
+					iovs[vlen].iov_base = (char *)data;
+					iovs[vlen].iov_len = data_len;
+				} else if (family == AF_INET) {
+					icmp4 = (struct icmphdr *)pkts[vlen];
+					memset(icmp4, 0, sizeof(*icmp4));
+					icmp4->type = ICMP_ECHO;
+					icmp4->un.echo.id = htons(probe_id);
+					icmp4->un.echo.sequence =
+						htons(cell - cells);
+					memcpy(icmp4 + 1, data, data_len);
+					icmp4->checksum = icmp_cksum(icmp4,
+						sizeof(*icmp4) + data_len);
+					iovs[vlen].iov_base = icmp4;
+					iovs[vlen].iov_len =
+						sizeof(*icmp4) + data_len;
+				} else {
+					/* the kernel does the checksum */
+					icmp6 = (struct icmp6_hdr *)pkts[vlen];
+					memset(icmp6, 0, sizeof(*icmp6));
+					icmp6->icmp6_type = ICMP6_ECHO_REQUEST;
+					icmp6->icmp6_id = htons(probe_id);
+					icmp6->icmp6_seq = htons(cell - cells);
+					memcpy(icmp6 + 1, data, data_len);
+					iovs[vlen].iov_base = icmp6;
+					iovs[vlen].iov_len =
+						sizeof(*icmp6) + data_len;
+				}
+				vlen++;
+			}
+
+			/* send it, waiting for room in the socket buffer */
+			for (done = 0; done < vlen; done += rc) {
+				rc = sendmmsg(sock, msgs + done, vlen - done, 0);
+				if (rc < 0) {
+					if (errno == EAGAIN || errno == ENOBUFS) {
+						poll(&pfd, 1, 10);
+						rc = 0;
+						continue;
+					}
+					if (errno == EINTR) {
+						rc = 0;
+						continue;
+					}
+					/* e.g. EPERM from an OUTPUT rule, the
+					 * probe is dropped */
+					rc = 1;
+					batch[done]->sent++;
+					continue;
+				}
+				for (int i = done; i < done + rc; i++)
+					batch[i]->sent++;
+				sent += rc;
+			}
+		}
+	}
+
+	return sent;
+}
+
+/**
+ * recv_dgrams - Receive the replies on a datagram socket
+ * @dg: datagram socket
+ *
+ */
+void recv_dgrams(struct dgram *dg)
+{
+	static unsigned char bufs[VLEN][MSG_SIZE_MAX / VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovs[VLEN];
+	struct sockaddr_storage addrs[VLEN];
+	struct cell *cell;
+	unsigned char *pkt;
+	size_t len;
+	int rc, iter;
+	unsigned int seq;
+
+	for (;;) {
+		memset(msgs, 0, sizeof(msgs));
+		for (iter = 0; iter < VLEN; iter++) {
+			iovs[iter].iov_base = bufs[iter];
+			iovs[iter].iov_len = sizeof(bufs[iter]);
+			msgs[iter].msg_hdr.msg_iov = &iovs[iter];
+			msgs[iter].msg_hdr.msg_iovlen = 1;
+			msgs[iter].msg_hdr.msg_name = &addrs[iter];
+			msgs[iter].msg_hdr.msg_namelen = sizeof(addrs[iter]);
+		}
+		rc = recvmmsg(dg->sock, msgs, VLEN, MSG_DONTWAIT, NULL);
+		if (rc <= 0)
+			return;
+
+		for (iter = 0; iter < rc; iter++) {
+			pkt = bufs[iter];
+			len = msgs[iter].msg_len;
+			if (dg->proto == IPPROTO_UDP) {
+				cell = cell_find(IPPROTO_UDP, &addrs[iter],
+						 addr_port(&addrs[iter]));
+				if (cell != NULL)
+					cell_answer(cell, RES_REPLY);
+				continue;
+			}
+
+			/* raw ICMP gets all the echo replies on the host */
+			if (dg->family == AF_INET) {
+				struct iphdr *ip = (struct iphdr *)pkt;
+				struct icmphdr *icmp;
+
+				if (len < sizeof(*ip) ||
+				    len < ip->ihl * 4 + sizeof(*icmp))
+					continue;
+				icmp = (struct icmphdr *)(pkt + ip->ihl * 4);
+				if (icmp->type != ICMP_ECHOREPLY ||
+				    ntohs(icmp->un.echo.id) != probe_id)
+					continue;
+				seq = ntohs(icmp->un.echo.sequence);
+			} else {
+				struct icmp6_hdr *icmp6;
+
+				icmp6 = (struct icmp6_hdr *)pkt;
+				if (len < sizeof(*icmp6) ||
+				    icmp6->icmp6_type != ICMP6_ECHO_REPLY ||
+				    ntohs(icmp6->icmp6_id) != probe_id)
+					continue;
+				seq = ntohs(icmp6->icmp6_seq);
+			}
+			if (seq < cell_cnt && cells[seq].proto == IPPROTO_ICMP &&
+			    addr_eq(&cells[seq].addr, &addrs[iter]))
+				cell_answer(&cells[seq], RES_REPLY);
+		}
+	}
+}
+
+/**
+ * recv_errors - Receive the ICMP errors on a UDP socket
+ * @dg: datagram socket
+ *
+ * Description:
+ * The error queue has the original destination of the datagram, ie. the
+ * cell, in the message name.
+ *
+ */
+void recv_errors(struct dgram *dg)
+{
+	struct msghdr msg;
+	struct sockaddr_storage addr;
+	char ctl[512];
+	char buf[64];
+	struct iovec iov = { buf, sizeof(buf) };
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *ee;
+	struct cell *cell;
+
+	for (;;) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = &addr;
+		msg.msg_namelen = sizeof(addr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = ctl;
+		msg.msg_controllen = sizeof(ctl);
+		if (recvmsg(dg->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			return;
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (!((cmsg->cmsg_level == IPPROTO_IP &&
+			       cmsg->cmsg_type == IP_RECVERR) ||
+			      (cmsg->cmsg_level == IPPROTO_IPV6 &&
+			       cmsg->cmsg_type == IPV6_RECVERR)))
+				continue;
+			ee = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if (ee->ee_origin != SO_EE_ORIGIN_ICMP &&
+			    ee->ee_origin != SO_EE_ORIGIN_ICMP6)
+				continue;
+			cell = cell_find(IPPROTO_UDP, &addr, addr_port(&addr));
+			if (cell != NULL)
+				cell_answer(cell, RES_REFUSED);
+		}
+	}
+}
+
+/**
+ * tcp_start - Start the connection of a TCP cell
+ * @cell: cell
+ *
+ * Description:
+ * Returns 1 if the connection is in progress, 0 if it is already over.
+ *
+ */
+int tcp_start(struct cell *cell)
+{
+	cell->sent = 1;
+	cell->sock = socket(cell->addr.ss_family,
+			    SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (cell->sock < 0)
+		fatal("socket");
+	if (ifname != NULL &&
+	    setsockopt(cell->sock, SOL_SOCKET, SO_BINDTODEVICE,
+		       ifname, strlen(ifname) + 1) < 0)
+		fatal("SO_BINDTODEVICE");
+
+	if (connect(cell->sock, (struct sockaddr *)&cell->addr,
+		    cell->addr_len) == 0 || errno == EINPROGRESS)
+		return 1;
+
+	cell_answer(cell, (errno == ECONNREFUSED || errno == EHOSTUNREACH ||
+			   errno == ENETUNREACH ? RES_REFUSED : RES_NONE));
+	close(cell->sock);
+	cell->sock = -1;
+	return 0;
+}
+
+/**
+ * tcp_done - Finish the connection of a TCP cell
+ * @cell: cell
+ *
+ */
+void tcp_done(struct cell *cell)
+{
+	int err = 0;
+	socklen_t err_len = sizeof(err);
+
+	getsockopt(cell->sock, SOL_SOCKET, SO_ERROR, &err, &err_len);
+	if (err == 0) {
+		cell_answer(cell, RES_REPLY);
+		if (data[0] != '\0' &&
+		    send(cell->sock, data, strlen(data), MSG_NOSIGNAL) < 0)
+			perror("send");
+	} else if (err == ECONNREFUSED || err == EHOSTUNREACH ||
+		   err == ENETUNREACH || err == EACCES || err == EPERM)
+		cell_answer(cell, RES_REFUSED);
+	close(cell->sock);
+	cell->sock = -1;
+}
+
+/**
+ * cells_add - Add the cells of a probe and an address to the matrix
+ * @probe: probe specification
+ * @host: address
+ *
+ */
+void cells_add(const char *probe, const char *host)
+{
+	struct addrinfo hints, *ai;
+	int proto, port_lo = 0, port_hi = 0, port;
+	char *end;
+	struct cell *cell;
+	int rc;
+
+	if (strcmp(probe, "icmp") == 0)
+		proto = IPPROTO_ICMP;
+	else if (strncmp(probe, "udp:", 4) == 0)
+		proto = IPPROTO_UDP;
+	else if (strncmp(probe, "tcp:", 4) == 0)
+		proto = IPPROTO_TCP;
+	else
+		die("bad probe");
+	if (proto != IPPROTO_ICMP) {
+		port_lo = port_hi = strtol(probe + 4, &end, 10);
+		if (*end == '-')
+			port_hi = strtol(end + 1, &end, 10);
+		if (*end != '\0' || port_lo < 1 || port_hi > 65535 ||
+		    port_lo > port_hi)
+			die("bad port range");
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_DGRAM;
+	rc = getaddrinfo(host, NULL, &hints, &ai);
+	if (rc != 0) {
+		fprintf(stderr, "error: cannot resolve %s (%s)\n",
+			host, gai_strerror(rc));
+		exit(2);
+	}
+
+	for (port = port_lo; port <= port_hi; port++) {
+		cells = realloc(cells, (cell_cnt + 1) * sizeof(*cells));
+		if (cells == NULL)
+			fatal("realloc");
+		cell = &cells[cell_cnt++];
+		memset(cell, 0, sizeof(*cell));
+		memcpy(&cell->addr, ai->ai_addr, ai->ai_addrlen);
+		cell->addr_len = ai->ai_addrlen;
+		cell->proto = proto;
+		cell->port = port;
+		cell->sock = -1;
+		if (cell->addr.ss_family == AF_INET) {
+			((struct sockaddr_in *)&cell->addr)->sin_port =
+				htons(port);
+		} else {
+			struct sockaddr_in6 *sin6;
+
+			sin6 = (struct sockaddr_in6 *)&cell->addr;
+			sin6->sin6_port = htons(port);
+			/* link-local addresses need the interface */
+			if (ifname != NULL && sin6->sin6_scope_id == 0 &&
+			    IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr))
+				sin6->sin6_scope_id = if_nametoindex(ifname);
+		}
+	}
+
+	freeaddrinfo(ai);
+}
+
+/**
+ * usage - Print a usage message and exit
+ *
+ */
+void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-t <secs>] [-n <count>] [-d <data>] [-I <ifname>]"
+		" [-q] [-S]\n"
+		"          <probe>[,<probe>...] <addr> [<addr>...]\n"
+		"\n"
+		"  probe  icmp, udp:<port>[-<port>] or tcp:<port>[-<port>]\n"
+		"  -t     timeout in seconds, default %u\n"
+		"  -n     probes per cell (icmp, udp), default %u\n"
+		"  -d     data to send, default \"%s\"\n"
+		"  -I     interface to send the probes on\n"
+		"  -q     print the summary only\n"
+		"  -S     print a summary\n",
+		name, timeout_sec, count, DATA_DEFAULT);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	char *probes, *probe, *save;
+	unsigned int iter, tcp_next = 0, tcp_open = 0;
+	unsigned int sent = 0, answered = 0, silent = 0;
+	struct pollfd *pfds;
+	struct cell **pcells;
+	unsigned int nfds;
+	long long start, deadline, now;
+	char host[INET6_ADDRSTRLEN];
+	struct rlimit rlim;
+
+	while ((opt = getopt(argc, argv, "t:n:d:I:qSh")) != -1) {
+		switch (opt) {
+		case 't': timeout_sec = strtoul(optarg, NULL, 0); break;
+		case 'n': count = strtoul(optarg, NULL, 0); break;
+		case 'd': data = optarg; break;
+		case 'I': ifname = optarg; break;
+		case 'q': quiet = 1; summary = 1; break;
+		case 'S': summary = 1; break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind < 2 || count < 1)
+		usage(argv[0]);
+
+	probes = strdup(argv[optind]);
+	for (probe = strtok_r(probes, ",", &save); probe != NULL;
+	     probe = strtok_r(NULL, ",", &save))
+		for (iter = optind + 1; iter < argc; iter++)
+			cells_add(probe, argv[iter]);
+	free(probes);
+
+	/* room for the TCP connections in progress */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+	    rlim.rlim_cur < rlim.rlim_max) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+
+	pfds = calloc(TCP_OPEN_MAX + 8, sizeof(*pfds));
+	pcells = calloc(TCP_OPEN_MAX + 8, sizeof(*pcells));
+	if (pfds == NULL || pcells == NULL)
+		fatal("calloc");
+
+	probe_id = getpid() & 0xffff;
+	for (iter = 0; iter < cell_cnt; iter++)
+		if (cells[iter].proto != IPPROTO_TCP)
+			dgram_sock(&cells[iter]);
+
+	start = time_us();
+	for (iter = 0; iter < dgram_cnt; iter++)
+		send_dgrams(dgrams[iter].sock, dgrams[iter].family,
+			    dgrams[iter].proto);
+	deadline = time_us() + timeout_sec * 1000000LL;
+
+	for (;;) {
+		/* keep up to TCP_OPEN_MAX connections in progress */
+		for (; tcp_next < cell_cnt && tcp_open < TCP_OPEN_MAX;
+		     tcp_next++)
+			if (cells[tcp_next].proto == IPPROTO_TCP)
+				tcp_open += tcp_start(&cells[tcp_next]);
+
+		/* done once every probe is answered */
+		for (iter = 0; iter < cell_cnt; iter++)
+			if (cells[iter].answered < cells[iter].sent ||
+			    (cells[iter].proto == IPPROTO_TCP &&
+			     cells[iter].sent == 0))
+				break;
+		if (iter == cell_cnt)
+			break;
+
+		now = time_us();
+		if (now >= deadline)
+			break;
+
+		nfds = 0;
+		for (iter = 0; iter < dgram_cnt; iter++) {
+			pfds[nfds].fd = dgrams[iter].sock;
+			pfds[nfds].events = POLLIN;
+			pcells[nfds++] = NULL;
+		}
+		for (iter = 0; iter < tcp_next; iter++) {
+			if (cells[iter].sock < 0)
+				continue;
+			pfds[nfds].fd = cells[iter].sock;
+			pfds[nfds].events = POLLOUT;
+			pcells[nfds++] = &cells[iter];
+		}
+
+		if (poll(pfds, nfds, (deadline - now + 999) / 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+			fatal("poll");
+		}
+
+		for (iter = 0; iter < nfds; iter++) {
+			if (pfds[iter].revents == 0)
+				continue;
+			if (pcells[iter] != NULL) {
+				tcp_done(pcells[iter]);
+				tcp_open--;
+				continue;
+			}
+			if (pfds[iter].revents & POLLERR)
+				recv_errors(&dgrams[iter]);
+			if (pfds[iter].revents & POLLIN)
+				recv_dgrams(&dgrams[iter]);
+		}
+	}
+	now = time_us();
+
+	/* whatever is still connecting got no answer */
+	for (iter = 0; iter < cell_cnt; iter++) {
+		if (cells[iter].sock >= 0)
+			close(cells[iter].sock);
+		sent += cells[iter].sent;
+		answered += cells[iter].answered;
+		if (cells[iter].answered == 0)
+			silent++;
+		if (quiet)
+			continue;
+
+		if (cells[iter].addr.ss_family == AF_INET)
+			inet_ntop(AF_INET,
+				  &((struct sockaddr_in *)&cells[iter].addr)->sin_addr,
+				  host, sizeof(host));
+		else
+			inet_ntop(AF_INET6,
+				  &((struct sockaddr_in6 *)&cells[iter].addr)->sin6_addr,
+				  host, sizeof(host));
+		if (cells[iter].proto == IPPROTO_ICMP)
+			printf("%s icmp - ", host);
+		else
+			printf("%s %s %d ", host,
+			       (cells[iter].proto == IPPROTO_UDP ?
+				"udp" : "tcp"), cells[iter].port);
+		printf("%s %u/%u\n", res_name[cells[iter].result],
+		       cells[iter].answered, cells[iter].sent);
+	}
+	if (summary)
+		printf("sent=%u answered=%u usecs=%lld pps=%.0f\n",
+		       sent, answered, now - start,
+		       (now > start ? sent * 1000000.0 / (now - start) : 0));
+
+	return (silent > 0 ? 1 : 0);
+}
+
+/* vim: set ts=8 sts=8 sw=8 noet: */
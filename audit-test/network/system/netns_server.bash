@@ -0,0 +1,230 @@
+#!/bin/bash
+#
+# Labeled networking test server in a local network namespace
+#
+
+###############################################################################
+#   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of version 2 the GNU General Public License as
+#   published by the Free Software Foundation.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###############################################################################
+
+#
+# usage: netns_server.bash start|stop|env [<index>]
+#
+# Instead of a second machine, run the network test server (NS) in the
+# network namespace "lblnet_svr<index>" connected to the test machine (TOE)
+# by a veth pair:
+#
+#  TOE  lblnet<index>h  10.213.<index>.1  fd00:213:0:<index>::1
+#  NS   lblnet<index>s  10.213.<index>.2  fd00:213:0:<index>::2
+#
+# "start" sets up the namespace, starts lblnet_tst_server there (and on the
+# TOE, unless one is already listening) and, for the lspp profile, a pluto
+# instance configured from the ipsec.conf.server.* templates with the
+# matching ipsec.conf.client connections added to the pluto of the TOE.
+# It prints the LOCAL_* and LBLNET_SVR_* variables for the test buckets as
+# "export" lines, the same as "env".  "stop" tears all of it down again.
+#
+# The NetLabel configuration is not per namespace, the one loaded on the TOE
+# from netlabel.rules applies to both ends.  Using different indexes, any
+# number of test runs can use their own server on the same machine.  They
+# share the TOE server, it is stopped with the last run using it.
+#
+
+SYSDIR=$(cd "$(dirname "$0")"; pwd)
+SRVR="$SYSDIR/../../utils/network-server/lblnet_tst_server"
+CTL_PORT=4000
+
+idx=${2:-0}
+if [[ ! $idx =~ ^[0-9]+$ ]] || ((idx > 255)); then
+    echo "error: invalid index $idx" >&2
+    exit 2
+fi
+
+ns=lblnet_svr$idx
+dev_toe=lblnet${idx}h
+dev_ns=lblnet${idx}s
+toe4=10.213.$idx.1
+ns4=10.213.$idx.2
+toe6=fd00:213:0:$idx::1
+ns6=fd00:213:0:$idx::2
+rundir=/var/run/$ns
+# the TOE server shared by all indexes, with one user file per index
+localdir=/var/run/lblnet_svr_local
+
+#
+# helpers
+#
+
+# listening [<netns exec prefix...>] - check for a server on the control port
+function listening {
+    [[ $("$@" ss -nlt "sport = :$CTL_PORT" | sed 1d) ]]
+}
+
+# wait_listen [<netns exec prefix...>] - wait for the control port
+function wait_listen {
+    declare i
+
+    for ((i = 0; i < 100; i++)); do
+        listening "$@" && return 0
+        sleep 0.1
+    done
+    return 1
+}
+
+# start_srvr <path> [<netns exec prefix...>] - start a standalone server
+# with its log and pid file in <path>.log and <path>.pid
+function start_srvr {
+    declare path=$1
+    shift
+
+    # keep the lock of local_get out of the server
+    setsid "$@" "$SRVR" -p $CTL_PORT -l $path.log -f $path.pid -vv \
+        </dev/null &>/dev/null 9>&- &
+    wait_listen "$@"
+}
+
+# kill_pidfile <pidfile> - stop a process started by this script
+function kill_pidfile {
+    [[ -f $1 ]] && kill $(<$1) 2>/dev/null
+    rm -f $1
+}
+
+# local_get - start the TOE server unless one is listening, register this
+# index as its user
+function local_get {
+    mkdir -p $localdir/users
+    {
+        flock 9
+        if ! listening && ! start_srvr $localdir/local; then
+            return 1
+        fi
+        touch $localdir/users/$idx
+    } 9>$localdir/lock
+}
+
+# local_put - unregister this index, stop the TOE server with its last user
+# (if it was started here at all)
+function local_put {
+    [[ -d $localdir ]] || return 0
+    {
+        flock 9
+        rm -f $localdir/users/$idx
+        if [[ -z $(ls $localdir/users) ]]; then
+            kill_pidfile $localdir/local.pid
+        fi
+    } 9>$localdir/lock
+}
+
+function ipsec_start {
+    # NS side, as the install_ipsec_server make target but for a single
+    # client and with the state kept in $rundir
+    echo "$toe4 $toe6" > $rundir/client_list.txt
+    (
+        cd $SYSDIR
+        export LBLNET_SVR_IPV4=$ns4 LBLNET_SVR_IPV6=$ns6
+        cat ipsec.conf.server.in_header
+        ./addr_loop.bash ipsec.conf.server.in_body < $rundir/client_list.txt
+    ) | sed "s|/var/log/pluto.log|$rundir/pluto.log|" > $rundir/ipsec.conf
+    ip netns exec $ns ipsec pluto --config $rundir/ipsec.conf \
+        --secretsfile $SYSDIR/ipsec.secrets --rundir $rundir || return 1
+    ip netns exec $ns ipsec addconn --ctlsocket $rundir/pluto.ctl \
+        --config $rundir/ipsec.conf --autoall || return 1
+
+    # TOE side, the client connections with unique names added to the
+    # running pluto
+    (
+        cd $SYSDIR
+        export LOCAL_IPV4=$toe4 LOCAL_IPV6=$toe6
+        export LBLNET_SVR_IPV4=$ns4 LBLNET_SVR_IPV6=$ns6
+        ./addr_filter.bash < ipsec.conf.client
+    ) 2>/dev/null | sed "s/^conn \(.*\)/conn \1-$ns/" > $rundir/ipsec.client.conf
+    ipsec addconn --config $rundir/ipsec.client.conf --autoall
+}
+
+function ipsec_stop {
+    declare conn
+
+    [[ -f $rundir/ipsec.client.conf ]] || return 0
+    for conn in $(sed -n 's/^conn //p' $rundir/ipsec.client.conf); do
+        ipsec auto --delete $conn &>/dev/null
+    done
+    kill_pidfile $rundir/pluto.pid
+}
+
+#
+# commands
+#
+
+function do_env {
+    echo "export LOCAL_DEV=$dev_toe"
+    echo "export LOCAL_IPV4=$toe4"
+    echo "export LOCAL_IPV6=$toe6"
+    echo "export LBLNET_SVR_IPV4=$ns4"
+    echo "export LBLNET_SVR_IPV6=$ns6"
+}
+
+function do_start {
+    if ip netns list | grep -q "^$ns\b"; then
+        echo "error: network namespace $ns already exists" >&2
+        return 1
+    fi
+    mkdir -p $rundir
+
+    ip netns add $ns || return 1
+    ip link add $dev_toe type veth peer name $dev_ns &&
+    ip link set $dev_ns netns $ns &&
+    ip addr add $toe4/24 dev $dev_toe &&
+    ip -6 addr add $toe6/64 dev $dev_toe nodad &&
+    ip link set $dev_toe up &&
+    ip -n $ns link set lo up &&
+    ip -n $ns addr add $ns4/24 dev $dev_ns &&
+    ip -n $ns -6 addr add $ns6/64 dev $dev_ns nodad &&
+    ip -n $ns link set $dev_ns up || return 1
+
+    if ! start_srvr $rundir/server ip netns exec $ns; then
+        echo "error: failed to start the test server in $ns" >&2
+        return 1
+    fi
+    # the tests with host=local need a server on the TOE as well
+    if ! local_get; then
+        echo "error: failed to start the local test server" >&2
+        return 1
+    fi
+
+    if [[ $PPROFILE == lspp ]] && ! ipsec_start; then
+        echo "warning: failed to set up IPsec for $ns" >&2
+    fi
+
+    do_env
+}
+
+function do_stop {
+    ipsec_stop
+    kill_pidfile $rundir/server.pid
+    local_put
+    # the veth pair goes away with its NS end
+    ip netns del $ns 2>/dev/null
+    rm -rf $rundir
+}
+
+case $1 in
+    start) do_start ;;
+    stop) do_stop ;;
+    env) do_env ;;
+    *)
+        echo "usage: $0 start|stop|env [<index>]" >&2
+        exit 2
+        ;;
+esac
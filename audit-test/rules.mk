@@ -212,10 +212,20 @@ ifeq (,$(SCREL_FILE))
     # if DISTRO is unset or relevancy-$DISTRO doesn't exist
     SCREL_FILE := $(TOPDIR)/utils/bin/relevancy  # fallback
 endif
+SCREL_FILE	:= $(strip $(SCREL_FILE))
 
-parse_screl = $(eval export SCREL_SYSCALLS := \
-    $(shell "$(TOPDIR)/utils/bin/screl-parser.py" \
-                $(SCREL_FILE) $(MACHINE) $(MODE)))
+# the relevancy file is parsed only once per file/MACHINE/MODE into a cached
+# makefile fragment defining (sorted) SCREL_SYSCALLS, see the rule below,
+# make(1) re-creates it (and restarts) whenever it is missing or out of date,
+# a failed parse stops the build rather than leaving an empty list behind
+SCREL_CACHE	:= $(TOPDIR)/utils/bin/screl-$(notdir $(SCREL_FILE))-$(MACHINE)-$(MODE).mk
+
+ifeq (,$(filter clean distclean,$(MAKECMDGOALS)))
+include $(SCREL_CACHE)
+else
+-include $(SCREL_CACHE)
+endif
+export SCREL_SYSCALLS
 
 ##########################################################################
 # Common rules
@@ -364,6 +374,17 @@ ifneq ($(DEP_FILES),)
 -include $(DEP_FILES)
 endif
 
+# Syscall relevancy cache, see SCREL_CACHE above
+$(SCREL_CACHE): $(SCREL_FILE) $(TOPDIR)/utils/bin/screl-parser.py
+	@echo "Creating syscall relevancy cache $@" >&2
+	@tmp=$$(mktemp "$@.XXXXXX") || exit 1; \
+	"$(TOPDIR)/utils/bin/screl-parser.py" $(SCREL_FILE) $(MACHINE) $(MODE) \
+	    >"$$tmp.list" || { rm -f "$$tmp"*; exit 1; }; \
+	{ echo "SCREL_SYSCALLS := \\"; \
+	  sort -u "$$tmp.list" | sed 's/$$/ \\/'; \
+	  echo; } >"$$tmp" && mv -f "$$tmp" $@ || { rm -f "$$tmp"*; exit 1; }; \
+	rm -f "$$tmp.list"
+
 # How to build missing things like libraries
 ../%:
 	$(MAKE) -C $(dir $@) $(notdir $@)
@@ -391,7 +412,6 @@ subdirs_quiet:
 # needs SHELL set to bash (due to printf %q),
 # also avoid MAKE-specific variables
 export_env:
-	$(call parse_screl)  # for run.bash
 	@while IFS= read -r -d '' line; do \
 		var=$${line%%=*}; \
 		case "$$var" in \
@@ -0,0 +1,231 @@
+#!/usr/bin/python
+###############################################################################
+#   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+#
+#   This copyrighted material is made available to anyone wishing
+#   to use, modify, copy, or redistribute it subject to the terms
+#   and conditions of the GNU General Public License version 2.
+#
+#   This program is distributed in the hope that it will be
+#   useful, but WITHOUT ANY WARRANTY; without even the implied
+#   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+#   PURPOSE. See the GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public
+#   License along with this program; if not, write to the Free
+#   Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#   Boston, MA 02110-1301, USA.
+###############################################################################
+#
+# This is a generator for the syscalls bucket test cases. It reads the
+# declarative case tables (*-cases.tsv), drops syscalls not relevant for the
+# current arch/mode, computes the default errno and the tag of each test case
+# and writes out
+#
+#  - a bash manifest, sourced by run.conf, with one '+' line per test case
+#  - a C header with the same cases as an array of struct sc_case
+#
+# so that none of this has to be done (for every case) at runtime.
+#
+# Case table format: one case per line, tab-separated columns, the first
+# column being the syscall name, the others key=value test parameters.
+# Lines starting with '#' and empty lines are ignored.
+# The 'pprofile' key is special - it is not passed to the test, the case is
+# included only when running under the given PPROFILE.
+#
+# usage: gen-cases.py -r <relevant syscalls> -b <bash out> -c <header out>
+#                     <permtype>:<table>[:<pprofile>] ...
+#
+
+from __future__ import print_function
+import sys
+import re
+import getopt
+
+#
+# helpers functions
+#
+
+# fatal error
+def syntaxerr(msg):
+    print("%s:%d: syntax error:" % (in_file, linenr), msg, file=sys.stderr)
+    sys.exit(2)
+
+# quote a string for bash, only when needed
+def shquote(s):
+    if re.match(r'^[\w@%+=:,./-]+$', s):
+        return s
+    return "'" + s.replace("'", "'\\''") + "'"
+
+# quote a string for C
+def cquote(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+#
+# case processing
+#
+
+def parse_table(path, permtype, pprofile):
+    global in_file, linenr
+    in_file = path
+    linenr = 0
+    cases = []
+
+    with open(path, 'r') as f:
+        for line in f:
+            linenr += 1
+            line = line.rstrip('\n')
+            if not line.strip() or line.startswith('#'):
+                continue
+
+            cols = line.split('\t')
+            syscall = cols[0].strip()
+            if not syscall or '=' in syscall:
+                syntaxerr("missing syscall name")
+
+            params = []
+            case_pprofile = pprofile
+            for col in cols[1:]:
+                col = col.strip()
+                if not col:
+                    continue
+                if '=' not in col:
+                    syntaxerr("not a key=value pair: %s" % col)
+                (key, value) = col.split('=', 1)
+                if key == 'pprofile':
+                    case_pprofile = value
+                else:
+                    params.append((key, value))
+
+            cases.append(make_case(syscall, params, permtype, case_pprofile))
+
+    return cases
+
+# complete the case the same way the former '+' wrapper in run.conf did,
+# appending permtype, default errno and the tag
+def make_case(syscall, params, permtype, pprofile):
+    p = dict(params)
+    g = lambda k: p.get(k, '')
+    # ${var:+${var}_}
+    opt = lambda k: g(k) and g(k) + '_'
+
+    if 'permtype' not in p:
+        params.append(('permtype', permtype))
+        p['permtype'] = permtype
+    permtype = p['permtype']
+
+    err = None
+    tag = None
+    if permtype == 'cap':
+        err = 'EPERM'
+        caps = g('caps').replace(',', '+', 1)
+        tag = "%s__%s%s_%s_%s_%s%s" % (syscall, opt('op'), permtype, g('perm'),
+                                      g('expres'), g('user'),
+                                      caps and '_drop_' + caps)
+    elif permtype == 'dac':
+        err = 'EACCES'
+        tag = "%s__%s%s_%s_%s_%s" % (syscall, opt('op'), permtype, g('perm'),
+                                    g('expres'), g('dacugo'))
+    elif permtype == 'mac':
+        err = 'EACCES'
+        tag = "%s__%s%s_%s_%s_subj_%s%s_obj%s" % (
+            syscall, opt('op'), permtype, g('perm'), g('expres'),
+            g('subj_type') and 'override_', g('mlsop'),
+            g('obj_type') and '_override')
+    else:
+        tag = "%s__%s%s_%s_%s" % (syscall, opt('op'), permtype, g('perm'),
+                                 g('expres'))
+
+    if err and not g('err') and g('expres') == 'fail':
+        params.append(('err', err))
+    if not g('tag'):
+        params.append(('tag', tag))
+
+    return {'syscall': syscall, 'params': params, 'pprofile': pprofile}
+
+#
+# output
+#
+
+def write_bash(path, cases):
+    with open(path, 'w') as f:
+        f.write("# generated by gen-cases.py for %s/%s, do not edit\n"
+                % (in_arch, in_mode))
+        guard = None
+        for case in cases:
+            if case['pprofile'] != guard:
+                if guard:
+                    f.write("fi\n")
+                if case['pprofile']:
+                    f.write("if [[ $PPROFILE == %s ]]; then\n" % case['pprofile'])
+                guard = case['pprofile']
+            args = ["%s=%s" % (k, shquote(v)) for (k, v) in case['params']]
+            f.write("+ %s %s\n" % (case['syscall'], ' '.join(args)))
+        if guard:
+            f.write("fi\n")
+
+def write_header(path, cases):
+    with open(path, 'w') as f:
+        f.write("/* generated by gen-cases.py for %s/%s, do not edit */\n\n"
+                % (in_arch, in_mode))
+        f.write("#ifndef _SC_CASES_H\n#define _SC_CASES_H\n\n")
+        f.write("#include <stddef.h>\n\n")
+        f.write("struct sc_case {\n"
+                "    const char *syscall;\n"
+                "    const char *permtype;\n"
+                "    const char *tag;\n"
+                "    const char *expres;\n"
+                "    const char *err;            /* NULL if expres=success */\n"
+                "    const char *pprofile;       /* NULL if any PPROFILE */\n"
+                "    const char *const *params;  /* NULL-terminated key=value */\n"
+                "};\n\n")
+        f.write("static const struct sc_case sc_cases[] = {\n")
+        for case in cases:
+            p = dict(case['params'])
+            strs = lambda k: k in p and cquote(p[k]) or 'NULL'
+            f.write("    { %s, %s, %s, %s, %s, %s,\n"
+                    % (cquote(case['syscall']), strs('permtype'), strs('tag'),
+                       strs('expres'), strs('err'),
+                       case['pprofile'] and cquote(case['pprofile']) or 'NULL'))
+            f.write("      (const char *const []){ %s, NULL } },\n"
+                    % ', '.join(cquote("%s=%s" % kv) for kv in case['params']))
+        f.write("};\n\n")
+        f.write("#define SC_CASES_COUNT (sizeof(sc_cases) / sizeof(sc_cases[0]))\n\n")
+        f.write("#endif /* _SC_CASES_H */\n")
+
+#
+# main
+#
+
+def usage():
+    print("usage: %s -r <relevant syscalls> -b <bash out> -c <header out>"
+          " [-a <arch> -m <mode>] <permtype>:<table>[:<pprofile>] ..."
+          % sys.argv[0], file=sys.stderr)
+    sys.exit(2)
+
+try:
+    (opts, args) = getopt.getopt(sys.argv[1:], 'r:b:c:a:m:')
+except getopt.GetoptError:
+    usage()
+opts = dict(opts)
+if not args or '-r' not in opts or '-b' not in opts or '-c' not in opts:
+    usage()
+
+relevant = set(opts['-r'].split())
+in_arch = opts.get('-a', 'unknown')
+in_mode = opts.get('-m', 'unknown')
+in_file = None
+linenr = 0
+
+cases = []
+for arg in args:
+    spec = arg.split(':')
+    if len(spec) < 2 or len(spec) > 3:
+        usage()
+    (permtype, path) = spec[:2]
+    pprofile = len(spec) == 3 and spec[2] or None
+    cases += [c for c in parse_table(path, permtype, pprofile)
+              if c['syscall'] in relevant]
+
+write_bash(opts['-b'], cases)
+write_header(opts['-c'], cases)
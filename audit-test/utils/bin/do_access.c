@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc != 2) {
 	fprintf(stderr, "Usage:\n%s <path>\n", argv[0]);
@@ -26,8 +26,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = access(argv[1], W_OK);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     char *filename = NULL;
 
     if (argc >= 2)
@@ -25,8 +25,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = acct(filename);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct timex timex;
 
     if (argc > 2) {
@@ -37,8 +37,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = adjtimex(&timex);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
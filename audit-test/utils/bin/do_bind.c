@@ -22,7 +22,7 @@
 int do_bind(int argc, char **argv,
             int (*bindfunc)(int, const struct sockaddr *, socklen_t addrlen))
 {
-    int exitval, result;
+    int exitval;
     int sockfd;
     union {
         struct sockaddr_in in;
@@ -65,10 +65,7 @@ int do_bind(int argc, char **argv,
 
     errno = 0;
     exitval = bindfunc(sockfd, (struct sockaddr *)&addr, addrlen);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef SOCKCALL_MODULE
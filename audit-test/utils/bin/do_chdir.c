@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc != 2) {
 	fprintf(stderr, "Usage:\n%s <path>\n", argv[0]);
@@ -27,8 +27,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = chdir(argv[1]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     long id_read;
     char *endptr;
     uid_t uid = -1;
@@ -72,8 +72,5 @@ int main(int argc, char **argv)
     /* use syscall() to force chown over chown32 */
     errno = 0;
     exitval = syscall(__NR_chown, argv[1], uid, gid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
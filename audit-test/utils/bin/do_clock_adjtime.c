@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct timex tx;
     memset(&tx, 0, sizeof(tx));
 
@@ -34,8 +34,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_clock_adjtime, CLOCK_REALTIME, &tx);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
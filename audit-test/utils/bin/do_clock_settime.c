@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct timespec tspec;
 
     if (argc != 2) {
@@ -31,8 +31,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = clock_settime(CLOCK_REALTIME, &tspec);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = CLONE_VFORK;
     pid_t pid;
 
@@ -48,8 +48,5 @@ int main(int argc, char **argv)
 
     /* parent */
     exitval = pid;
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
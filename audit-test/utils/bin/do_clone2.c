@@ -20,7 +20,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = CLONE_VFORK;
     char *cstack;
     pid_t pid;
@@ -54,8 +54,5 @@ int main(int argc, char **argv)
     /* parent */
     free(cstack);
     exitval = pid;
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
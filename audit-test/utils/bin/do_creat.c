@@ -14,30 +14,20 @@
  */
 
 #include "includes.h"
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc < 2) {
 	fprintf(stderr, "Usage:\n%s <path> [context]\n", argv[0]);
 	return 1;
     }
 
-#ifdef LSM_SELINUX
-    if ((argc > 2) && (setfscreatecon(argv[2]) < 0)) {
-	perror("do_creat: setfscreatecon");
+    if ((argc > 2) && set_create_context(argv[2]) < 0)
 	return 1;
-    }
-#endif
 
     errno = 0;
     exitval = creat(argv[1], S_IRWXU);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fan_fd;
     unsigned int flags = FAN_MARK_ADD;
     uint64_t mask = FAN_OPEN;
@@ -50,8 +50,5 @@ int main(int argc, char **argv)
     }
     errno = 0;
     exitval = fanotify_mark(fan_fd, flags, mask, AT_FDCWD, argv[1]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
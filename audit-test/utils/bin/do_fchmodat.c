@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int dir_fd;
 
     if (argc != 4) {
@@ -26,20 +26,11 @@ int main(int argc, char **argv)
 	return TEST_ERROR;
     }
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dir_fd = AT_FDCWD;
-    } else {
-        dir_fd = open(argv[1], O_DIRECTORY);
-        if (dir_fd == -1) {
-            perror("do_fchmodat: open dir_fd");
-            return TEST_ERROR;
-        }
-    }
+    dir_fd = open_dirfd(argv[1]);
+    if (dir_fd == -1)
+        return TEST_ERROR;
 
     errno = 0;
     exitval = fchmodat(dir_fd, argv[2], atoi(argv[3]), 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
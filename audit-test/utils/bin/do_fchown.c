@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct passwd *pw;
     int fd;
 
@@ -43,8 +43,5 @@ int main(int argc, char **argv)
     /* use syscall() to force fchown over fchown32 */
     errno = 0;
     exitval = syscall(__NR_fchown, fd, pw->pw_uid, -1);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct passwd *pw;
     int dir_fd;
 
@@ -28,15 +28,9 @@ int main(int argc, char **argv)
 	return TEST_ERROR;
     }
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dir_fd = AT_FDCWD;
-    } else {
-        dir_fd = open(argv[1], O_DIRECTORY);
-        if (dir_fd == -1) {
-            perror("do_fchownat: open dir_fd");
-            return TEST_ERROR;
-        }
-    }
+    dir_fd = open_dirfd(argv[1]);
+    if (dir_fd == -1)
+        return TEST_ERROR;
 
     pw = getpwnam(argv[3]);
     if (!pw) {
@@ -46,8 +40,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = fchownat(dir_fd, argv[2], pw->pw_uid, -1, 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
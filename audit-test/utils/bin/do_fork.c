@@ -20,7 +20,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid;
 
     /* use syscall() to force fork, as the fork() library routine
@@ -34,8 +34,5 @@ int main(int argc, char **argv)
 
     /* parent */
     exitval = pid;
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
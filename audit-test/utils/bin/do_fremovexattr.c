@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fd;
 
     if (argc != 3) {
@@ -35,8 +35,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = fremovexattr(fd, argv[2]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fd;
 
     if (argc != 4) {
@@ -35,8 +35,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = fsetxattr(fd, argv[2], argv[3], strlen(argv[3]), XATTR_CREATE);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
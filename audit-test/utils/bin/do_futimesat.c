@@ -20,7 +20,7 @@
 int main(int argc, char **argv)
 {
     struct timeval times[2];
-    int exitval, result;
+    int exitval;
     int dir_fd;
 
     if (argc < 3) {
@@ -51,8 +51,5 @@ int main(int argc, char **argv)
            are set to the current time */
         exitval = futimesat(dir_fd, argv[2], NULL);
     }
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     int pid;
     struct robust_list_head *listhead;
@@ -32,10 +32,7 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_get_robust_list, pid, &listhead, &listlen);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 /* vim: set sts=4 sw=4 et : */
@@ -17,13 +17,10 @@
 
 int main()
 {
-    int exitval, result;
+    int exitval;
     gid_t grouplist[NGROUPS_MAX];
 
     errno = 0;
     exitval = getgroups(NGROUPS_MAX, grouplist);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
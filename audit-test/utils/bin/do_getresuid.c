@@ -17,13 +17,10 @@
 
 int main()
 {
-    int exitval, result;
+    int exitval;
     uid_t ruid, euid, suid;
 
     errno = 0;
     exitval = getresuid(&ruid, &euid, &suid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
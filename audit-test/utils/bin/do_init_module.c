@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fd;
     struct stat mstat;
     void *buffer;
@@ -54,8 +54,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_init_module, buffer, mstat.st_size, "");
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fd;
     uint32_t mask = IN_ACCESS;
 
@@ -44,8 +44,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = inotify_add_watch(fd, argv[1], mask);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -20,7 +20,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int fd = -1, request;
     struct termios tios = { 0 };
     int map;
@@ -50,8 +50,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = ioctl(fd, request, arg);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
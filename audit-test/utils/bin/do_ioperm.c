@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int turn_on = 1;
 
     if (argc != 3) {
@@ -27,8 +27,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_ioperm, atoi(argv[1]), atoi(argv[2]), turn_on);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
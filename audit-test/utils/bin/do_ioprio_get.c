@@ -33,7 +33,7 @@ int main(int argc, char **argv)
      * Usage:
      * ./do_ioprio_get [which] [who]
      */
-    int exitval, result;
+    int exitval;
     int which = IOPRIO_WHO_USER;
     int who = 0;
 
@@ -54,8 +54,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_ioprio_get, which, who);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -40,7 +40,7 @@ enum {    /* which */
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int which = IOPRIO_WHO_USER;
     int who = 0;
     int ioprio;
@@ -83,8 +83,5 @@ int main(int argc, char **argv)
     errno = 0;
     ioprio = IOPRIO_PRIO_VALUE(sched_class, priority_level);
     exitval = syscall(__NR_ioprio_set, which, who, ioprio);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
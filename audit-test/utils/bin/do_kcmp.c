@@ -36,7 +36,7 @@ enum kcmp_type {
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid1, pid2;
     int type;
     unsigned long fd1 = 0, fd2 = 0;
@@ -87,8 +87,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_kcmp, pid1, pid2, type, fd1, fd2);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
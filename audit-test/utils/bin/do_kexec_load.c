@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     unsigned long entry, flags;
 
     if (argc != 2) {
@@ -31,8 +31,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_kexec_load, entry, 0, NULL, flags);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int pid, signum;
 
     if (argc < 3) {
@@ -54,8 +54,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = kill(pid, signum);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     long id_read;
     char *endptr;
     uid_t uid = -1;
@@ -71,8 +71,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_lchown, argv[1], uid, gid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
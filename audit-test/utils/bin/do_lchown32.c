@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct passwd *pw;
 
     if (argc != 3) {
@@ -35,8 +35,5 @@ int main(int argc, char **argv)
     /* use syscall() to force lchown32 over lchown */
     errno = 0;
     exitval = syscall(__NR_lchown32, argv[1], pw->pw_uid, -1);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 int main(int argc, char **argv)
 {
     int dir_fd, newdir_fd;
-    int exitval, result;
+    int exitval;
 
     if (argc < 4) {
 	fprintf(stderr, "Usage:\n%s <directory> <oldpath> <newpath> [<new_directory>]\n", argv[0]);
@@ -26,35 +26,20 @@ int main(int argc, char **argv)
     }
 
     /* directory */
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dir_fd = AT_FDCWD;
-    } else {
-        dir_fd = open(argv[1], O_DIRECTORY);
-        if (dir_fd == -1) {
-            perror("do_linkat: open dir_fd");
-            return TEST_ERROR;
-        }
-    }
+    dir_fd = open_dirfd(argv[1]);
+    if (dir_fd == -1)
+        return TEST_ERROR;
 
     /* new_directory */
     if (argc > 4) {
-        if (!strcmp(argv[4], "AT_FDCWD")) {
-            newdir_fd = AT_FDCWD;
-        } else {
-            newdir_fd = open(argv[4], O_DIRECTORY);
-            if (newdir_fd == -1) {
-                perror("do_linkat: open newdir_fd");
-                return TEST_ERROR;
-            }
-        }
+        newdir_fd = open_dirfd(argv[4]);
+        if (newdir_fd == -1)
+            return TEST_ERROR;
     } else {
         newdir_fd = dir_fd;
     }
 
     errno = 0;
     exitval = linkat(dir_fd, argv[2], newdir_fd, argv[3], 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     char buf[1024];
 
     if (argc != 2) {
@@ -29,8 +29,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = listxattr(argv[1], buf, 1024);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
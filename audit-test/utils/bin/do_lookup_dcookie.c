@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     unsigned long long cookie;
     char buf[1024];
 
@@ -30,8 +30,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_lookup_dcookie, cookie, buf, sizeof(buf));
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
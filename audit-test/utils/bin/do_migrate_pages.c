@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int pid;
     unsigned long maxnode, old_nodes, new_nodes;
 
@@ -33,8 +33,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_migrate_pages, pid, maxnode, &old_nodes, &new_nodes);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -14,41 +14,25 @@
  */
 
 #include "includes.h"
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
     int dir_fd;
-    int exitval, result;
+    int exitval;
 
     if (argc < 3) {
 	fprintf(stderr, "Usage:\n%s <directory> <path> [context]\n", argv[0]);
 	return TEST_ERROR;
     }
 
-#ifdef LSM_SELINUX
-    if ((argc > 3) && (setfscreatecon(argv[3]) < 0)) {
-	perror("do_mkdirat: setfscreatecon");
+    if ((argc > 3) && set_create_context(argv[3]) < 0)
 	return TEST_ERROR;
-    }
-#endif
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dir_fd = AT_FDCWD;
-    } else {
-        dir_fd = open(argv[1], O_DIRECTORY);
-        if (dir_fd == -1) {
-            perror("do_mkdirat: open dir_fd");
-            return TEST_ERROR;
-        }
-    }
+    dir_fd = open_dirfd(argv[1]);
+    if (dir_fd == -1)
+        return TEST_ERROR;
 
     errno = 0;
     exitval = mkdirat(dir_fd, argv[2], S_IRWXU);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
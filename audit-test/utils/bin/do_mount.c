@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     void *data = NULL;
     unsigned long def_flags = MS_MGC_VAL;
     unsigned long flags = def_flags;
@@ -49,8 +49,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = mount(argv[1], argv[2], argv[3], flags, data);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int pid, status;
     char c;
     void *ptr = &c;
@@ -32,8 +32,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_move_pages, pid, 1, &ptr, NULL, &status, 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -15,13 +15,10 @@
 
 #include "includes.h"
 #include <mqueue.h>
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
     mode_t mode = S_IRWXU;
 
@@ -49,17 +46,10 @@ int main(int argc, char **argv)
 	return 1;
     }
 
-#ifdef LSM_SELINUX
-    if ((argc > 3) && (setfscreatecon(argv[3]) < 0)) {
-	perror("do_mq_open: setfscreatecon");
+    if ((argc > 3) && set_create_context(argv[3]) < 0)
 	return 1;
-    }
-#endif
 
     errno = 0;
     exitval = mq_open(argv[1], flags, mode, NULL);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
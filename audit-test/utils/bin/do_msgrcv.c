@@ -20,7 +20,7 @@
 
 int do_msgrcv(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct msgbuf *buf;
     int buflen;
 
@@ -44,10 +44,7 @@ int do_msgrcv(int argc, char **argv)
 
     errno = 0;
     exitval = msgrcv(msqid, buf, buflen, msgtyp, IPC_NOWAIT);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef IPC_MODULE
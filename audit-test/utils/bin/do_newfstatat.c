@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
     struct stat buf;
     int dir_fd;
@@ -52,8 +52,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_newfstatat, dir_fd, argv[2], &buf, flags);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int inc;
 
     if (argc != 2) {
@@ -28,8 +28,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_nice, inc);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -14,13 +14,10 @@
  */
 
 #include "includes.h"
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
 
     if (argc < 3) {
@@ -46,17 +43,10 @@ int main(int argc, char **argv)
 	return 1;
     }
 
-#ifdef LSM_SELINUX
-    if ((argc > 3) && (setfscreatecon(argv[3]) < 0)) {
-	perror("do_open: setfscreatecon");
+    if ((argc > 3) && set_create_context(argv[3]) < 0)
 	return 1;
-    }
-#endif
 
     errno = 0;
     exitval = open(argv[1], flags, S_IRWXU);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
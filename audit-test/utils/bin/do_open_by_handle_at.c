@@ -60,7 +60,7 @@ err:
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct file_handle *fhp;
     int dir_fd, mount_id, mount_fd;
     int flags = 0;
@@ -114,8 +114,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = open_by_handle_at(mount_fd, fhp, flags);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -14,13 +14,10 @@
  */
 
 #include "includes.h"
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
     int dirfd;
 
@@ -48,27 +45,14 @@ int main(int argc, char **argv)
 	return TEST_ERROR;
     }
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dirfd = AT_FDCWD;
-    } else {
-        dirfd = open(argv[1], O_DIRECTORY);
-        if (dirfd == -1) {
-            perror("do_openat: open dirfd");
-            return TEST_ERROR;
-        }
-    }
+    dirfd = open_dirfd(argv[1]);
+    if (dirfd == -1)
+        return TEST_ERROR;
 
-#ifdef LSM_SELINUX
-    if (argc == 5 && setfscreatecon(argv[4]) < 0) {
-	perror("do_openat: setfscreatecon");
+    if (argc == 5 && set_create_context(argv[4]) < 0)
 	return TEST_ERROR;
-    }
-#endif
 
     errno = 0;
     exitval = openat(dirfd, argv[2], flags);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,13 +17,10 @@
 
 int main()
 {
-    int exitval, result;
+    int exitval;
     char buf[1024];
 
     errno = 0;
     exitval = syscall(__NR_pciconfig_write, 0, 0, 0, sizeof(buf), buf);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc != 3) {
         fprintf(stderr, "Usage:\n%s <new_root> <put_old>\n", argv[0]);
@@ -26,8 +26,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_pivot_root, argv[1], argv[2]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
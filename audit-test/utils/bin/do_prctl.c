@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int option, arg2 = CAP_CHOWN;
 
     if (argc < 2) {
@@ -57,8 +57,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = prctl(option, arg2, 0, 0, 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
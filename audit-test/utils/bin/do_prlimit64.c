@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid = 0;
     int resource;
     struct rlimit rlim, *rlimptr = NULL;
@@ -52,8 +52,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_prlimit64, pid, resource, rlimptr, NULL);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid;
     struct iovec local_iov, remote_iov;
     char buf[1];
@@ -40,8 +40,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     enum __ptrace_request req;
 
     if (argc < 3) {
@@ -39,8 +39,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = ptrace(req, atoi(argv[1]), NULL, NULL);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int cmd, id;
 
     if (argc != 4) {
@@ -43,8 +43,5 @@ int main(int argc, char **argv)
         fprintf(stderr, "Invalid argument: only normal or xfs\n");
         return TEST_ERROR;
     }
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
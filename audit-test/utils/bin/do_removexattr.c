@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc != 3) {
 	fprintf(stderr, "Usage:\n%s <path> <xattr name>\n",
@@ -28,8 +28,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = removexattr(argv[1], argv[2]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
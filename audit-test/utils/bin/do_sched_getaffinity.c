@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid = 0;
     cpu_set_t mask;
 
@@ -32,8 +32,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = sched_getaffinity(pid, sizeof(cpu_set_t), &mask);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid;
     struct sched_param param;
 
@@ -37,8 +37,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = sched_setparam(pid, &param);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
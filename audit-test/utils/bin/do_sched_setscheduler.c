@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid = 0;
     int policy;
     struct sched_param param;
@@ -47,8 +47,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = sched_setscheduler(pid, policy, &param);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
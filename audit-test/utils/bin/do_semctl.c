@@ -26,7 +26,7 @@ union semun
 
 int do_semctl(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int semid, cmd = 0;
     union semun sebuf;
     struct semid_ds tmpbuf;
@@ -66,10 +66,7 @@ int do_semctl(int argc, char **argv)
         break;
     }
 
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef IPC_MODULE
@@ -18,7 +18,7 @@
 
 int do_semop(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
     struct sembuf sops;
 
@@ -42,10 +42,7 @@ int do_semop(int argc, char **argv)
 
     errno = 0;
     exitval = semop(atoi(argv[1]), &sops, 1);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef IPC_MODULE
@@ -18,7 +18,7 @@
 
 int do_semtimedop(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
     struct sembuf sops;
     struct timespec timeout = { 1, 0 };
@@ -43,10 +43,7 @@ int do_semtimedop(int argc, char **argv)
 
     errno = 0;
     exitval = semtimedop(atoi(argv[1]), &sops, 1, &timeout);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef IPC_MODULE
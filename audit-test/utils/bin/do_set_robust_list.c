@@ -19,13 +19,10 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct robust_list_head head;
 
     errno = 0;
     exitval = syscall(__NR_set_robust_list, &head, sizeof(struct robust_list_head));
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
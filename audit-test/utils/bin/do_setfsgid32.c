@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc != 2) {
 	fprintf(stderr, "Usage:\n%s <fsgid>\n", argv[0]);
@@ -27,8 +27,5 @@ int main(int argc, char **argv)
     /* use syscall() to force setfsgid32 over setfsgid */
     errno = 0;
     exitval = syscall(__NR_setfsgid32, atoi(argv[1]));
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result, i;
+    int exitval, i;
     gid_t grouplist[NGROUPS] = { 0 };
     size_t nr_groups = 0;
 
@@ -49,8 +49,5 @@ int main(int argc, char **argv)
     /* use syscall() to force setgroups over setgroups32 */
     errno = 0;
     exitval = syscall(__NR_setgroups, nr_groups, &grouplist);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
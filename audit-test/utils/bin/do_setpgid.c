@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid, pgid;
 
     if (argc != 3) {
@@ -29,8 +29,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = setpgid(pid, pgid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int which, who, prio;
 
     if (argc != 4) {
@@ -43,8 +43,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = setpriority(which, who, prio);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     gid_t gid;
 
     if (argc != 2) {
@@ -29,8 +29,5 @@ int main(int argc, char **argv)
     /* use syscall() to force setregid32 over setregid */
     errno = 0;
     exitval = syscall(__NR_setregid32, gid, gid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -17,7 +17,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     gid_t gid;
 
     if (argc != 2) {
@@ -29,8 +29,5 @@ int main(int argc, char **argv)
     /* use syscall() to force setresgid32 over setresgid */
     errno = 0;
     exitval = syscall(__NR_setresgid32, gid, gid, gid);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
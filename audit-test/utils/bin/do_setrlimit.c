@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int resource;
     struct rlimit rlim;
 
@@ -44,8 +44,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = setrlimit(resource, &rlim);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct timeval tv;
     struct timezone tz_data, *tz = NULL;
 
@@ -42,8 +42,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = settimeofday(&tv, tz);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int do_shmctl(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct shmid_ds buf;
     int shmid, cmd = 0;
 
@@ -56,10 +56,7 @@ int do_shmctl(int argc, char **argv)
         break;
     }
 
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
 
 #ifndef IPC_MODULE
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct stat buf;
 
     if (argc != 2) {
@@ -28,9 +28,6 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_statfs, argv[1], &buf);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 
 }
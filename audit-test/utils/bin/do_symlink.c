@@ -20,24 +20,17 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
 
     if (argc < 3) {
 	fprintf(stderr, "Usage:\n%s <oldpath> <newpath> [context]\n", argv[0]);
 	return 1;
     }
 
-#ifdef LSM_SELINUX
-    if ((argc > 3) && (setfscreatecon(argv[3]) < 0)) {
-	perror("do_symlink: setfscreatecon");
+    if ((argc > 3) && set_create_context(argv[3]) < 0)
 	return 1;
-    }
-#endif
 
     errno = 0;
     exitval = symlink(argv[1], argv[2]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
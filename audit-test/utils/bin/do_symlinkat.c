@@ -15,41 +15,25 @@
  */
 
 #include "includes.h"
-#ifdef LSM_SELINUX
-#include <selinux/selinux.h>
-#endif
 
 int main(int argc, char **argv)
 {
     int dir_fd;
-    int exitval, result;
+    int exitval;
 
     if (argc < 4 || argc > 5) {
 	fprintf(stderr, "Usage:\n%s <directory> <oldpath> <newpath> [context]\n", argv[0]);
 	return TEST_ERROR;
     }
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dir_fd = AT_FDCWD;
-    } else {
-        dir_fd = open(argv[1], O_DIRECTORY);
-        if (dir_fd == -1) {
-            perror("do_symlinkat: open dir_fd");
-            return TEST_ERROR;
-        }
-    }
+    dir_fd = open_dirfd(argv[1]);
+    if (dir_fd == -1)
+        return TEST_ERROR;
 
-#ifdef LSM_SELINUX
-    if (argc == 5 && setfscreatecon(argv[4]) < 0) {
-	perror("do_symlinkat: setfscreatecon");
+    if (argc == 5 && set_create_context(argv[4]) < 0)
 	return TEST_ERROR;
-    }
-#endif
 
     errno = 0;
     exitval = symlinkat(argv[2], dir_fd, argv[3]);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -50,7 +50,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int type, len;
     char *bufp = NULL;
 
@@ -77,8 +77,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_syslog, type, bufp, len);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
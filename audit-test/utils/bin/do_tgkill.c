@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int pid, signum;
 
     if (argc < 3) {
@@ -47,8 +47,5 @@ int main(int argc, char **argv)
     /* we only test the simple non-threaded case, so tgid == pid */
     /* use syscall() as no library routine for sys_tgkill */
     exitval = syscall(__NR_tgkill, pid, pid, signum);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
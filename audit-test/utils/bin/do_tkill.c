@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int pid, signum;
 
     if (argc < 3) {
@@ -46,8 +46,5 @@ int main(int argc, char **argv)
     /* use syscall() as no library routine for sys_tkill */
     errno = 0;
     exitval = syscall(__NR_tkill, pid, signum);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -18,7 +18,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     int flags = 0;
 
     if (argc < 2) {
@@ -39,8 +39,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = syscall(__NR_umount2, argv[1], flags);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -20,7 +20,7 @@
 int main(int argc, char **argv)
 {
     struct timespec times[2];
-    int exitval, result = 0;
+    int exitval;
     int dirfd;
 
     if (argc != 3 && argc != 5) {
@@ -28,15 +28,9 @@ int main(int argc, char **argv)
         return TEST_ERROR;
     }
 
-    if (!strcmp(argv[1], "AT_FDCWD")) {
-        dirfd = AT_FDCWD;
-    } else {
-        dirfd = open(argv[1], O_DIRECTORY);
-        if (dirfd == -1) {
-            perror("do_utimensat: open dirfd");
-            return TEST_ERROR;
-        }
-    }
+    dirfd = open_dirfd(argv[1]);
+    if (dirfd == -1)
+        return TEST_ERROR;
 
     times[0].tv_sec = 0;
     times[0].tv_nsec = UTIME_NOW;
@@ -68,8 +62,5 @@ int main(int argc, char **argv)
 
     errno = 0;
     exitval = utimensat(dirfd, argv[2], times, 0);
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
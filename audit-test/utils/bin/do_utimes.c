@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     struct timeval times[2];
 
     if (argc != 2 && argc != 4) {
@@ -38,8 +38,5 @@ int main(int argc, char **argv)
         exitval = utimes(argv[1], NULL);
     }
 
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
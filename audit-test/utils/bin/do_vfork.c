@@ -19,7 +19,7 @@
 
 int main(int argc, char **argv)
 {
-    int exitval, result;
+    int exitval;
     pid_t pid;
 
     /* Must use the vfork() library routine, because with syscall()
@@ -33,8 +33,5 @@ int main(int argc, char **argv)
 
     /* parent */
     exitval = pid;
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
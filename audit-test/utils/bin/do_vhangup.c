@@ -17,12 +17,9 @@
 
 int main()
 {
-    int exitval, result;
+    int exitval;
 
     errno = 0;
     exitval = vhangup();
-    result = exitval < 0;
-
-    fprintf(stderr, "%d %d %d\n", result, result ? errno : exitval, getpid());
-    return result;
+    return report_result(exitval);
 }
@@ -0,0 +1,56 @@
+/* =======================================================================
+ *   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of version 2 the GNU General Public License as
+ *   published by the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#include "includes.h"
+#ifdef LSM_SELINUX
+#include <selinux/selinux.h>
+#endif
+
+int report_result(long exitval)
+{
+    int err = errno;
+    int result = exitval < 0;
+
+    fprintf(stderr, "%d %ld %d\n", result, result ? err : exitval, getpid());
+    return result;
+}
+
+int set_create_context(const char *context)
+{
+#ifdef LSM_SELINUX
+    if (setfscreatecon((char *)context) < 0) {
+	fprintf(stderr, "%s: setfscreatecon: %s\n",
+		program_invocation_short_name, strerror(errno));
+	return -1;
+    }
+#endif
+    return 0;
+}
+
+int open_dirfd(const char *path)
+{
+    int fd;
+
+    if (!strcmp(path, "AT_FDCWD"))
+	return AT_FDCWD;
+
+    fd = open(path, O_DIRECTORY);
+    if (fd == -1)
+	fprintf(stderr, "%s: open dir_fd: %s\n",
+		program_invocation_short_name, strerror(errno));
+    return fd;
+}
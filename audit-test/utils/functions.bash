@@ -127,14 +127,210 @@ function xtables_empty {
     grep -e '^\*' -e '^:[^ ]* [^-]' -e '^COMMIT$' | sed 's/DROP/ACCEPT/ ; s/\[[0-9]*:[0-9]*\]/\[0:0\]/'
 }
 
+# tstsvr_ctl_start - keep the control connections open for the test run
+#
+# DESCRIPTION:
+#   Start lblnet_tst_ctl, which keeps one control connection open to each
+#   network server for the rest of the test run instead of tstsvr_call making
+#   a new one for every call.  It exits on its own once the calling shell is
+#   gone.  Exports LBLNET_CTL_PORT, returns non-zero if it could not be
+#   started, tstsvr_call then keeps making a connection per call.
+function tstsvr_ctl_start {
+    local port pid
+
+    [[ $LBLNET_CTL_PORT ]] && return 0
+    read port pid < <($TOPDIR/utils/network-server/lblnet_tst_ctl -d -w $$ \
+                          2>/dev/null)
+    [[ $port ]] || return 1
+    export LBLNET_CTL_PORT=$port
+}
+
+# tstsvr_call - send control messages to the network server
+#
+# usage: tstsvr_call [-t <timeout>] [-T <type> -L <level>] <server> <messages>
+#
+# DESCRIPTION:
+#   Send the control messages to the lblnet_tst_server at the given host and
+#   print the replies, waiting for them up to timeout seconds (default 3, 0
+#   for no limit).  With tstsvr_ctl_start done, the messages go over the
+#   persistent control connection, on a channel of their own, so that they
+#   behave as if sent over a new connection; "sockcon" applies just to them
+#   and a "detach" ends the call while the server goes on.  Calls with the
+#   SELinux type and level given by -T and -L, and all the calls without
+#   tstsvr_ctl_start, make a new connection with $cmd_nc (plain nc for a
+#   timeout other than the default) instead, under runcon for -T and -L.
+function tstsvr_call {
+    local timeout=3 opt fd reply
+    local -a ctx nc_cmd
+    local OPTIND=1
+
+    while getopts "t:T:L:" opt; do
+        case $opt in
+            t) timeout=$OPTARG ;;
+            T) ctx+=(-t "$OPTARG") ;;
+            L) ctx+=(-l "$OPTARG") ;;
+            *) return 2 ;;
+        esac
+    done
+    shift $((OPTIND - 1))
+    local server=$1 msgs=$2
+
+    if [[ $LBLNET_CTL_PORT ]] && ((${#ctx[@]} == 0)) &&
+        { exec {fd}<>/dev/tcp/127.0.0.1/$LBLNET_CTL_PORT; } 2>/dev/null; then
+        echo "$server $timeout $msgs" >&$fd
+        if ((timeout)); then
+            read -r -t $((timeout + 5)) reply <&$fd
+        else
+            read -r reply <&$fd
+        fi
+        exec {fd}>&-
+        [[ -z $reply ]] || echo "$reply"
+        return 0
+    fi
+
+    if ((timeout == 3)); then
+        nc_cmd=(${cmd_nc:-nc -w 3})
+    else
+        nc_cmd=(nc)
+        ((timeout)) && nc_cmd+=(-w $timeout)
+    fi
+    if ((${#ctx[@]})); then
+        runcon "${ctx[@]}" -- "${nc_cmd[@]}" $server 4000 <<< "$msgs"
+    else
+        "${nc_cmd[@]}" $server 4000 <<< "$msgs"
+    fi
+}
+
 # tstsvr_cleanup - cleanup the network server at a specified host
 #
 # DESCRIPTION:
 #   This script can be executed after each networking test as a sanity cleanup,
 #   to either kill any unfinished lblnet_tst_server instances spawned by xinetd,
 #   or to ensure that no remaining instances are frozen even when expres=success.
+#   The calls still in progress on the persistent control connection, if any,
+#   are cancelled instead of killing its instance: that one is not in the pid
+#   files pidfile_kill goes by (see drop_pid() in lblnet_tst_server.c), so the
+#   kill only hits the instances of the test's own connections.
 function tstsvr_cleanup {
-    nc -w 3 "$1" 4009 </dev/null
+    [[ $LBLNET_CTL_PORT ]] && tstsvr_call "$1" "cancel;" >/dev/null
+    ${cmd_nc:-nc -w 3} "$1" 4009 </dev/null
+}
+
+# tstsvr_notify_listen - notify the network server once a local port is ready
+#
+# usage: tstsvr_notify_listen <server> <host> <tcp|udp> <port> [timeout]
+#
+# DESCRIPTION:
+#   Start a background job which waits until a local socket listens on (TCP)
+#   or is bound to (UDP) the given port and then sends the "listen" control
+#   message to the network server, waking up the "wait_listen" command with
+#   the same host, protocol and port there.  This is meant to be used in place
+#   of fixed "sleep" commands before "sendrand", the server sending its data
+#   as soon as the test socket is ready.  The job gives up after timeout
+#   seconds (default 10), the server then falls back to its own wait_listen
+#   timeout.  Prints the PID of the background job.
+function tstsvr_notify_listen {
+    local server=$1 host=$2 proto=$3 port=$4 timeout=${5:-10}
+    local ss_opt i
+
+    case $proto in
+        tcp) ss_opt=-nlt ;;
+        udp) ss_opt=-nlu ;;
+        *) return 2 ;;
+    esac
+
+    (
+        for ((i = 0; i < timeout * 20; i++)); do
+            [[ $(ss $ss_opt "sport = :$port" | sed 1d) ]] && break
+            sleep 0.05
+        done
+        ((i < timeout * 20)) || exit 1
+
+        # the server may be still processing the setup, retry a few times
+        for ((i = 0; i < 10; i++)); do
+            [[ $(tstsvr_call $server "listen:$host,$proto,$port;") == 0 ]] \
+                && exit 0
+            sleep 0.1
+        done
+        exit 1
+    ) </dev/null &>/dev/null &
+    echo $!
+}
+
+# tstsvr_lock_acquire - lock a resource on the network server
+#
+# usage: tstsvr_lock_acquire <server> <resource> <lease> <wait>
+#
+# DESCRIPTION:
+#   Ask the lock manager of the network server for the lock on the given
+#   resource, waiting in line for up to wait seconds if somebody else holds
+#   it.  The lock is held for lease seconds unless renewed, see
+#   tstsvr_lock_renew.  Prints the lock token and returns 0 on success,
+#   returns 1 if the lock is busy, 2 if the server did not reply and 3 if the
+#   server has no lock manager (runs from xinetd, or is an older version not
+#   answering "lock:acquire" at all while answering "echo"), the caller then
+#   falls back to the "lock:set" command.
+function tstsvr_lock_acquire {
+    local server=$1 resource=$2 lease=$3 wait=$4
+    local reply
+
+    reply=$(tstsvr_call -t $((wait + 10)) $server \
+                "lock:acquire,$resource,$lease,$wait;")
+    case $reply in
+        "0 token="*) echo ${reply#0 token=}; return 0 ;;
+        "")
+            [[ $(tstsvr_call $server "echo:lock;") == lock ]] && return 3
+            return 2
+            ;;
+        95) return 3 ;;  # EOPNOTSUPP
+        *) return 1 ;;
+    esac
+}
+
+# tstsvr_lock_renew - keep renewing a lock held on the network server
+#
+# usage: tstsvr_lock_renew <server> <resource> <token> <lease>
+#
+# DESCRIPTION:
+#   Start a background job renewing the lease of a lock obtained by
+#   tstsvr_lock_acquire three times per lease, so that the lock is held as
+#   long as the job runs but is freed soon after the test host goes away.
+#   The job stops, with a warning, once the lock is lost, and silently once
+#   the shell which started it is gone, so that the lock expires after a
+#   crashed test.  Prints the PID of the background job, kill it before
+#   releasing the lock.
+function tstsvr_lock_renew {
+    local server=$1 resource=$2 token=$3 lease=$4
+    local i
+
+    (
+        while sleep $((lease / 3)); do
+            kill -0 $$ 2>/dev/null || exit 0
+            # a renewal may get lost on the way, try again before giving up
+            for ((i = 0; i < 3; i++)); do
+                [[ $(tstsvr_call $server \
+                        "lock:renew,$resource,$token,$lease;") == 0 ]] \
+                    && continue 2
+                sleep 1
+            done
+            echo "warning: lost the lock on $resource at $server" >&2
+            exit 1
+        done
+    ) </dev/null >/dev/null &
+    echo $!
+}
+
+# tstsvr_lock_release - release a lock held on the network server
+#
+# usage: tstsvr_lock_release <server> <resource> <token>
+#
+# DESCRIPTION:
+#   Release a lock obtained by tstsvr_lock_acquire, the next host waiting for
+#   it gets it right away.
+function tstsvr_lock_release {
+    local server=$1 resource=$2 token=$3
+
+    [[ $(tstsvr_call $server "lock:release,$resource,$token;") == 0 ]]
 }
 
 # parse_named - Parse key=value test arguments
@@ -358,6 +554,7 @@ function remote_call {
 
     local executable="$1"
     local data="$2"
+    local rc
 
     [ -z "$executable" ] && exit_error "Missing executable"
     [ -z "$LBLNET_SVR_IPV4" ] && exit_erro "LBLNET_SVR_IPV4 is not exported"
@@ -372,7 +569,9 @@ function remote_call {
     fi
     echo ""
 
-    /usr/bin/nc -v $LBLNET_SVR_IPV4 4000 <<< "remote_call:$executable,$data;"
+    # the exit status of the executable, if the server can tell
+    rc=$(tstsvr_call -t 0 $LBLNET_SVR_IPV4 "remote_call:$executable,$data;")
+    [ -n "$rc" ] && echo "Exit status = $rc"
 
     echo "---- END remote_call ----"
 
@@ -391,11 +590,19 @@ function is_fips {
 
 # check syscall relevancy to currently running system
 #
+# the (exported, space separated) SCREL_SYSCALLS list is turned into a hash
+# on first use, so that each lookup is O(1)
+#
 # returns 0 if a syscall is relevant, 1 otherwise
 sc_is_relevant()
 {
-	case " $SCREL_SYSCALLS " in *" $1 "*) return 0;; esac
-	return 1
+	if [[ ${_SCREL_LIST-unset} != "$SCREL_SYSCALLS" ]]; then
+	    declare -gA _SCREL=()
+	    declare -g _SCREL_LIST=$SCREL_SYSCALLS
+	    local sc
+	    for sc in $SCREL_SYSCALLS; do _SCREL[$sc]=1; done
+	fi
+	[[ $1 && ${_SCREL[$1]} ]]
 }
 
 # check if the do_socketcall wrapper supports given op
@@ -37,5 +37,6 @@
 #include <asm/types.h>
 
 #include "testsuite.h"
+#include "libdo.h"
 
 #endif
@@ -0,0 +1,40 @@
+/* =======================================================================
+ *   Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of version 2 the GNU General Public License as
+ *   published by the Free Software Foundation.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * =======================================================================
+ */
+
+#ifndef _LIBDO_H
+#define _LIBDO_H
+
+/*
+ * Code shared by the do_* syscall wrappers, built as libdo.a in utils/bin.
+ */
+
+/* Print the "<result> <errno|exitval> <pid>" line parsed by the test harness
+ * (see eval_syscall in functions.bash) for a syscall which returned exitval,
+ * negative exitval meaning failure.  Must be called right after the syscall,
+ * before errno gets overwritten.  Returns the result (TEST_SUCCESS or
+ * TEST_FAIL), to be used as the wrapper exit code. */
+int report_result(long exitval);
+
+/* Set the SELinux context for newly created files (setfscreatecon), no-op
+ * on systems without SELinux.  Returns 0 on success, -1 on error. */
+int set_create_context(const char *context);
+
+/* Open a directory for use with the *at() syscalls, "AT_FDCWD" meaning the
+ * current working directory.  Returns the fd (or AT_FDCWD), -1 on error. */
+int open_dirfd(const char *path);
+
+#endif	/* _LIBDO_H */
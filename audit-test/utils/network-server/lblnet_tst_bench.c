@@ -0,0 +1,761 @@
+/*  Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of version 2 the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * lblnet_tst_bench - labeled networking benchmark client
+ *
+ * Measures the network performance between the local host and a host running
+ * lblnet_tst_server, driving the server through its control protocol.  The
+ * SELinux context of the local end is the context this program runs in (use
+ * runcon), the context of the remote end is set by the "sockcon" control
+ * message (-c), so the same program measures unlabeled, NetLabel and labeled
+ * IPsec traffic depending on the port and contexts used.
+ *
+ * modes:
+ *
+ *  tx    send <bytes> to the server over TCP ("recv" on the server)
+ *  rx    receive <bytes> from the server over TCP or UDP ("sendrand")
+ *  conn  accept <count> TCP connections initiated by the server
+ *  rtt   time <count> TCP handshakes with the server
+ *
+ * The results are printed as key=value lines.  The server is driven through
+ * its framed control protocol, so the replies are matched to the requests by
+ * their id and the requests can be pipelined.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define CTL_PORT_DEFAULT        "4000"
+#define CTL_MSG_SIZE            65536
+#define CTL_HDR_SIZE            12      /* length, id, channel */
+#define CTL_ID_SOCKCON          0
+#define CTL_ID_TEST             1
+#define BUF_SIZE                262144
+#define VLEN                    64
+#define CONNECT_RETRY_USECS     1000
+#define UDP_IDLE_MSECS          1000
+
+/* command line */
+char *mode = NULL;
+char *ctl_host = NULL;
+char *ctl_port = CTL_PORT_DEFAULT;
+char *remote_host = NULL;
+char *local_host = NULL;
+char *proto = "tcp";
+char *port = NULL;
+char *sockcon = NULL;
+size_t bytes = 16 * 1024 * 1024;
+size_t msg_size = 1024;
+unsigned int count = 100;
+unsigned int timeout_sec = 30;
+
+unsigned char *buf = NULL;
+
+/**
+ * fatal - Print an error message with the errno description and exit
+ * @msg: message
+ *
+ */
+void fatal(const char *msg)
+{
+	perror(msg);
+	exit(2);
+}
+
+/**
+ * die - Print an error message and exit
+ * @msg: message
+ *
+ */
+void die(const char *msg)
+{
+	fprintf(stderr, "error: %s\n", msg);
+	exit(2);
+}
+
+/**
+ * time_us - Get the current monotonic time in microseconds
+ *
+ */
+long long time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * sock_open - Create a socket bound or connected to a host and port
+ * @host: host
+ * @type: socket type
+ * @do_listen: bind and listen (TCP) on the address instead of connecting
+ *
+ * Description:
+ * Returns the socket, -1 and errno set if the connection is refused, exits on
+ * other errors.
+ *
+ */
+int sock_open(const char *host, const char *svc, int type, int do_listen)
+{
+	int rc;
+	int sock;
+	int bool_true = 1;
+	struct addrinfo hints, *ai;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = type;
+	hints.ai_flags = (do_listen ? AI_PASSIVE : 0);
+	rc = getaddrinfo(host, svc, &hints, &ai);
+	if (rc != 0) {
+		fprintf(stderr, "error: cannot resolve %s (%s)\n",
+			host, gai_strerror(rc));
+		exit(2);
+	}
+
+	sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (sock < 0)
+		fatal("socket");
+	if (do_listen) {
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
+			   &bool_true, sizeof(bool_true));
+		if (bind(sock, ai->ai_addr, ai->ai_addrlen) < 0)
+			fatal("bind");
+		if (type == SOCK_STREAM && listen(sock, count) < 0)
+			fatal("listen");
+	} else if (connect(sock, ai->ai_addr, ai->ai_addrlen) < 0) {
+		rc = errno;
+		close(sock);
+		freeaddrinfo(ai);
+		if (rc != ECONNREFUSED) {
+			errno = rc;
+			fatal("connect");
+		}
+		errno = rc;
+		return -1;
+	}
+
+	freeaddrinfo(ai);
+	return sock;
+}
+
+/**
+ * sock_connect_retry - Connect to the server's data port
+ * @rtt: if not NULL, set to the duration of the successful connect()
+ *
+ * Description:
+ * The server binds its data socket right after it sends the preceding reply,
+ * retry refused connections for a while to close that race.
+ *
+ */
+int sock_connect_retry(long long *rtt)
+{
+	int sock;
+	long long start;
+	long long deadline = time_us() + timeout_sec * 1000000LL;
+
+	do {
+		start = time_us();
+		sock = sock_open(remote_host, port, SOCK_STREAM, 0);
+		if (sock >= 0) {
+			if (rtt != NULL)
+				*rtt = time_us() - start;
+			return sock;
+		}
+		usleep(CONNECT_RETRY_USECS);
+	} while (time_us() < deadline);
+
+	die("server data port not available");
+	return -1;
+}
+
+/**
+ * ctl_send - Send a request to the server
+ * @sock: control socket
+ * @id: request id
+ * @msg: control messages
+ *
+ */
+void ctl_send(int sock, uint32_t id, const char *msg)
+{
+	uint32_t hdr[3];
+	size_t len = strlen(msg);
+	struct iovec iov[2];
+
+	/* everything on the channel of the connection itself */
+	hdr[0] = htonl(len);
+	hdr[1] = htonl(id);
+	hdr[2] = htonl(0);
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = CTL_HDR_SIZE;
+	iov[1].iov_base = (char *)msg;
+	iov[1].iov_len = len;
+	if (writev(sock, iov, 2) != CTL_HDR_SIZE + len)
+		fatal("write to the control socket");
+}
+
+/**
+ * ctl_read - Read from the control socket
+ * @sock: control socket
+ * @buf: buffer
+ * @len: number of bytes to read
+ *
+ * Description:
+ * Read exactly @len bytes, exits on EOF or when the timeout expires.
+ *
+ */
+void ctl_read(int sock, void *buf, size_t len)
+{
+	ssize_t rc;
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
+
+	while (len > 0) {
+		rc = poll(&pfd, 1, timeout_sec * 1000);
+		if (rc == 0)
+			die("timeout waiting for the server");
+		if (rc < 0)
+			fatal("poll");
+		rc = read(sock, buf, len);
+		if (rc < 0)
+			fatal("read from the control socket");
+		if (rc == 0)
+			die("server closed the control connection");
+		buf = (char *)buf + rc;
+		len -= rc;
+	}
+}
+
+/**
+ * ctl_recv - Receive the response to a request
+ * @sock: control socket
+ * @id: request id
+ * @len: length of the response
+ *
+ * Description:
+ * Returns the reply records of the response to request @id, see ctl_reply().
+ * Requests are answered in order, so the next response is always the one to
+ * the oldest request.
+ *
+ */
+char *ctl_recv(int sock, uint32_t id, size_t *len)
+{
+	uint32_t hdr[3];
+	char *resp;
+
+	ctl_read(sock, hdr, CTL_HDR_SIZE);
+	if (ntohl(hdr[1]) != id)
+		die("unexpected response from the server");
+	*len = ntohl(hdr[0]);
+	resp = malloc(*len + 1);
+	if (resp == NULL)
+		fatal("malloc");
+	ctl_read(sock, resp, *len);
+
+	return resp;
+}
+
+/**
+ * ctl_reply - Get the next reply record of a response
+ * @pos: current position in the response, updated
+ * @end: end of the response
+ * @out: buffer for the reply
+ * @out_len: size of @out
+ *
+ * Description:
+ * Copy the next reply (truncated to fit) as a string to @out, returns zero on
+ * success, -1 if there are no more replies.
+ *
+ */
+int ctl_reply(char **pos, char *end, char *out, size_t out_len)
+{
+	uint32_t rec_len;
+	size_t len;
+
+	if (end - *pos < sizeof(rec_len))
+		return -1;
+	memcpy(&rec_len, *pos, sizeof(rec_len));
+	*pos += sizeof(rec_len);
+	rec_len = ntohl(rec_len);
+	if (end - *pos < rec_len)
+		die("bad response from the server");
+	len = (rec_len < out_len ? rec_len : out_len - 1);
+	memcpy(out, *pos, len);
+	out[len] = '\0';
+	*pos += rec_len;
+
+	return 0;
+}
+
+/**
+ * ctl_recv_one - Receive the response to a request with a single message
+ * @sock: control socket
+ * @id: request id
+ * @out: buffer for the reply
+ * @out_len: size of @out
+ *
+ */
+void ctl_recv_one(int sock, uint32_t id, char *out, size_t out_len)
+{
+	char *resp, *pos;
+	size_t len;
+
+	resp = ctl_recv(sock, id, &len);
+	pos = resp;
+	if (ctl_reply(&pos, resp + len, out, out_len) < 0)
+		die("empty response from the server");
+	free(resp);
+}
+
+/**
+ * ctl_open - Open a control connection
+ *
+ * Description:
+ * Open a control connection and request the socket context (if any) for the
+ * data sockets, the result is checked by ctl_check() so that the first
+ * request of the test can be sent meanwhile.
+ *
+ */
+int ctl_open(void)
+{
+	int sock;
+	char msg[1024];
+
+	sock = sock_open(ctl_host, ctl_port, SOCK_STREAM, 0);
+	if (sock < 0)
+		fatal("connect to the control port");
+
+	if (sockcon != NULL) {
+		if (snprintf(msg, sizeof(msg),
+			     "sockcon:full,%s;", sockcon) >= sizeof(msg))
+			die("socket context too long");
+		ctl_send(sock, CTL_ID_SOCKCON, msg);
+	}
+
+	return sock;
+}
+
+/**
+ * ctl_check - Check the "sockcon" result
+ * @sock: control socket
+ *
+ */
+void ctl_check(int sock)
+{
+	char reply[64];
+
+	if (sockcon == NULL)
+		return;
+
+	ctl_recv_one(sock, CTL_ID_SOCKCON, reply, sizeof(reply));
+	if (strcmp(reply, "0") != 0) {
+		fprintf(stderr, "error: sockcon failed (%s)\n", reply);
+		exit(2);
+	}
+}
+
+/**
+ * print_stats - Print the results of the server side
+ * @reply: "<rc> bytes=<n> usecs=<n> mbps=<n>" reply
+ *
+ */
+void print_stats(const char *reply)
+{
+	int rc;
+	char *stats;
+
+	rc = atoi(reply);
+	if (rc != 0) {
+		fprintf(stderr, "error: server failed (%s)\n", reply);
+		exit(2);
+	}
+	stats = strstr(reply, "mbps=");
+	if (stats != NULL)
+		printf("server_mbps=%s\n", stats + 5);
+}
+
+/**
+ * print_rate - Print the local side transfer results
+ *
+ */
+void print_rate(size_t done, long long usecs)
+{
+	printf("bytes=%zu\n", done);
+	printf("usecs=%lld\n", usecs);
+	printf("mbps=%.2f\n", (usecs > 0 ? done * 8.0 / usecs : 0));
+}
+
+/**
+ * bench_tx - Send data to the server
+ *
+ */
+void bench_tx(void)
+{
+	int ctl, sock;
+	ssize_t rc;
+	size_t done = 0, len;
+	long long start;
+	char msg[256], reply[256];
+
+	snprintf(msg, sizeof(msg), "recv:%s,tcp,%s,%zu,stats;",
+		 (strchr(remote_host, ':') ? "ipv6" : "ipv4"), port, bytes);
+	ctl = ctl_open();
+	ctl_send(ctl, CTL_ID_TEST, msg);
+	ctl_check(ctl);
+	sock = sock_connect_retry(NULL);
+
+	start = time_us();
+	while (done < bytes) {
+		len = (bytes - done > BUF_SIZE ? BUF_SIZE : bytes - done);
+		rc = send(sock, buf, len, MSG_NOSIGNAL);
+		if (rc < 0)
+			fatal("send");
+		done += rc;
+	}
+	shutdown(sock, SHUT_WR);
+	/* wait for the server to read everything */
+	while (recv(sock, buf, BUF_SIZE, 0) > 0)
+		;
+	print_rate(done, time_us() - start);
+	close(sock);
+
+	ctl_recv_one(ctl, CTL_ID_TEST, reply, sizeof(reply));
+	print_stats(reply);
+	close(ctl);
+}
+
+/**
+ * bench_rx_tcp - Receive data from the server over TCP
+ *
+ */
+void bench_rx_tcp(int lsock)
+{
+	int sock;
+	ssize_t rc;
+	size_t done = 0;
+	long long start = 0, last = 0;
+
+	sock = accept(lsock, NULL, NULL);
+	if (sock < 0)
+		fatal("accept");
+	while ((rc = recv(sock, NULL, BUF_SIZE, MSG_TRUNC)) > 0) {
+		last = time_us();
+		if (start == 0)
+			start = last;
+		done += rc;
+	}
+	if (rc < 0)
+		fatal("recv");
+	close(sock);
+
+	print_rate(done, last - start);
+}
+
+/**
+ * bench_rx_udp - Receive data from the server over UDP
+ *
+ * Description:
+ * Receive datagrams until all the data arrived or nothing came for a while,
+ * the missing bytes are reported as lost.
+ *
+ */
+void bench_rx_udp(int sock)
+{
+	int rc, iter;
+	size_t done = 0;
+	long long start = 0, last = 0;
+	char bytes_buf[VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovs[VLEN];
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
+
+	memset(msgs, 0, sizeof(msgs));
+	for (iter = 0; iter < VLEN; iter++) {
+		iovs[iter].iov_base = &bytes_buf[iter];
+		iovs[iter].iov_len = 1;
+		msgs[iter].msg_hdr.msg_iov = &iovs[iter];
+		msgs[iter].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (done < bytes) {
+		rc = poll(&pfd, 1, (start ? UDP_IDLE_MSECS : timeout_sec * 1000));
+		if (rc < 0)
+			fatal("poll");
+		if (rc == 0)
+			break;
+		rc = recvmmsg(sock, msgs, VLEN, MSG_TRUNC | MSG_DONTWAIT, NULL);
+		if (rc < 0) {
+			if (errno == EAGAIN)
+				continue;
+			fatal("recvmmsg");
+		}
+		last = time_us();
+		if (start == 0)
+			start = last;
+		for (iter = 0; iter < rc; iter++)
+			done += msgs[iter].msg_len;
+	}
+
+	print_rate(done, last - start);
+	printf("lost=%zu\n", (done < bytes ? bytes - done : 0));
+}
+
+/**
+ * bench_rx - Receive data from the server
+ *
+ */
+void bench_rx(void)
+{
+	int ctl, lsock;
+	int udp = (strcmp(proto, "udp") == 0);
+	char msg[256], reply[256];
+
+	lsock = sock_open(local_host, port,
+			  (udp ? SOCK_DGRAM : SOCK_STREAM), 1);
+	snprintf(msg, sizeof(msg), "sendrand:%s,%s,%s,%zu,size=%zu,stats;",
+		 local_host, proto, port, bytes, msg_size);
+	ctl = ctl_open();
+	ctl_send(ctl, CTL_ID_TEST, msg);
+	ctl_check(ctl);
+
+	if (udp)
+		bench_rx_udp(lsock);
+	else
+		bench_rx_tcp(lsock);
+	close(lsock);
+
+	ctl_recv_one(ctl, CTL_ID_TEST, reply, sizeof(reply));
+	print_stats(reply);
+	close(ctl);
+}
+
+/**
+ * bench_conn - Accept connections initiated by the server
+ *
+ * Description:
+ * All the "sendrand" messages go in a single request, answered once all the
+ * connections are done.
+ *
+ */
+void bench_conn(void)
+{
+	int ctl, lsock, sock;
+	unsigned int iter;
+	long long start = 0;
+	long long usecs;
+	char *msg, *resp, *pos;
+	char reply[64];
+	size_t len = 0;
+
+	lsock = sock_open(local_host, port, SOCK_STREAM, 1);
+	msg = malloc(CTL_MSG_SIZE);
+	if (msg == NULL)
+		fatal("malloc");
+	for (iter = 0; iter < count; iter++) {
+		len += snprintf(msg + len, CTL_MSG_SIZE - len,
+				"sendrand:%s,tcp,%s,1;", local_host, port);
+		if (len >= CTL_MSG_SIZE)
+			die("too many connections");
+	}
+	ctl = ctl_open();
+	ctl_send(ctl, CTL_ID_TEST, msg);
+	ctl_check(ctl);
+
+	for (iter = 0; iter < count; iter++) {
+		sock = accept(lsock, NULL, NULL);
+		if (sock < 0)
+			fatal("accept");
+		if (start == 0)
+			start = time_us();
+		while (recv(sock, buf, BUF_SIZE, 0) > 0)
+			;
+		close(sock);
+	}
+	usecs = time_us() - start;
+	close(lsock);
+
+	/* one reply per connection */
+	resp = ctl_recv(ctl, CTL_ID_TEST, &len);
+	pos = resp;
+	for (iter = 0; ctl_reply(&pos, resp + len, reply, sizeof(reply)) == 0;
+	     iter++)
+		if (strcmp(reply, "0") != 0) {
+			fprintf(stderr, "error: server failed (%s)\n", reply);
+			exit(2);
+		}
+	if (iter != count)
+		die("missing replies from the server");
+	free(resp);
+	close(ctl);
+
+	printf("conns=%u\n", count);
+	printf("usecs=%lld\n", usecs);
+	printf("conn_rate=%.2f\n",
+	       (usecs > 0 ? (count - 1) * 1000000.0 / usecs : 0));
+	free(msg);
+}
+
+/**
+ * cmp_ll - qsort() comparator for long long
+ *
+ */
+int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * bench_rtt - Time TCP handshakes with the server
+ *
+ * Description:
+ * connect() returns once the SYN-ACK arrived, so its duration is one round
+ * trip including the labeling work on both sides.  Every handshake needs a
+ * new "recv" on the server, each in its own request so that its response
+ * tells that it is finished, all the requests are sent upfront.
+ *
+ */
+void bench_rtt(void)
+{
+	int ctl, sock;
+	unsigned int iter;
+	long long *rtt, sum = 0;
+	char msg[256];
+	char reply[64];
+
+	rtt = calloc(count, sizeof(*rtt));
+	if (rtt == NULL)
+		fatal("malloc");
+	snprintf(msg, sizeof(msg), "recv:%s,tcp,%s,0;",
+		 (strchr(remote_host, ':') ? "ipv6" : "ipv4"), port);
+	ctl = ctl_open();
+	for (iter = 0; iter < count; iter++)
+		ctl_send(ctl, CTL_ID_TEST + iter, msg);
+	ctl_check(ctl);
+
+	for (iter = 0; iter < count; iter++) {
+		sock = sock_connect_retry(&rtt[iter]);
+		if (send(sock, "x", 1, MSG_NOSIGNAL) != 1)
+			fatal("send");
+		close(sock);
+		ctl_recv_one(ctl, CTL_ID_TEST + iter, reply, sizeof(reply));
+		if (strcmp(reply, "0") != 0) {
+			fprintf(stderr, "error: server failed (%s)\n", reply);
+			exit(2);
+		}
+		sum += rtt[iter];
+	}
+	close(ctl);
+
+	qsort(rtt, count, sizeof(*rtt), cmp_ll);
+	printf("conns=%u\n", count);
+	printf("rtt_min=%lld\n", rtt[0]);
+	printf("rtt_avg=%lld\n", sum / count);
+	printf("rtt_p50=%lld\n", rtt[count / 2]);
+	printf("rtt_p99=%lld\n", rtt[(count * 99) / 100]);
+	printf("rtt_max=%lld\n", rtt[count - 1]);
+	free(rtt);
+}
+
+/**
+ * usage - Print a usage message and exit
+ *
+ */
+void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s -m tx|rx|conn|rtt -s <ctl_host> -p <port>\n"
+		"          [-r <remote_host>] [-l <local_host>] [-P tcp|udp]\n"
+		"          [-c <context>] [-C <ctl_port>] [-b <bytes>]\n"
+		"          [-z <datagram_size>] [-n <count>] [-t <secs>]\n"
+		"\n"
+		"  -s  control host, running lblnet_tst_server\n"
+		"  -r  server address for the data (tx, rtt), default <ctl_host>\n"
+		"  -l  local address for the data (rx, conn)\n"
+		"  -p  data port\n"
+		"  -c  full SELinux context of the server data sockets\n"
+		"  -b  bytes to transfer (tx, rx), default %zu\n"
+		"  -z  UDP datagram size (rx), default %zu\n"
+		"  -n  number of connections (conn, rtt), default %u\n"
+		"  -t  timeout in seconds, default %u\n",
+		name, bytes, msg_size, count, timeout_sec);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:s:C:r:l:P:p:c:b:z:n:t:h")) != -1) {
+		switch (opt) {
+		case 'm': mode = optarg; break;
+		case 's': ctl_host = optarg; break;
+		case 'C': ctl_port = optarg; break;
+		case 'r': remote_host = optarg; break;
+		case 'l': local_host = optarg; break;
+		case 'P': proto = optarg; break;
+		case 'p': port = optarg; break;
+		case 'c': sockcon = optarg; break;
+		case 'b': bytes = strtoull(optarg, NULL, 0); break;
+		case 'z': msg_size = strtoul(optarg, NULL, 0); break;
+		case 'n': count = strtoul(optarg, NULL, 0); break;
+		case 't': timeout_sec = strtoul(optarg, NULL, 0); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (mode == NULL || ctl_host == NULL || port == NULL || count < 1 ||
+	    (strcmp(proto, "tcp") != 0 && strcmp(proto, "udp") != 0))
+		usage(argv[0]);
+	if (remote_host == NULL)
+		remote_host = ctl_host;
+
+	buf = mmap(NULL, BUF_SIZE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED)
+		fatal("mmap");
+	memset(buf, 'x', BUF_SIZE);
+
+	printf("mode=%s\n", mode);
+	if (strcmp(mode, "tx") == 0 && strcmp(proto, "tcp") == 0)
+		bench_tx();
+	else if (strcmp(mode, "rx") == 0 && local_host != NULL)
+		bench_rx();
+	else if (strcmp(mode, "conn") == 0 && local_host != NULL)
+		bench_conn();
+	else if (strcmp(mode, "rtt") == 0)
+		bench_rtt();
+	else
+		usage(argv[0]);
+
+	return 0;
+}
+
+/* vim: set ts=8 sts=8 sw=8 noet: */
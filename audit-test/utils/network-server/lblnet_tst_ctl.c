@@ -0,0 +1,832 @@
+/*  Copyright (c) 2026 Red Hat, Inc. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of version 2 the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * lblnet_tst_ctl - persistent control connections to lblnet_tst_server
+ *
+ * Keeps one control connection open to each lblnet_tst_server the test run
+ * talks to, so that the bash helpers do not need a new TCP connection, and a
+ * new server instance when run by xinetd, for every control message they
+ * send.  The helpers talk to it over a loopback socket, one line per call:
+ *
+ *  <server> <timeout> <message>;[<message>;...]
+ *
+ * with the timeout in seconds, 0 for none.  The reply line has the replies to
+ * all the messages concatenated, the same as a text protocol connection
+ * would get, and is empty if the call failed or timed out.  If the server
+ * closes the connection, e.g. its xinetd instance was killed, the next call
+ * reconnects.  Connecting and sending never block, a slow or unreachable
+ * server only holds up the calls to it.
+ *
+ * Every call runs on a channel of its own within the framed protocol
+ * connection (see lblnet_tst_server.c), with a "detach" appended, so a call
+ * behaves exactly as a separate connection to the server would, e.g. a call
+ * with "sockcon;detach;recv;" returns right after the "detach" while the
+ * "recv" goes on on the server.
+ *
+ * usage: lblnet_tst_ctl [-d] [-w <pid>]
+ *
+ * The local port and the pid of the program are printed as "<port> <pid>"
+ * once it is ready, -d runs it in the background, -w makes it exit once the
+ * given process is gone.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define CTL_PORT                "4000"
+#define CTL_HDR_SIZE            12      /* length, id, channel */
+#define CTL_LEN_MAX             0x00ffffff
+#define CTL_DETACH              "detach;"
+#define CONNECT_TIMEOUT_SEC     10
+#define CLIENT_MAX              64
+#define LINE_LEN_MAX            65536
+#define WATCH_MSECS             1000
+
+/* control connection to a server */
+struct upstream {
+	char *server;
+	int sock;                       /* -1 if not connected */
+	int connecting;                 /* connect() in progress */
+	long long deadline;             /* msecs, end of the connect() */
+	struct addrinfo *ai;            /* addresses of the server */
+	struct addrinfo *ai_next;       /* next address to try */
+	char *buf;                      /* responses received so far */
+	size_t len;
+	size_t size;
+	char *out;                      /* requests not sent yet */
+	size_t out_len;
+	size_t out_size;
+	uint32_t next_id;
+	uint32_t next_chan;             /* never 0, the connection itself */
+	struct upstream *next;
+};
+
+/* client of this program, one of the bash helpers */
+struct client {
+	int sock;                       /* -1 if the slot is free */
+	char *buf;                      /* incoming lines */
+	size_t len;
+	struct call *call;              /* call in progress, NULL if none */
+};
+
+/* call, a line from a client */
+struct call {
+	struct client *client;          /* NULL once the client is gone */
+	char *reply;
+	size_t reply_len;
+	size_t reply_size;
+	int pending;                    /* requests without a response */
+	long long deadline;             /* msecs, 0 for none */
+};
+
+/* request sent to a server on behalf of a call */
+struct req {
+	struct call *call;
+	struct upstream *up;
+	uint32_t id;
+	struct req *next;
+};
+
+struct upstream *up_list = NULL;
+struct client clients[CLIENT_MAX];
+struct req *req_list = NULL;
+
+/**
+ * fatal - Print an error message with the errno description and exit
+ * @msg: message
+ *
+ */
+void fatal(const char *msg)
+{
+	perror(msg);
+	exit(2);
+}
+
+/**
+ * time_ms - Get the current monotonic time in milliseconds
+ *
+ */
+long long time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * buf_add - Append data to a growing buffer
+ * @buf: buffer, updated
+ * @len: length of the data in @buf, updated
+ * @size: size of @buf, updated
+ * @data: data
+ * @data_len: length of @data
+ *
+ * Description:
+ * Returns zero on success, negative values if out of memory.
+ *
+ */
+int buf_add(char **buf, size_t *len, size_t *size,
+	    const void *data, size_t data_len)
+{
+	char *new_buf;
+	size_t new_size;
+
+	if (*len + data_len + 1 > *size) {
+		new_size = *size * 2;
+		if (new_size < *len + data_len + 1)
+			new_size = *len + data_len + 1;
+		new_buf = realloc(*buf, new_size);
+		if (new_buf == NULL)
+			return -1;
+		*buf = new_buf;
+		*size = new_size;
+	}
+	memcpy(*buf + *len, data, data_len);
+	*len += data_len;
+	(*buf)[*len] = '\0';
+
+	return 0;
+}
+
+/**
+ * call_done - Reply to a call
+ * @call: call
+ * @ok: the reply is complete
+ *
+ * Description:
+ * Send the reply, or an empty line if @ok is false, to the client of @call
+ * and free it.  The requests still waiting for a response are forgotten.
+ *
+ */
+void call_done(struct call *call, int ok)
+{
+	struct req **iter, *req;
+	struct client *client = call->client;
+	struct iovec iov[2];
+
+	for (iter = &req_list; *iter != NULL;) {
+		req = *iter;
+		if (req->call == call) {
+			*iter = req->next;
+			free(req);
+		} else
+			iter = &req->next;
+	}
+
+	if (client != NULL) {
+		iov[0].iov_base = call->reply;
+		iov[0].iov_len = (ok ? call->reply_len : 0);
+		iov[1].iov_base = "\n";
+		iov[1].iov_len = 1;
+		if (writev(client->sock, iov, 2) < 0)
+			perror("write to the client");
+		client->call = NULL;
+	}
+	free(call->reply);
+	free(call);
+}
+
+/**
+ * up_close - Close a control connection
+ * @up: control connection
+ *
+ * Description:
+ * Fail the calls waiting for a response on @up, the next call reconnects.
+ *
+ */
+void up_close(struct upstream *up)
+{
+	struct req *req;
+
+	if (up->sock >= 0)
+		close(up->sock);
+	up->sock = -1;
+	up->connecting = 0;
+	up->len = 0;
+	up->out_len = 0;
+	if (up->ai != NULL)
+		freeaddrinfo(up->ai);
+	up->ai = NULL;
+
+	for (;;) {
+		for (req = req_list; req != NULL; req = req->next)
+			if (req->up == up)
+				break;
+		if (req == NULL)
+			break;
+		call_done(req->call, 0);
+	}
+}
+
+/**
+ * up_connect - Open a control connection
+ * @up: control connection
+ *
+ * Description:
+ * Start connecting to the next address of the server of @up, without
+ * waiting, the first one if there is no connection attempt yet.  The poll
+ * loop finishes the connection, see up_connected().  Returns zero on
+ * success, negative values if there is no address left to try.
+ *
+ */
+int up_connect(struct upstream *up)
+{
+	struct addrinfo hints;
+
+	if (up->ai == NULL) {
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_NUMERICSERV;
+		if (getaddrinfo(up->server, CTL_PORT, &hints, &up->ai) != 0) {
+			up->ai = NULL;
+			return -1;
+		}
+		up->ai_next = up->ai;
+	}
+
+	for (; up->ai_next != NULL; up->ai_next = up->ai_next->ai_next) {
+		up->sock = socket(up->ai_next->ai_family,
+				  up->ai_next->ai_socktype | SOCK_NONBLOCK,
+				  up->ai_next->ai_protocol);
+		if (up->sock < 0)
+			continue;
+		if (connect(up->sock, up->ai_next->ai_addr,
+			    up->ai_next->ai_addrlen) == 0 ||
+		    errno == EINPROGRESS) {
+			up->connecting = 1;
+			up->deadline = time_ms() + CONNECT_TIMEOUT_SEC * 1000LL;
+			up->ai_next = up->ai_next->ai_next;
+			return 0;
+		}
+		close(up->sock);
+		up->sock = -1;
+	}
+
+	return -1;
+}
+
+/**
+ * up_flush - Send the queued requests to a server
+ * @up: control connection
+ *
+ * Description:
+ * Send as much of the queued requests as the socket takes without blocking,
+ * the poll loop calls it again once there is room for the rest.
+ *
+ */
+void up_flush(struct upstream *up)
+{
+	ssize_t rc;
+
+	if (up->sock < 0 || up->connecting || up->out_len == 0)
+		return;
+
+	rc = send(up->sock, up->out, up->out_len, 0);
+	if (rc < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			up_close(up);
+		return;
+	}
+	up->out_len -= rc;
+	memmove(up->out, up->out + rc, up->out_len);
+}
+
+/**
+ * up_connected - Finish connecting to a server
+ * @up: control connection
+ * @timeout: the connection attempt took too long
+ *
+ * Description:
+ * Called when the socket of a connection in progress is writable or its
+ * deadline passed, moves on to the next address of the server if the
+ * attempt failed and fails the calls waiting on @up if none is left.
+ *
+ */
+void up_connected(struct upstream *up, int timeout)
+{
+	int err = ETIMEDOUT;
+	socklen_t err_len = sizeof(err);
+
+	if (!timeout &&
+	    getsockopt(up->sock, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0)
+		err = errno;
+	if (err == 0) {
+		up->connecting = 0;
+		freeaddrinfo(up->ai);
+		up->ai = NULL;
+		up_flush(up);
+		return;
+	}
+
+	close(up->sock);
+	up->sock = -1;
+	up->connecting = 0;
+	if (up_connect(up) < 0)
+		up_close(up);
+}
+
+/**
+ * up_get - Get the control connection for a server
+ * @server: server
+ *
+ * Description:
+ * Returns the control connection, connected or connecting, or NULL on
+ * error.
+ *
+ */
+struct upstream *up_get(const char *server)
+{
+	struct upstream *up;
+
+	for (up = up_list; up != NULL; up = up->next)
+		if (strcmp(up->server, server) == 0)
+			break;
+
+	if (up == NULL) {
+		up = calloc(1, sizeof(*up));
+		if (up == NULL)
+			return NULL;
+		up->server = strdup(server);
+		up->sock = -1;
+		up->next_id = 1;
+		up->next_chan = 1;
+		up->next = up_list;
+		up_list = up;
+	}
+
+	if (up->sock < 0 && up_connect(up) < 0) {
+		up_close(up);
+		return NULL;
+	}
+
+	return up;
+}
+
+/**
+ * up_send - Send the messages of a call to a server
+ * @up: control connection
+ * @call: call
+ * @msgs: control messages
+ *
+ * Description:
+ * Queue @msgs, followed by a "detach", as a request on a new channel of @up
+ * and send what can be sent right away, returns zero on success, negative
+ * values on failure.
+ *
+ */
+int up_send(struct upstream *up, struct call *call, const char *msgs)
+{
+	uint32_t hdr[3];
+	size_t len = strlen(msgs);
+	const char *term = (len > 0 && msgs[len - 1] == ';' ? "" : ";");
+	size_t total = len + strlen(term) + strlen(CTL_DETACH);
+	struct req *req;
+
+	if (total > CTL_LEN_MAX)
+		return -1;
+	req = malloc(sizeof(*req));
+	if (req == NULL)
+		return -1;
+
+	hdr[0] = htonl(total);
+	hdr[1] = htonl(up->next_id);
+	hdr[2] = htonl(up->next_chan);
+	if (buf_add(&up->out, &up->out_len, &up->out_size,
+		    hdr, CTL_HDR_SIZE) < 0 ||
+	    buf_add(&up->out, &up->out_len, &up->out_size, msgs, len) < 0 ||
+	    buf_add(&up->out, &up->out_len, &up->out_size,
+		    term, strlen(term)) < 0 ||
+	    buf_add(&up->out, &up->out_len, &up->out_size,
+		    CTL_DETACH, strlen(CTL_DETACH)) < 0) {
+		free(req);
+		up_close(up);
+		return -1;
+	}
+
+	req->call = call;
+	req->up = up;
+	req->id = up->next_id;
+	req->next = req_list;
+	req_list = req;
+	call->pending++;
+
+	up->next_id++;
+	if (++up->next_chan == 0)
+		up->next_chan = 1;
+
+	up_flush(up);
+	return 0;
+}
+
+/**
+ * up_response - Handle a response from a server
+ * @up: control connection
+ * @id: request id
+ * @resp: reply records
+ * @len: length of @resp
+ *
+ * Description:
+ * Add the replies to the reply of the call, with newlines turned into
+ * spaces, and finish the call once all of its requests are done.
+ *
+ */
+void up_response(struct upstream *up, uint32_t id, char *resp, size_t len)
+{
+	struct req **iter, *req;
+	struct call *call;
+	uint32_t rec_len;
+	size_t off, i;
+
+	for (iter = &req_list; *iter != NULL; iter = &(*iter)->next)
+		if ((*iter)->up == up && (*iter)->id == id)
+			break;
+	req = *iter;
+	if (req == NULL)
+		/* the call timed out already */
+		return;
+	*iter = req->next;
+	call = req->call;
+	free(req);
+
+	for (off = 0; off + sizeof(rec_len) <= len; off += rec_len) {
+		memcpy(&rec_len, resp + off, sizeof(rec_len));
+		rec_len = ntohl(rec_len);
+		off += sizeof(rec_len);
+		if (rec_len > len - off)
+			break;
+		for (i = off; i < off + rec_len; i++)
+			if (resp[i] == '\n')
+				resp[i] = ' ';
+		if (buf_add(&call->reply, &call->reply_len, &call->reply_size,
+			    resp + off, rec_len) < 0)
+			break;
+	}
+
+	if (--call->pending == 0)
+		call_done(call, 1);
+}
+
+/**
+ * up_read - Read responses from a server
+ * @up: control connection
+ *
+ */
+void up_read(struct upstream *up)
+{
+	ssize_t rc;
+	char buf[LINE_LEN_MAX];
+	uint32_t hdr[3];
+	size_t off, len;
+
+	rc = recv(up->sock, buf, sizeof(buf), 0);
+	if (rc < 0 && errno == EINTR)
+		return;
+	if (rc <= 0 || buf_add(&up->buf, &up->len, &up->size, buf, rc) < 0) {
+		up_close(up);
+		return;
+	}
+
+	for (off = 0; up->len - off >= CTL_HDR_SIZE; off += len) {
+		memcpy(hdr, up->buf + off, CTL_HDR_SIZE);
+		len = ntohl(hdr[0]);
+		if (up->len - off - CTL_HDR_SIZE < len)
+			break;
+		off += CTL_HDR_SIZE;
+		up_response(up, ntohl(hdr[1]), up->buf + off, len);
+	}
+	up->len -= off;
+	memmove(up->buf, up->buf + off, up->len);
+}
+
+/**
+ * client_line - Handle a line from a client
+ * @client: client
+ * @line: the line, without the newline
+ *
+ */
+void client_line(struct client *client, char *line)
+{
+	char *save;
+	char *server, *timeout, *msgs;
+	struct call *call;
+	struct upstream *up;
+
+	call = calloc(1, sizeof(*call));
+	if (call == NULL)
+		fatal("calloc");
+	call->client = client;
+	client->call = call;
+
+	server = strtok_r(line, " ", &save);
+	timeout = strtok_r(NULL, " ", &save);
+	msgs = strtok_r(NULL, "", &save);
+	if (msgs == NULL) {
+		call_done(call, 0);
+		return;
+	}
+	if (atoi(timeout) > 0)
+		call->deadline = time_ms() + atoi(timeout) * 1000LL;
+
+	up = up_get(server);
+	if (up == NULL || up_send(up, call, msgs) < 0)
+		call_done(call, 0);
+}
+
+/**
+ * client_close - Drop a client
+ * @client: client
+ *
+ */
+void client_close(struct client *client)
+{
+	if (client->call != NULL) {
+		client->call->client = NULL;
+		call_done(client->call, 0);
+	}
+	close(client->sock);
+	client->sock = -1;
+	free(client->buf);
+	client->buf = NULL;
+	client->len = 0;
+}
+
+/**
+ * client_run - Handle the complete lines from a client
+ * @client: client
+ *
+ * Description:
+ * The calls of a client are handled one at a time, in order.
+ *
+ */
+void client_run(struct client *client)
+{
+	char *line, *end;
+	size_t off = 0;
+
+	while (client->call == NULL) {
+		line = client->buf + off;
+		end = memchr(line, '\n', client->len - off);
+		if (end == NULL)
+			break;
+		*end = '\0';
+		off = end - client->buf + 1;
+		client_line(client, line);
+	}
+	client->len -= off;
+	memmove(client->buf, client->buf + off, client->len);
+}
+
+/**
+ * client_read - Read lines from a client
+ * @client: client
+ *
+ */
+void client_read(struct client *client)
+{
+	ssize_t rc;
+
+	if (client->len == LINE_LEN_MAX) {
+		/* not a line */
+		client_close(client);
+		return;
+	}
+	rc = recv(client->sock, client->buf + client->len,
+		  LINE_LEN_MAX - client->len, 0);
+	if (rc < 0 && errno == EINTR)
+		return;
+	if (rc <= 0) {
+		client_close(client);
+		return;
+	}
+	client->len += rc;
+}
+
+/**
+ * client_accept - Accept a new client
+ * @sock: listening socket
+ *
+ */
+void client_accept(int sock)
+{
+	int iter;
+	int client_sock;
+
+	client_sock = accept(sock, NULL, NULL);
+	if (client_sock < 0)
+		return;
+	for (iter = 0; iter < CLIENT_MAX; iter++)
+		if (clients[iter].sock < 0)
+			break;
+	if (iter == CLIENT_MAX ||
+	    (clients[iter].buf = malloc(LINE_LEN_MAX)) == NULL) {
+		close(client_sock);
+		return;
+	}
+	clients[iter].sock = client_sock;
+	clients[iter].len = 0;
+	clients[iter].call = NULL;
+}
+
+/**
+ * usage - Print a usage message and exit
+ *
+ */
+void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-d] [-w <pid>]\n"
+		"\n"
+		"  -d  run in the background\n"
+		"  -w  exit once the process <pid> is gone\n",
+		name);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	int daemon_flag = 0;
+	pid_t watch_pid = 0;
+	pid_t pid;
+	int sock, null_fd;
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	struct pollfd pfds[1 + CLIENT_MAX + 64];
+	void *srcs[1 + CLIENT_MAX + 64];
+	struct upstream *up;
+	int nfds, up_first, iter, timeout;
+	long long now;
+
+	while ((opt = getopt(argc, argv, "dw:h")) != -1) {
+		switch (opt) {
+		case 'd': daemon_flag = 1; break;
+		case 'w': watch_pid = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/* a client going away must not take the others with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	for (iter = 0; iter < CLIENT_MAX; iter++)
+		clients[iter].sock = -1;
+
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock < 0)
+		fatal("socket");
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(sock, CLIENT_MAX) < 0 ||
+	    getsockname(sock, (struct sockaddr *)&addr, &addr_len) < 0)
+		fatal("listen");
+
+	if (daemon_flag) {
+		pid = fork();
+		if (pid < 0)
+			fatal("fork");
+		if (pid > 0) {
+			printf("%d %d\n", ntohs(addr.sin_port), pid);
+			return 0;
+		}
+		setsid();
+		null_fd = open("/dev/null", O_RDWR);
+		if (null_fd >= 0) {
+			dup2(null_fd, 0);
+			dup2(null_fd, 1);
+			dup2(null_fd, 2);
+			if (null_fd > 2)
+				close(null_fd);
+		}
+	} else {
+		printf("%d %d\n", ntohs(addr.sin_port), getpid());
+		fflush(stdout);
+	}
+
+	for (;;) {
+		nfds = 0;
+		pfds[nfds].fd = sock;
+		pfds[nfds].events = POLLIN;
+		srcs[nfds++] = NULL;
+		for (iter = 0; iter < CLIENT_MAX; iter++) {
+			if (clients[iter].sock < 0)
+				continue;
+			pfds[nfds].fd = clients[iter].sock;
+			pfds[nfds].events = POLLIN;
+			srcs[nfds++] = &clients[iter];
+		}
+		up_first = nfds;
+		for (up = up_list; up != NULL; up = up->next) {
+			if (up->sock < 0 || nfds == sizeof(pfds) / sizeof(pfds[0]))
+				continue;
+			pfds[nfds].fd = up->sock;
+			pfds[nfds].events = (up->connecting ? POLLOUT : POLLIN);
+			if (up->out_len > 0)
+				pfds[nfds].events |= POLLOUT;
+			srcs[nfds++] = up;
+		}
+
+		/* wake up for the nearest call or connect deadline */
+		timeout = (watch_pid > 0 ? WATCH_MSECS : -1);
+		now = time_ms();
+		for (up = up_list; up != NULL; up = up->next) {
+			if (!up->connecting)
+				continue;
+			if (up->deadline - now < timeout || timeout < 0)
+				timeout = (up->deadline > now ?
+					   up->deadline - now : 0);
+		}
+		for (iter = 0; iter < CLIENT_MAX; iter++) {
+			if (clients[iter].sock < 0 ||
+			    clients[iter].call == NULL ||
+			    clients[iter].call->deadline == 0)
+				continue;
+			if (clients[iter].call->deadline - now < timeout ||
+			    timeout < 0)
+				timeout = (clients[iter].call->deadline > now ?
+					   clients[iter].call->deadline - now : 0);
+		}
+
+		if (poll(pfds, nfds, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			fatal("poll");
+		}
+
+		for (iter = 0; iter < nfds; iter++) {
+			if (pfds[iter].revents == 0)
+				continue;
+			if (iter == 0)
+				client_accept(sock);
+			else if (iter < up_first)
+				client_read(srcs[iter]);
+			else {
+				up = srcs[iter];
+				/* unless closed by an earlier event */
+				if (up->sock != pfds[iter].fd)
+					continue;
+				if (up->connecting) {
+					up_connected(up, 0);
+					continue;
+				}
+				if (pfds[iter].revents & POLLOUT)
+					up_flush(up);
+				if (up->sock >= 0 &&
+				    pfds[iter].revents & (POLLIN | POLLERR | POLLHUP))
+					up_read(up);
+			}
+		}
+
+		now = time_ms();
+		for (up = up_list; up != NULL; up = up->next)
+			if (up->connecting && up->deadline <= now)
+				up_connected(up, 1);
+		for (iter = 0; iter < CLIENT_MAX; iter++) {
+			if (clients[iter].sock < 0)
+				continue;
+			if (clients[iter].call != NULL &&
+			    clients[iter].call->deadline != 0 &&
+			    clients[iter].call->deadline <= now)
+				call_done(clients[iter].call, 0);
+			client_run(&clients[iter]);
+		}
+
+		if (watch_pid > 0 && kill(watch_pid, 0) < 0 && errno == ESRCH)
+			break;
+	}
+
+	return 0;
+}
+
+/* vim: set ts=8 sts=8 sw=8 noet: */
@@ -14,6 +14,8 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
@@ -21,8 +23,19 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <time.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/file.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
 #include <selinux/selinux.h>
 #include <selinux/context.h>
 
@@ -45,6 +58,33 @@
  * send a command (using netcat, scripted)
  *  # echo "exit;" | nc -q 1 localhost <port>
  *
+ * when not started from [x]inetd the server handles any number of control
+ * connections at once, each connection runs its commands in order but a
+ * "sleep", "recv" or "sendrand" command only suspends its own connection
+ *
+ * the replies of the plain text protocol above are not delimited, a client
+ * that needs to match replies to commands uses the framed protocol instead,
+ * picked by the first byte of the connection being a NUL.  every request is
+ *
+ *  <length:32> <id:32> <channel:32> <message>;[<message>;...]
+ *
+ * with the length of the messages (at most CTL_FRAME_LEN_MAX bytes, so that
+ * the first byte is always a NUL), an id and a channel chosen by the client,
+ * all in network byte order.  requests are handled in order and may be
+ * pipelined, once all the messages of a request are done the server sends
+ *
+ *  <length:32> <id:32> <channel:32> <reply_length:32> <reply> [...]
+ *
+ * with one reply record per message, empty for messages without a reply,
+ * and the id and channel of the request
+ *
+ * channel 0 is the connection itself, any other channel number opens a
+ * logical connection of its own within the same control connection.  each
+ * channel has its own "sockcon" setting and runs its requests independent
+ * of the others the same way separate connections do, "detach" closes just
+ * the channel (after sending the response so far) and "cancel" aborts all
+ * the other channels of the connection, see ctl_cancel()
+ *
  */
 
 /* XXX - ToDo List
@@ -57,16 +97,57 @@
 /* constants */
 #define NET_TIMEOUT_DEFAULT             0       /* seconds */
 
-/* lock file */
+/* lock file, used instead of the lock manager when run by [x]inetd */
 #define LCK_FILE                        "/var/lock/lblnet_tst_server"
 
+/* lock manager constants, see ctl_lock() */
+#define LOCK_RESOURCE_DEFAULT           "server"
+#define LOCK_NAME_MAX                   64
+
 #define REMOTE_CALL_PATH                "/usr/local/eal4_testing/audit-test/utils/network-server/remote-call/"
 
 /* control socket constants */
 #define CTL_SOCK_PORT_DEFAULT           4000
-#define CTL_SOCK_LISTEN_QUEUE           1
+#define CTL_SOCK_LISTEN_QUEUE           64
 #define CTL_SOCK_BUF_SIZE               4096    /* bytes */
 
+/* control protocols, see the notes at the top */
+#define CTL_PROTO_NONE                  0       /* nothing received yet */
+#define CTL_PROTO_TEXT                  1
+#define CTL_PROTO_FRAMED                2
+#define CTL_FRAME_HDR_SIZE              12      /* length, id, channel */
+#define CTL_FRAME_LEN_MAX               0x00ffffff
+
+/* event loop constants */
+#define EVT_MAX                         32      /* events per epoll_wait() */
+
+/* data socket constants */
+#define DATA_BUF_SIZE                   262144  /* bytes */
+#define DATA_PATTERN_LEN                26      /* 'a' to 'z' */
+#define DATA_MSG_MAX                    65507   /* max UDP payload */
+#define DATA_VLEN                       64      /* datagrams per syscall */
+
+/* zero-copy sends, missing in older headers */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY                     60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY                    0x4000000
+#endif
+
+/* process file descriptors, missing in older headers */
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open                  434
+#endif
+
+/* data socket flags */
+#define DATA_F_STATS                    0x01    /* report bandwidth */
+#define DATA_F_ZEROCOPY                 0x02    /* MSG_ZEROCOPY sends */
+
+/* readiness notification constants, see ctl_wait_listen() */
+#define READY_SOCK_PREFIX               "lblnet_tst_server:listen:"
+#define READY_TIMEOUT_DEFAULT           10      /* seconds */
+
 /* control message constats */
 #define CTL_MSG_BAD_CHARS               "\n\r"
 
@@ -94,6 +175,113 @@ unsigned int net_timeout_sec = NET_TIMEOUT_DEFAULT;
 /* visible status message watermark */
 unsigned int smsg_level = SMSG_ERR;
 
+/* [x]inetd mode, single control connection on stdin */
+int inetd_flag = 0;
+
+/* pid file, NULL if none */
+char *pid_file = NULL;
+
+/* epoll instance for the control and data sockets */
+int epoll_fd = -1;
+
+/* main loop switch, cleared by the "exit" control message */
+int run_loop = 1;
+
+/* event source types */
+#define EVT_LISTEN                      0
+#define EVT_CTL                         1
+#define EVT_DATA                        2
+
+/* event source, the epoll data of each registered socket */
+struct evt_src {
+	int type;
+	struct ctl_conn *conn;
+};
+
+/* control connection states */
+#define CONN_IDLE                       0       /* run the next command */
+#define CONN_SLEEP                      1       /* "sleep" in progress */
+#define CONN_DATA                       2       /* data socket in progress */
+#define CONN_LOCK                       3       /* waiting for a lock */
+
+/* data socket operations */
+#define DATA_RECV_ACCEPT                1       /* "recv", waiting for peer */
+#define DATA_RECV                       2       /* "recv", reading data */
+#define DATA_SEND_CONNECT               3       /* "sendrand", connecting */
+#define DATA_SEND                       4       /* "sendrand", writing */
+#define DATA_WAIT_LISTEN                5       /* "wait_listen" */
+#define DATA_CHILD                      6       /* "remote_call" */
+
+/* control connection */
+struct ctl_conn {
+	int sock;                       /* -1 once detached */
+	int eof;                        /* peer is done sending commands */
+	uint32_t chan;                  /* framed protocol channel */
+	struct ctl_conn *parent;        /* connection of a channel */
+	struct sockaddr_storage peer_addr;
+	struct evt_src ctl_evt;
+
+	int proto;
+	char *msg_buf;                  /* pending control messages */
+	size_t msg_len;
+	size_t msg_size;                /* allocated */
+	size_t msg_off;                 /* start of the next message */
+
+	/* request in progress and its response, framed protocol only */
+	size_t frame_end;               /* 0 if none */
+	uint32_t frame_id;
+	char *resp_buf;
+	size_t resp_len;
+	size_t resp_size;
+	size_t resp_rec;                /* reply record of the current message */
+
+	int state;
+	long long deadline;             /* msecs, 0 for none */
+
+	/* data socket of the "recv" / "sendrand" in progress */
+	int data_sock;
+	int data_op;
+	int data_type;                  /* SOCK_STREAM or SOCK_DGRAM */
+	int data_flags;
+	size_t data_bytes;
+	size_t data_done;
+	size_t data_msg_size;           /* "sendrand" datagram size */
+	long long data_time;            /* usecs, first byte transferred */
+	long long data_last;            /* usecs, last byte transferred */
+	pid_t data_pid;                 /* "remote_call" program */
+	struct evt_src data_evt;
+
+	/* socket context set by "sockcon", NULL for the default */
+	char *sockcon;
+
+	/* "lock:acquire" waiting for the lock */
+	struct lock_res *lock_res;
+	unsigned int lock_lease;        /* seconds */
+	long long lock_deadline;        /* msecs, end of the wait */
+	struct ctl_conn *lock_next;     /* next waiter for the same lock */
+
+	struct ctl_conn *next;
+};
+
+/* all control connections */
+struct ctl_conn *conn_list = NULL;
+
+/* lock, one per resource name */
+struct lock_res {
+	char name[LOCK_NAME_MAX];
+	unsigned int token;             /* 0 if free */
+	long long expires;              /* msecs, end of the lease */
+	struct ctl_conn *wait_head;     /* waiters, in FIFO order */
+	struct ctl_conn *wait_tail;
+	struct lock_res *next;
+};
+
+/* all the locks ever used */
+struct lock_res *lock_list = NULL;
+
+/* token of the next lock granted, never 0 */
+unsigned int lock_token_next = 1;
+
 /**
  * hlp_usage - Print a usage message and exit
  * @name - program name
@@ -131,32 +319,93 @@ int write_pid(char *filename)
 }
 
 /**
- * net_hlp_timeout_rcv - Wait for data on a socket
- * @sock: socket
+ * drop_pid - Remove the pid file if it names the current process
+ * @filename - pidfile name / path
  *
  * Description:
- * Uses select() to wait for data on a socket.  Returns the return value from
- * select(), 1 if the value in net_timeout_sec is 0 (no timeout) or -1 on error.
+ * In [x]inetd mode the pid file names the instance pidfile_kill stops after
+ * each test.  A multiplexed connection (see conn_chan()) lasts for the whole
+ * test run and its per-test state goes with "cancel", so its instance takes
+ * itself out of the pid file.
  *
  */
-int net_hlp_timeout_rcv(int sock)
+void drop_pid(char *filename)
 {
-	struct timeval timeout;
-	fd_set sock_fdset;
+	FILE *pfile;
+	int pid = 0;
 
-	if (sock < 0)
-		return -1;
+	pfile = fopen(filename, "r");
+	if (pfile == NULL)
+		return;
+	if (fscanf(pfile, "%d", &pid) != 1)
+		pid = 0;
+	fclose(pfile);
 
-	if (net_timeout_sec == 0)
-		return 1;
+	if (pid == getpid())
+		unlink(filename);
+}
+
+/**
+ * time_ms - Get the current time
+ *
+ * Description:
+ * Return the current value of the monotonic clock in milliseconds, used for
+ * the connection deadlines.
+ *
+ */
+long long time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * time_us - Get the current time in microseconds
+ *
+ * Description:
+ * Same as time_ms(), with the precision needed for the bandwidth reports.
+ *
+ */
+long long time_us(void)
+{
+	struct timespec ts;
 
-	timeout.tv_sec = net_timeout_sec;
-	timeout.tv_usec = 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * evt_add - Add a socket to the event loop
+ * @sock: socket
+ * @events: epoll events to wait for
+ * @src: event source
+ *
+ * Description:
+ * Register @sock with the epoll instance, returns zero on success, negative
+ * values on failure.
+ *
+ */
+int evt_add(int sock, unsigned int events, struct evt_src *src)
+{
+	struct epoll_event evt;
 
-	FD_ZERO(&sock_fdset);
-	FD_SET(sock, &sock_fdset);
+	memset(&evt, 0, sizeof(evt));
+	evt.events = events;
+	evt.data.ptr = src;
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &evt);
+}
 
-	return select(sock + 1, &sock_fdset, NULL, NULL, &timeout);
+/**
+ * evt_del - Remove a socket from the event loop
+ * @sock: socket
+ *
+ */
+void evt_del(int sock)
+{
+	if (sock >= 0)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, NULL);
 }
 
 /**
@@ -178,54 +427,329 @@ void net_hlp_socket_close(int *sock)
 }
 
 /**
- * ctl_hlp_sendrc - Write a return value to a socket
+ * ctl_hlp_write - Write a buffer to a socket
  * @sock: socket
- * @rc: return value
+ * @buf: data
+ * @len: length of @buf
  *
  * Description:
- * Write the value in @rc as an ASCII string to @sock.
+ * Write all of @buf to @sock, returns zero on success, negative values on
+ * failure.
  *
  */
-void ctl_hlp_sendrc(int sock, int rc)
+int ctl_hlp_write(int sock, const char *buf, size_t len)
 {
-	int tmpfd;
-	FILE *fp;
+	ssize_t rc;
 
-	if (sock < 0)
-		return;
+	while (len > 0) {
+		rc = write(sock, buf, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			SMSG(SMSG_WARN,
+			     fprintf(log_fd,
+				     "warning: failed to write the "
+				     "control reply (%d)\n", errno));
+			return -1;
+		}
+		buf += rc;
+		len -= rc;
+	}
 
-	tmpfd = dup(sock);
-	fp = fdopen(tmpfd, "a");
-	fprintf(fp, "%d", rc);
-	fclose(fp);
+	return 0;
 }
 
 /**
- * ctl_hlp_sendstr - Write a string to a socket
- * @sock: socket
- * @str: string to write to the socket
+ * ctl_hlp_close - Close the control socket of a connection
+ * @conn: control connection
+ *
+ * Description:
+ * Remove the control socket from the event loop and close it.  The socket of
+ * a channel is a duplicate of the one of its connection, it is only closed as
+ * shutting it down would end the whole connection.
+ *
+ */
+void ctl_hlp_close(struct ctl_conn *conn)
+{
+	if (conn->chan == 0) {
+		evt_del(conn->sock);
+		net_hlp_socket_close(&conn->sock);
+	} else if (conn->sock >= 0) {
+		close(conn->sock);
+		conn->sock = -1;
+	}
+}
+
+/**
+ * ctl_hlp_resp_add - Add data to the response of the current request
+ * @conn: control connection
+ * @buf: data
+ * @len: length of @buf
+ *
+ * Description:
+ * Append @buf to the response frame being built for the current request,
+ * returns zero on success, negative values on failure.
+ *
+ */
+int ctl_hlp_resp_add(struct ctl_conn *conn, const void *buf, size_t len)
+{
+	char *resp_buf;
+	size_t resp_size;
+
+	if (conn->resp_len + len > conn->resp_size) {
+		resp_size = conn->resp_size * 2;
+		if (resp_size < conn->resp_len + len)
+			resp_size = conn->resp_len + len;
+		if (resp_size < CTL_SOCK_BUF_SIZE)
+			resp_size = CTL_SOCK_BUF_SIZE;
+		resp_buf = realloc(conn->resp_buf, resp_size);
+		if (resp_buf == NULL) {
+			SMSG(SMSG_ERR, fprintf(log_fd, "error: out of memory\n"));
+			return -1;
+		}
+		conn->resp_buf = resp_buf;
+		conn->resp_size = resp_size;
+	}
+	memcpy(conn->resp_buf + conn->resp_len, buf, len);
+	conn->resp_len += len;
+
+	return 0;
+}
+
+/**
+ * ctl_hlp_send - Write a reply to a control connection
+ * @conn: control connection
+ * @buf: reply
+ * @len: length of @buf
  *
  * Description:
- * Write the value in @str as an ASCII string to @sock.
+ * Write the reply to a control message.  Text clients get it right away,
+ * framed clients get it as part of the reply record of the current message,
+ * see conn_run().  The reply is discarded once the connection is detached.
  *
  */
-void ctl_hlp_sendstr(int sock, const char *str)
+void ctl_hlp_send(struct ctl_conn *conn, const char *buf, size_t len)
 {
-	int tmpfd;
-	FILE *fp;
+	uint32_t rec_len;
+
+	if (conn->sock < 0)
+		return;
 
-	if (sock < 0)
+	if (conn->proto != CTL_PROTO_FRAMED) {
+		ctl_hlp_write(conn->sock, buf, len);
 		return;
+	}
+
+	if (ctl_hlp_resp_add(conn, buf, len) < 0) {
+		/* the response would be wrong, better no response at all */
+		ctl_hlp_close(conn);
+		return;
+	}
+	memcpy(&rec_len, conn->resp_buf + conn->resp_rec, sizeof(rec_len));
+	rec_len = htonl(ntohl(rec_len) + len);
+	memcpy(conn->resp_buf + conn->resp_rec, &rec_len, sizeof(rec_len));
+}
+
+/**
+ * ctl_hlp_sendrc - Write a return value to a control connection
+ * @conn: control connection
+ * @rc: return value
+ *
+ * Description:
+ * Write the value in @rc as an ASCII string to @conn.
+ *
+ */
+void ctl_hlp_sendrc(struct ctl_conn *conn, int rc)
+{
+	char buf[16];
+
+	ctl_hlp_send(conn, buf, snprintf(buf, sizeof(buf), "%d", rc));
+}
+
+/**
+ * ctl_hlp_sendstr - Write a string to a control connection
+ * @conn: control connection
+ * @str: string to write to the connection
+ *
+ * Description:
+ * Write the value in @str as an ASCII string to @conn.
+ *
+ */
+void ctl_hlp_sendstr(struct ctl_conn *conn, const char *str)
+{
+	ctl_hlp_send(conn, str, strlen(str));
+}
+
+/**
+ * data_socket - Create a data socket for a control connection
+ * @conn: control connection
+ * @family: address family
+ * @type: socket type
+ * @proto: protocol
+ *
+ * Description:
+ * Create a non-blocking socket using the socket context requested by @conn,
+ * if any.  The socket creation context is per process so it is only set for
+ * the duration of this call, connections do not see each other's contexts.
+ * Returns the socket or -1 on error.
+ *
+ */
+int data_socket(struct ctl_conn *conn, int family, int type, int proto)
+{
+	int sock;
+	int err;
+
+	if (conn->sockcon != NULL && setsockcreatecon(conn->sockcon) < 0)
+		return -1;
+	sock = socket(family, type | SOCK_NONBLOCK, proto);
+	err = errno;
+	if (conn->sockcon != NULL)
+		setsockcreatecon(NULL);
+	errno = err;
+
+	return sock;
+}
+
+/**
+ * data_buf - Get the data buffer
+ *
+ * Description:
+ * Return the page aligned buffer used for all the data sockets, allocated on
+ * the first call.  The buffer is filled with a repeating 'a' to 'z' pattern
+ * and never changes afterwards, so it can be shared by all connections, used
+ * for zero-copy sends and sending from any offset keeps the pattern going.
+ * The buffer is DATA_BUF_SIZE + DATA_PATTERN_LEN bytes long.  Returns NULL on
+ * error.
+ *
+ */
+unsigned char *data_buf(void)
+{
+	static unsigned char *buf = NULL;
+	size_t iter;
+
+	if (buf != NULL)
+		return buf;
+
+	buf = mmap(NULL, DATA_BUF_SIZE + DATA_PATTERN_LEN,
+		   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		buf = NULL;
+		return NULL;
+	}
+	for (iter = 0; iter < DATA_BUF_SIZE + DATA_PATTERN_LEN; iter++)
+		buf[iter] = 'a' + iter % DATA_PATTERN_LEN;
 
-	tmpfd = dup(sock);
-	fp = fdopen(tmpfd, "a");
-	fprintf(fp, "%s", str);
-	fclose(fp);
+	return buf;
+}
+
+/**
+ * data_opts - Parse the data socket options
+ * @conn: control connection
+ * @opts: comma separated options, may be NULL
+ *
+ * Description:
+ * Parse the optional trailing "sendrand" and "recv" parameters into @conn:
+ *
+ *  size=<bytes>  : datagram size for UDP "sendrand", default 1
+ *  zerocopy      : use MSG_ZEROCOPY for TCP "sendrand" if available
+ *  stats         : report the bandwidth along with the return value
+ *
+ * Returns zero on success, EINVAL on unknown or invalid options.
+ *
+ */
+int data_opts(struct ctl_conn *conn, char *opts)
+{
+	char *opt;
+
+	conn->data_flags = 0;
+	conn->data_msg_size = 1;
+
+	for (opt = strtok(opts, ","); opt != NULL; opt = strtok(NULL, ",")) {
+		if (strncasecmp(opt, "size=", 5) == 0) {
+			conn->data_msg_size = atoi(opt + 5);
+			if (conn->data_msg_size < 1 ||
+			    conn->data_msg_size > DATA_MSG_MAX)
+				return EINVAL;
+		} else if (strcasecmp(opt, "zerocopy") == 0)
+			conn->data_flags |= DATA_F_ZEROCOPY;
+		else if (strcasecmp(opt, "stats") == 0)
+			conn->data_flags |= DATA_F_STATS;
+		else
+			return EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * data_start - Start waiting on a data socket
+ * @conn: control connection
+ * @sock: data socket
+ * @op: data socket operation
+ * @events: epoll events to wait for
+ *
+ * Description:
+ * Suspend @conn until the data socket operation finishes, see data_done().
+ * Returns zero on success, errno values on failure.
+ *
+ */
+int data_start(struct ctl_conn *conn, int sock, int op, unsigned int events)
+{
+	if (evt_add(sock, events, &conn->data_evt) < 0)
+		return errno;
+
+	conn->data_sock = sock;
+	conn->data_op = op;
+	conn->data_done = 0;
+	conn->data_time = 0;
+	conn->data_last = 0;
+	conn->state = CONN_DATA;
+	conn->deadline = (net_timeout_sec != 0 ?
+			  time_ms() + net_timeout_sec * 1000LL : 0);
+
+	return 0;
+}
+
+/**
+ * data_done - Finish a data socket operation
+ * @conn: control connection
+ * @rc: return value
+ *
+ * Description:
+ * Close the data socket, report @rc to the remote host and resume processing
+ * of the control messages on @conn.  With the "stats" option the return value
+ * is followed by the transfer statistics, ie.
+ *
+ *  0 bytes=1048576 usecs=8731 mbps=960.74
+ *
+ * where the time is measured from the first to the last byte transferred.
+ *
+ */
+void data_done(struct ctl_conn *conn, int rc)
+{
+	char stats[128];
+	long long usecs;
+
+	evt_del(conn->data_sock);
+	net_hlp_socket_close(&conn->data_sock);
+	if (conn->data_flags & DATA_F_STATS) {
+		usecs = conn->data_last - conn->data_time;
+		snprintf(stats, sizeof(stats),
+			 "%d bytes=%zu usecs=%lld mbps=%.2f", rc,
+			 conn->data_done, usecs,
+			 (usecs > 0 ? conn->data_done * 8.0 / usecs : 0));
+		ctl_hlp_sendstr(conn, stats);
+	} else
+		ctl_hlp_sendrc(conn, rc);
+	conn->data_flags = 0;
+	conn->data_op = 0;
+	conn->state = CONN_IDLE;
+	conn->deadline = 0;
 }
 
 /**
  * ctl_echo - Handle the "echo" control message
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
@@ -237,9 +761,9 @@ void ctl_hlp_sendstr(int sock, const char *str)
  * This is intended as a debugging control message only.
  *
  */
-void ctl_echo(int sock, char *param)
+void ctl_echo(struct ctl_conn *conn, char *param)
 {
-	ctl_hlp_sendstr(sock, param);
+	ctl_hlp_sendstr(conn, (param != NULL ? param : ""));
 }
 
 /**
@@ -291,6 +815,7 @@ void ctl_ipsec(int sock, char *param)
 	       "xfrm", "state", "flush", (char *) NULL);
     if (rc == -1)
       SMSG(SMSG_ERR, fprintf(log_fd, "error(ipsec): execl failed (%d)\n", errno));
+    _exit(1);
 
   } else if (pID < 0) {
     SMSG(SMSG_ERR, fprintf(log_fd, "error(ipsec): fork failed\n"));
@@ -301,7 +826,7 @@ void ctl_ipsec(int sock, char *param)
 
 /**
  * ctl_remote_call - Handle the "remote_call" control message
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
@@ -310,8 +835,12 @@ void ctl_ipsec(int sock, char *param)
  *
  *  remote_call:<executable,parameter1,...,parameterN>
  *
+ * Plain text clients get no reply and cannot tell when the executable is
+ * done, framed clients wait for it and get its exit status as the reply, see
+ * data_child().
+ *
  */
-void ctl_remote_call(int sock, char *param)
+void ctl_remote_call(struct ctl_conn *conn, char *param)
 {
   char *argv[64], *executable, executable_full_path[256] = "";
   int rc;
@@ -346,191 +875,493 @@ void ctl_remote_call(int sock, char *param)
 
   pid_t pID = fork();
   if (pID == 0) {
+    /* in [x]inetd mode stdin/stdout are the control connection, keep the
+     * output off the framed protocol stream */
+    if (conn->proto == CTL_PROTO_FRAMED) {
+      int null_fd = open("/dev/null", O_RDWR);
+      dup2(null_fd, 0);
+      dup2((log_fd != stderr ? fileno(log_fd) : null_fd), 1);
+      dup2((log_fd != stderr ? fileno(log_fd) : null_fd), 2);
+    }
     rc = execv(executable_full_path, argv);
     if (rc == -1)
       SMSG(SMSG_ERR, fprintf(log_fd, "error(remote_call): execl failed (%d)\n", errno));
+    _exit(1);
 
   } else if (pID < 0) {
     SMSG(SMSG_ERR, fprintf(log_fd, "error(remote_call): fork failed\n"));
     return;
   } else
     SMSG(SMSG_NOTICE, fprintf(log_fd, "parent process continues\n"));
+
+  if (conn->proto == CTL_PROTO_FRAMED) {
+    int pid_fd = syscall(SYS_pidfd_open, pID, 0);
+    if (pid_fd < 0 || data_start(conn, pid_fd, DATA_CHILD, EPOLLIN) != 0) {
+      SMSG(SMSG_WARN,
+	   fprintf(log_fd, "warning(remote_call): cannot wait for %d\n", pID));
+      if (pid_fd >= 0)
+        close(pid_fd);
+      return;
+    }
+    conn->data_pid = pID;
+    /* as long as it takes */
+    conn->deadline = 0;
+  }
+}
+
+/**
+ * data_child - Finish a "remote_call" once the executable exits
+ * @conn: control connection
+ *
+ * Description:
+ * Reply with the exit status of the executable, 128 + the signal number if
+ * it was killed.
+ *
+ */
+void data_child(struct ctl_conn *conn)
+{
+	int status;
+
+	if (waitpid(conn->data_pid, &status, WNOHANG) <= 0)
+		return;
+
+	data_done(conn, (WIFEXITED(status) ?
+			 WEXITSTATUS(status) : 128 + WTERMSIG(status)));
 }
 
 /**
  * ctl_sleep - Handle the "sleep" control message
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
- * Sleep for the specified number of seconds.  The control message format:
+ * Suspend the connection for the specified number of seconds, other
+ * connections are still served meanwhile.  The control message format:
  *
  *  sleep:<seconds>
  *
  */
-void ctl_sleep(int sock, char *param)
+void ctl_sleep(struct ctl_conn *conn, char *param)
 {
-	int rc = sleep(atoi(param));
-	if (rc > 0)
-		SMSG(SMSG_WARN,
-		     fprintf(log_fd,
-			     "warning(sleep): "
-			     "failed to sleep for the full time\n"));
+	int secs;
+
+	if (param == NULL || (secs = atoi(param)) <= 0)
+		return;
+
+	conn->state = CONN_SLEEP;
+	conn->deadline = time_ms() + secs * 1000LL;
 }
 
 /**
- * ctl_lock - Handle the "lock" control message
- * @sock: socket
- * @param: parameter string
+ * lock_find - Find a lock by its resource name
+ * @name: resource name
  *
  * Description:
- * Set, release, or query the lock, return the number of seconds until the lock
- * expires (a value of "0" means you have the lock) or nothing on error.  The
- * control message format:
- *
- *  lock:set,<timeout>
- *  lock:release
- *  lock:query
+ * Return the lock of the resource @name, a new free lock if it was never
+ * used before, or NULL on error.
  *
  */
-void ctl_lock(int sock, char *param)
+struct lock_res *lock_find(const char *name)
 {
-	int rc;
-	char *cmd_str, *timeout_str;
-	unsigned int timeout = 0;
-	time_t time_now, time_lock = 0;
-	FILE *lock_file;
+	struct lock_res *res;
 
-	if (param == NULL) {
-		SMSG(SMSG_ERR, fprintf(log_fd, "error(lock): bad message\n"));
-		return;
-	}
+	if (name == NULL || name[0] == '\0' || strlen(name) >= LOCK_NAME_MAX)
+		return NULL;
 
-	/* XXX - at some point we should probably do flock locking, or
-	 *       something similar, on the lock file but i'm lazy and this
-	 *       should work fairly well for right now ... */
+	for (res = lock_list; res != NULL; res = res->next)
+		if (strcmp(res->name, name) == 0)
+			return res;
 
-	/* parse the control message */
-	cmd_str = strtok(param, ",");
-	if (strcasecmp(cmd_str, "set") == 0) {
-		timeout_str = strtok(NULL, ",");
-		timeout = atoi(timeout_str);
-	}
+	res = calloc(1, sizeof(*res));
+	if (res == NULL)
+		return NULL;
+	strcpy(res->name, name);
+	res->next = lock_list;
+	lock_list = res;
 
-	/* perform the command */
-	time_now = time(NULL);
-	if (strcasecmp(cmd_str, "set") == 0) {
-		/* try to read the lock */
-		lock_file = fopen(LCK_FILE, "r+");
-		if (lock_file == NULL) {
-			lock_file = fopen(LCK_FILE, "w");
-			if (lock_file == NULL) {
-				SMSG(SMSG_ERR,
-				      fprintf(log_fd,
-					      "error(lock): "
-					      "unable to access the "
-					      "lock file\n"));
-				      return;
-			}
-			time_lock = time_now;
-		} else {
-			rc = fscanf(lock_file, "%ld", &time_lock);
-			if (rc != 1 && rc != EOF) {
-				SMSG(SMSG_ERR,
-				      fprintf(log_fd,
-					      "error(lock): "
-					      "unable to read the "
-					      "lock file\n"));
-				      return;
-			}
-		}
-		if (time_lock <= time_now) {
-			/* we have the lock */
-			rewind(lock_file);
-			fprintf(lock_file, "%ld", time_now + timeout);
-			ctl_hlp_sendrc(sock, 0);
-		} else {
-			/* someone else has the lock */
-			ctl_hlp_sendrc(sock, time_lock - time_now);
-		}
-		fclose(lock_file);
-	} else if  (strcasecmp(cmd_str, "release") == 0) {
-		/* release the "lock" */
-		lock_file = fopen(LCK_FILE, "w");
-		if (lock_file == NULL) {
-			SMSG(SMSG_ERR,
-			      fprintf(log_fd,
-				      "error(lock): "
-				      "unable to access the lock file\n"));
-			      return;
-		}
-		fprintf(lock_file, "%ld", time_now);
-		fclose(lock_file);
-	} else if  (strcasecmp(cmd_str, "query") == 0) {
-		/* check the "lock" */
-		lock_file = fopen(LCK_FILE, "r");
-		if (lock_file == NULL) {
-			SMSG(SMSG_ERR,
-			      fprintf(log_fd,
-				      "error(lock): "
-				      "unable to access the lock file\n"));
-			      return;
-		}
-		rc = fscanf(lock_file, "%ld", &time_lock);
-		if (rc != 1 && rc != EOF) {
-			SMSG(SMSG_ERR,
-			      fprintf(log_fd,
-				      "error(lock): "
-				      "unable to read the lock file\n"));
-			      return;
-		}
-		if (time_lock <= time_now)
-			ctl_hlp_sendrc(sock, 0);
-		else
-			ctl_hlp_sendrc(sock, time_lock - time_now);
-		fclose(lock_file);
-	} else
-		return;
+	return res;
 }
 
 /**
- * ctl_sendrand - Handle the "sendrand" control message
- * @sock: socket
- * @param: parameter string
+ * lock_take - Give a free lock to a new holder
+ * @res: lock
+ * @lease: lease in seconds
  *
  * Description:
- * Send a message to a remote host and return an error code on @sock as a
- * positive ASCII integer.  The control message format:
- *
- *  sendrand:<host>,tcp|udp,<port>,<bytes>
+ * Returns the token identifying the new holder.
  *
  */
-void ctl_sendrand(int sock, struct sockaddr_storage *peer_addr, char *param)
+unsigned int lock_take(struct lock_res *res, unsigned int lease)
 {
-	int rc;
-	char *host_str, *proto_str, *port_str, *bytes_str;
-	struct addrinfo *host = NULL;
-	struct addrinfo addr_hints;
-	struct timeval timeout;
-	unsigned int bytes;
-	int data_sock = -1;
+	res->token = lock_token_next++;
+	if (lock_token_next == 0)
+		lock_token_next = 1;
+	res->expires = time_ms() + lease * 1000LL;
 
-	unsigned int iter;
-	unsigned char byte;
+	return res->token;
+}
 
-	if (param == NULL) {
-		SMSG(SMSG_ERR,
-		     fprintf(log_fd, "error(sendrand): bad message\n"));
-		rc = EINVAL;
-		goto sendrand_return;
-	}
+/**
+ * lock_left - Get the remaining lease of a lock
+ * @res: lock
+ *
+ * Description:
+ * Returns the number of seconds until the lease of @res expires, rounded up,
+ * zero if the lock is free.
+ *
+ */
+long long lock_left(struct lock_res *res)
+{
+	long long left;
 
-	/* parse the control message */
-	host_str = strtok(param, ",");
-	proto_str = strtok(NULL, ",");
-	port_str = strtok(NULL, ",");
-	bytes_str = strtok(NULL, "");
-	if (bytes_str == NULL) {
+	if (res->token == 0)
+		return 0;
+	left = res->expires - time_ms();
+	return (left > 0 ? (left + 999) / 1000 : 0);
+}
+
+/**
+ * lock_cancel - Remove a waiter from the lock queue
+ * @conn: control connection waiting for a lock
+ *
+ */
+void lock_cancel(struct ctl_conn *conn)
+{
+	struct lock_res *res = conn->lock_res;
+	struct ctl_conn **iter, *prev = NULL;
+
+	for (iter = &res->wait_head; *iter != NULL; iter = &(*iter)->lock_next) {
+		if (*iter == conn) {
+			*iter = conn->lock_next;
+			if (res->wait_tail == conn)
+				res->wait_tail = prev;
+			break;
+		}
+		prev = *iter;
+	}
+	conn->lock_res = NULL;
+	conn->lock_next = NULL;
+}
+
+/**
+ * lock_update - Expire the lease of a lock and hand it to the next waiter
+ * @res: lock
+ *
+ * Description:
+ * Free @res if its lease has expired and give the free lock to the waiters in
+ * the order they came, their "lock:acquire" returns right away with the new
+ * token.  Waiters that have detached meanwhile are skipped as they could not
+ * release the lock anyway.  The remaining waiters wake up when the lease ends
+ * or their wait does.
+ *
+ */
+void lock_update(struct lock_res *res)
+{
+	char reply[64];
+	struct ctl_conn *conn;
+
+	if (res->token != 0 && res->expires <= time_ms()) {
+		SMSG(SMSG_NOTICE,
+		     fprintf(log_fd,
+			     "notice(lock): lease of %s expired\n",
+			     res->name));
+		res->token = 0;
+	}
+
+	while (res->token == 0 && res->wait_head != NULL) {
+		conn = res->wait_head;
+		lock_cancel(conn);
+		conn->state = CONN_IDLE;
+		conn->deadline = 0;
+		if (conn->sock < 0)
+			continue;
+		snprintf(reply, sizeof(reply), "0 token=%u",
+			 lock_take(res, conn->lock_lease));
+		ctl_hlp_sendstr(conn, reply);
+	}
+
+	for (conn = res->wait_head; conn != NULL; conn = conn->lock_next)
+		conn->deadline = (res->expires < conn->lock_deadline ?
+				  res->expires : conn->lock_deadline);
+}
+
+/**
+ * lock_file - Handle the "lock" control message using the lock file
+ * @conn: control connection
+ * @cmd_str: lock command
+ *
+ * Description:
+ * Each [x]inetd instance is a separate process, so the lock manager is of no
+ * use there and the lock is an expiration time in LCK_FILE instead, with no
+ * queueing.  Only the "set", "release" and "query" commands are supported,
+ * the others return EOPNOTSUPP.
+ *
+ */
+void lock_file(struct ctl_conn *conn, char *cmd_str)
+{
+	int fd;
+	char *timeout_str;
+	unsigned int timeout = 0;
+	time_t time_now, time_lock = 0;
+	FILE *lock_file;
+
+	if (strcasecmp(cmd_str, "set") == 0) {
+		timeout_str = strtok(NULL, ",");
+		if (timeout_str != NULL)
+			timeout = atoi(timeout_str);
+	} else if (strcasecmp(cmd_str, "release") != 0 &&
+		   strcasecmp(cmd_str, "query") != 0) {
+		ctl_hlp_sendrc(conn, EOPNOTSUPP);
+		return;
+	}
+
+	/* the lock file lock keeps concurrent instances out of the
+	 * read-modify-write below */
+	fd = open(LCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0 || flock(fd, LOCK_EX) < 0 ||
+	    (lock_file = fdopen(fd, "r+")) == NULL) {
+		SMSG(SMSG_ERR,
+		      fprintf(log_fd,
+			      "error(lock): unable to access the lock file\n"));
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	if (fscanf(lock_file, "%ld", &time_lock) != 1)
+		time_lock = 0;
+
+	/* perform the command */
+	time_now = time(NULL);
+	if (strcasecmp(cmd_str, "set") == 0) {
+		if (time_lock <= time_now) {
+			/* we have the lock */
+			rewind(lock_file);
+			fprintf(lock_file, "%-20ld\n", time_now + timeout);
+			ctl_hlp_sendrc(conn, 0);
+		} else {
+			/* someone else has the lock */
+			ctl_hlp_sendrc(conn, time_lock - time_now);
+		}
+	} else if (strcasecmp(cmd_str, "release") == 0) {
+		rewind(lock_file);
+		fprintf(lock_file, "%-20ld\n", time_now);
+	} else {
+		if (time_lock <= time_now)
+			ctl_hlp_sendrc(conn, 0);
+		else
+			ctl_hlp_sendrc(conn, time_lock - time_now);
+	}
+	fclose(lock_file);
+}
+
+/**
+ * ctl_lock - Handle the "lock" control message
+ * @conn: control connection
+ * @param: parameter string
+ *
+ * Description:
+ * Lock manager for sharing the server between test hosts.  Every resource
+ * name (ie. the whole server, a port, a traffic class) has its own lock and
+ * the holder gets it for a lease which has to be renewed before it expires.
+ * The control message format:
+ *
+ *  lock:acquire,<resource>,<lease>[,<wait>]
+ *  lock:renew,<resource>,<token>,<lease>
+ *  lock:release,<resource>,<token>
+ *  lock:query[,<resource>]
+ *
+ * "acquire" returns "0 token=<token>" once it has the lock, the token being
+ * needed for "renew" and "release".  Without a wait time it returns EAGAIN
+ * if the lock is held, otherwise the connection waits in a FIFO queue and
+ * gets the lock as soon as it is released or its lease expires, or ETIMEDOUT
+ * after <wait> seconds.  "renew" and "release" return ENOLCK if the token
+ * does not hold the lock (anymore), "query" returns the number of seconds
+ * left on the lease.
+ *
+ * The older format, locking the "server" resource, is still supported:
+ *
+ *  lock:set,<timeout>
+ *  lock:release
+ *  lock:query
+ *
+ * where "set" returns 0 if it got the lock (no token, it is released by any
+ * "release") or the number of seconds left on the lease.  When running from
+ * [x]inetd only the older format works, see lock_file().
+ *
+ */
+void ctl_lock(struct ctl_conn *conn, char *param)
+{
+	int rc;
+	char reply[64];
+	char *cmd_str, *res_str, *token_str, *lease_str, *wait_str;
+	unsigned int wait = 0;
+	struct lock_res *res;
+
+	if (param == NULL || (cmd_str = strtok(param, ",")) == NULL) {
+		SMSG(SMSG_ERR, fprintf(log_fd, "error(lock): bad message\n"));
+		return;
+	}
+
+	if (inetd_flag) {
+		lock_file(conn, cmd_str);
+		return;
+	}
+
+	if (strcasecmp(cmd_str, "set") == 0) {
+		/* older format, no token */
+		lease_str = strtok(NULL, ",");
+		res = lock_find(LOCK_RESOURCE_DEFAULT);
+		if (res == NULL)
+			return;
+		lock_update(res);
+		if (res->token == 0) {
+			lock_take(res, (lease_str != NULL ? atoi(lease_str) : 0));
+			ctl_hlp_sendrc(conn, 0);
+		} else
+			ctl_hlp_sendrc(conn, lock_left(res));
+		return;
+	}
+
+	res_str = strtok(NULL, ",");
+	if (res_str == NULL) {
+		res = lock_find(LOCK_RESOURCE_DEFAULT);
+		if (res == NULL)
+			return;
+		if (strcasecmp(cmd_str, "release") == 0) {
+			/* older format, release whoever holds the lock */
+			res->token = 0;
+			lock_update(res);
+		} else if (strcasecmp(cmd_str, "query") == 0) {
+			lock_update(res);
+			ctl_hlp_sendrc(conn, lock_left(res));
+		} else {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd, "error(lock): bad message\n"));
+			ctl_hlp_sendrc(conn, EINVAL);
+		}
+		return;
+	}
+
+	res = lock_find(res_str);
+	if (res == NULL) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd,
+			     "error(lock): bad resource name %s\n", res_str));
+		ctl_hlp_sendrc(conn, EINVAL);
+		return;
+	}
+	lock_update(res);
+
+	if (strcasecmp(cmd_str, "acquire") == 0) {
+		lease_str = strtok(NULL, ",");
+		wait_str = strtok(NULL, ",");
+		if (lease_str == NULL || atoi(lease_str) <= 0) {
+			rc = EINVAL;
+			goto lock_return;
+		}
+		if (wait_str != NULL)
+			wait = atoi(wait_str);
+
+		if (res->token == 0) {
+			snprintf(reply, sizeof(reply), "0 token=%u",
+				 lock_take(res, atoi(lease_str)));
+			ctl_hlp_sendstr(conn, reply);
+			return;
+		}
+		if (wait == 0) {
+			rc = EAGAIN;
+			goto lock_return;
+		}
+
+		/* queue up, see lock_update() */
+		SMSG(SMSG_NOTICE,
+		     fprintf(log_fd,
+			     "notice(lock): waiting for %s\n", res->name));
+		conn->lock_res = res;
+		conn->lock_lease = atoi(lease_str);
+		conn->lock_deadline = time_ms() + wait * 1000LL;
+		conn->lock_next = NULL;
+		if (res->wait_tail != NULL)
+			res->wait_tail->lock_next = conn;
+		else
+			res->wait_head = conn;
+		res->wait_tail = conn;
+		conn->state = CONN_LOCK;
+		lock_update(res);
+		return;
+	} else if (strcasecmp(cmd_str, "renew") == 0 ||
+		   strcasecmp(cmd_str, "release") == 0) {
+		token_str = strtok(NULL, ",");
+		if (token_str == NULL) {
+			rc = EINVAL;
+			goto lock_return;
+		}
+		if (res->token == 0 ||
+		    res->token != strtoul(token_str, NULL, 10)) {
+			rc = ENOLCK;
+			goto lock_return;
+		}
+		if (strcasecmp(cmd_str, "renew") == 0) {
+			lease_str = strtok(NULL, ",");
+			if (lease_str == NULL || atoi(lease_str) <= 0) {
+				rc = EINVAL;
+				goto lock_return;
+			}
+			res->expires = time_ms() + atoi(lease_str) * 1000LL;
+		} else
+			res->token = 0;
+		lock_update(res);
+		rc = 0;
+	} else if (strcasecmp(cmd_str, "query") == 0) {
+		rc = lock_left(res);
+	} else {
+		SMSG(SMSG_ERR, fprintf(log_fd, "error(lock): bad message\n"));
+		rc = EINVAL;
+	}
+
+lock_return:
+	ctl_hlp_sendrc(conn, rc);
+}
+
+/**
+ * ctl_sendrand - Handle the "sendrand" control message
+ * @conn: control connection
+ * @param: parameter string
+ *
+ * Description:
+ * Send a message to a remote host and return an error code on the control
+ * socket as a positive ASCII integer.  The connection is suspended until the
+ * data is sent, see data_send().  The control message format:
+ *
+ *  sendrand:<host>,tcp|udp,<port>,<bytes>[,<option>...]
+ *
+ * For UDP the data is split into datagrams of "size" bytes (one byte by
+ * default), see data_opts() for the options.
+ *
+ */
+void ctl_sendrand(struct ctl_conn *conn, char *param)
+{
+	int rc;
+	char *host_str, *proto_str, *port_str, *bytes_str, *opts_str;
+	struct addrinfo *host = NULL;
+	struct addrinfo addr_hints;
+	int data_sock = -1;
+	int bool_true = 1;
+
+	if (param == NULL) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(sendrand): bad message\n"));
+		rc = EINVAL;
+		goto sendrand_return;
+	}
+
+	/* parse the control message */
+	host_str = strtok(param, ",");
+	proto_str = strtok(NULL, ",");
+	port_str = strtok(NULL, ",");
+	bytes_str = strtok(NULL, ",");
+	opts_str = strtok(NULL, "");
+	if (bytes_str == NULL) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd, "error(sendrand): bad message\n"));
 		rc = EINVAL;
@@ -550,18 +1381,30 @@ void ctl_sendrand(int sock, struct sockaddr_storage *peer_addr, char *param)
 		goto sendrand_return;
 	}
 	rc = getaddrinfo(host_str, port_str, &addr_hints, &host);
-	if (rc < 0) {
+	if (rc != 0) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd,
 			     "error(sendrand): name resolution failure (%s)\n",
 			     host_str));
+		host = NULL;
 		rc = EFAULT;
 		goto sendrand_return;
 	}
-	bytes = atoi(bytes_str);
+	conn->data_bytes = strtoul(bytes_str, NULL, 10);
+	conn->data_type = host->ai_socktype;
+	rc = data_opts(conn, opts_str);
+	if (rc != 0 || data_buf() == NULL) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(sendrand): bad message\n"));
+		rc = (rc != 0 ? rc : ENOMEM);
+		goto sendrand_return;
+	}
 
-	/* connect to the remote host */
-	data_sock = socket(host->ai_family, host->ai_socktype, host->ai_protocol);
+	/* start connecting to the remote host */
+	data_sock = data_socket(conn,
+				host->ai_family,
+				host->ai_socktype,
+				host->ai_protocol);
 	if (data_sock < 0) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd,
@@ -570,14 +1413,20 @@ void ctl_sendrand(int sock, struct sockaddr_storage *peer_addr, char *param)
 		rc = errno;
 		goto sendrand_return;
 	}
-	if (net_timeout_sec != 0) {
-		timeout.tv_sec = net_timeout_sec;
-		timeout.tv_usec = 0;
-		setsockopt(data_sock, SOL_SOCKET, SO_SNDTIMEO,
-			   &timeout, sizeof(timeout));
+	if (conn->data_flags & DATA_F_ZEROCOPY) {
+		/* fall back to regular sends if not supported */
+		if (conn->data_type != SOCK_STREAM ||
+		    setsockopt(data_sock, SOL_SOCKET, SO_ZEROCOPY,
+			       &bool_true, sizeof(bool_true)) < 0) {
+			SMSG(SMSG_NOTICE,
+			     fprintf(log_fd,
+				     "notice(sendrand): "
+				     "zero-copy not available\n"));
+			conn->data_flags &= ~DATA_F_ZEROCOPY;
+		}
 	}
 	rc = connect(data_sock, host->ai_addr, host->ai_addrlen);
-	if (rc < 0) {
+	if (rc < 0 && errno != EINPROGRESS) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd,
 			     "error(sendrand): "
@@ -586,54 +1435,214 @@ void ctl_sendrand(int sock, struct sockaddr_storage *peer_addr, char *param)
 		goto sendrand_return;
 	}
 
-	/* send the data */
-	for (iter = 0, byte = 'a'; iter < bytes; iter++) {
-		rc = write(data_sock, &byte, 1);
-		if (rc != 1)
-			SMSG(SMSG_WARN,
-			     fprintf(log_fd,
-				     "warning(sendrand): "
-				     "write to socket failed (%d)\n", errno));
-		if (byte++ == 'z')
-			byte = 'a';
+	/* the data is sent once the socket is writable */
+	rc = data_start(conn, data_sock,
+			(rc < 0 ? DATA_SEND_CONNECT : DATA_SEND), EPOLLOUT);
+	if (rc == 0) {
+		data_sock = -1;
+		freeaddrinfo(host);
+		return;
 	}
 
-	rc = 0;
-
 	/* cleanup */
 sendrand_return:
-	ctl_hlp_sendrc(sock, rc);
+	ctl_hlp_sendrc(conn, rc);
 	if (host != NULL)
 		freeaddrinfo(host);
 	net_hlp_socket_close(&data_sock);
 }
 
+/**
+ * data_zerocopy_reap - Drain the zero-copy completion notifications
+ * @conn: control connection
+ *
+ * Description:
+ * The data buffer never changes so there is nothing to wait for, but the
+ * notifications queue up on the socket error queue and need to be read.
+ *
+ */
+void data_zerocopy_reap(struct ctl_conn *conn)
+{
+	char cbuf[CMSG_SPACE(sizeof(struct sock_extended_err))];
+	struct msghdr msg;
+
+	do {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
+	} while (recvmsg(conn->data_sock, &msg, MSG_ERRQUEUE) >= 0);
+}
+
+/**
+ * data_send_stream - Send the "sendrand" data over TCP
+ * @conn: control connection
+ *
+ * Description:
+ * Send as much data as the socket accepts without blocking.  Returns zero
+ * when all the data is sent, EAGAIN when the socket is full, other errno
+ * values on failure.
+ *
+ */
+int data_send_stream(struct ctl_conn *conn)
+{
+	ssize_t rc;
+	size_t len;
+	int flags = MSG_NOSIGNAL;
+	unsigned char *buf = data_buf();
+
+	if (conn->data_flags & DATA_F_ZEROCOPY) {
+		data_zerocopy_reap(conn);
+		flags |= MSG_ZEROCOPY;
+	}
+
+	while (conn->data_done < conn->data_bytes) {
+		len = conn->data_bytes - conn->data_done;
+		if (len > DATA_BUF_SIZE)
+			len = DATA_BUF_SIZE;
+		rc = send(conn->data_sock,
+			  buf + conn->data_done % DATA_PATTERN_LEN, len, flags);
+		if (rc < 0) {
+			if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+				/* out of option memory for the notifications,
+				 * copy this chunk */
+				flags &= ~MSG_ZEROCOPY;
+				continue;
+			}
+			return errno;
+		}
+		if (conn->data_flags & DATA_F_ZEROCOPY)
+			flags |= MSG_ZEROCOPY;
+		conn->data_last = time_us();
+		if (conn->data_time == 0)
+			conn->data_time = conn->data_last;
+		conn->data_done += rc;
+	}
+
+	return 0;
+}
+
+/**
+ * data_send_dgram - Send the "sendrand" data over UDP
+ * @conn: control connection
+ *
+ * Description:
+ * Send the data as datagrams of the requested size, in batches using
+ * sendmmsg().  Returns zero when all the data is sent, EAGAIN when the socket
+ * is full, other errno values on failure.
+ *
+ */
+int data_send_dgram(struct ctl_conn *conn)
+{
+	int rc;
+	int iter;
+	size_t len, off;
+	struct mmsghdr msgs[DATA_VLEN];
+	struct iovec iovs[DATA_VLEN];
+	unsigned char *buf = data_buf();
+
+	while (conn->data_done < conn->data_bytes) {
+		memset(msgs, 0, sizeof(msgs));
+		off = conn->data_done;
+		for (iter = 0; iter < DATA_VLEN && off < conn->data_bytes;
+		     iter++) {
+			len = conn->data_bytes - off;
+			if (len > conn->data_msg_size)
+				len = conn->data_msg_size;
+			iovs[iter].iov_base = buf + off % DATA_PATTERN_LEN;
+			iovs[iter].iov_len = len;
+			msgs[iter].msg_hdr.msg_iov = &iovs[iter];
+			msgs[iter].msg_hdr.msg_iovlen = 1;
+			off += len;
+		}
+		rc = sendmmsg(conn->data_sock, msgs, iter, 0);
+		if (rc < 0)
+			return errno;
+		conn->data_last = time_us();
+		if (conn->data_time == 0)
+			conn->data_time = conn->data_last;
+		for (iter = 0; iter < rc; iter++)
+			conn->data_done += iovs[iter].iov_len;
+	}
+
+	return 0;
+}
+
+/**
+ * data_send - Send the "sendrand" data
+ * @conn: control connection
+ *
+ * Description:
+ * Called when the data socket of @conn is writable, finish the connection
+ * and/or send as much of the data as the socket accepts without blocking.
+ *
+ */
+void data_send(struct ctl_conn *conn)
+{
+	int rc;
+	int err;
+	socklen_t err_len = sizeof(err);
+	size_t done = conn->data_done;
+
+	if (conn->data_op == DATA_SEND_CONNECT) {
+		rc = getsockopt(conn->data_sock, SOL_SOCKET, SO_ERROR,
+				&err, &err_len);
+		if (rc < 0)
+			err = errno;
+		if (err != 0) {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd,
+				     "error(sendrand): "
+				     "unable to connect to remote host (%d)\n",
+				     err));
+			data_done(conn, err);
+			return;
+		}
+		conn->data_op = DATA_SEND;
+	}
+
+	/* send the data */
+	if (conn->data_type == SOCK_STREAM)
+		rc = data_send_stream(conn);
+	else
+		rc = data_send_dgram(conn);
+	if (conn->data_done != done && net_timeout_sec != 0)
+		conn->deadline = time_ms() + net_timeout_sec * 1000LL;
+	if (rc == EAGAIN || rc == EWOULDBLOCK)
+		return;
+	if (rc != 0)
+		SMSG(SMSG_WARN,
+		     fprintf(log_fd,
+			     "warning(sendrand): "
+			     "write to socket failed (%d)\n", rc));
+
+	data_done(conn, 0);
+}
+
 /**
  * ctl_recv - Handle the "recv" control message
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
- * Open a port and wait for input, return an error code on @sock as a positive
- * ASCII integer.  The control message format:
+ * Open a port and wait for input, return an error code on the control socket
+ * as a positive ASCII integer.  The connection is suspended until the data is
+ * received, see data_recv().  The control message format:
+ *
+ *  recv:ipv4|ipv6,tcp|udp,<port>,<bytes>[,<option>...]
  *
- *  recv:ipv4|ipv6,tcp|udp,<port>,<bytes>
+ * The only option used is "stats", see data_opts().
  *
  */
-void ctl_recv(int sock, char *param)
+void ctl_recv(struct ctl_conn *conn, char *param)
 {
 	int rc;
-	char *inet_family_str, *proto_str, *port_str, *bytes_str;
+	char *inet_family_str, *proto_str, *port_str, *bytes_str, *opts_str;
 	int inet_family, data_sock_type, data_sock_proto, bytes;
 	unsigned short port;
 	int data_sock = -1;
-	int child_sock;
 	struct sockaddr_storage data_sockaddr;
 	struct sockaddr_in *data_sockaddr4 = (struct sockaddr_in *)&data_sockaddr;
 	struct sockaddr_in6 *data_sockaddr6 = (struct sockaddr_in6 *)&data_sockaddr;
-	char *recv_buf = NULL;
-	size_t recv_buf_len;
-	size_t bytes_recv = 0;
 	int bool_true = 1;
 
 	if (param == NULL) {
@@ -646,7 +1655,8 @@ void ctl_recv(int sock, char *param)
 	inet_family_str = strtok(param, ",");
 	proto_str = strtok(NULL, ",");
 	port_str = strtok(NULL, ",");
-	bytes_str = strtok(NULL, "");
+	bytes_str = strtok(NULL, ",");
+	opts_str = strtok(NULL, "");
 	if (bytes_str == NULL) {
 		SMSG(SMSG_ERR, fprintf(log_fd, "error(recv): bad message\n"));
 		rc = EINVAL;
@@ -682,9 +1692,17 @@ void ctl_recv(int sock, char *param)
 		rc = EINVAL;
 		goto recv_return;
 	}
+	conn->data_bytes = bytes;
+	conn->data_type = data_sock_type;
+	rc = data_opts(conn, opts_str);
+	if (rc != 0) {
+		SMSG(SMSG_ERR, fprintf(log_fd, "error(recv): bad message\n"));
+		goto recv_return;
+	}
 
 	/* create and bind the socket */
-	data_sock = socket(inet_family, data_sock_type, data_sock_proto);
+	data_sock = data_socket(conn,
+				inet_family, data_sock_type, data_sock_proto);
 	if (data_sock < 0) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd,
@@ -699,6 +1717,7 @@ void ctl_recv(int sock, char *param)
 		     fprintf(log_fd,
 			     "error(recv): failed to configure socket (%d)\n",
 			     errno));
+		rc = errno;
 		goto recv_return;
 	}
 	memset(&data_sockaddr, 0, sizeof(data_sockaddr));
@@ -723,8 +1742,8 @@ void ctl_recv(int sock, char *param)
 		goto recv_return;
 	}
 	if (data_sock_type == SOCK_STREAM) {
-		/* configure the socket for one incoming connection at a time and wait for
-		* a new connection to arrive */
+		/* configure the socket for one incoming connection, it is
+		 * accepted once it arrives */
 		rc = listen(data_sock, 1);
 		if (rc < 0) {
 			SMSG(SMSG_ERR,
@@ -735,101 +1754,316 @@ void ctl_recv(int sock, char *param)
 			rc = errno;
 			goto recv_return;
 		}
-		rc = net_hlp_timeout_rcv(data_sock);
-		if (rc < 0) {
-			SMSG(SMSG_ERR,
-			     fprintf(log_fd,
-				     "error(recv): "
-				     "select failed while waiting (%d)\n",
-				     errno));
-			rc = errno;
-			goto recv_return;
-		} else if (rc == 0) {
-			SMSG(SMSG_NOTICE,
-			     fprintf(log_fd,
-				     "notice(recv): "
-				     "timeout while waiting for "
-				     "a connection\n"));
-			rc = EAGAIN;
-			goto recv_return;
-		}
-		child_sock = accept(data_sock, NULL, 0);
-		if (child_sock < 0) {
-			SMSG(SMSG_WARN,
-			     fprintf(log_fd,
-				     "error(recv): "
-				     "failed to accept a connection (%d)\n",
-				     errno));
-			rc = errno;
-			goto recv_return;
-		}
-
-		/* swap sockets and close the parent */
-		net_hlp_socket_close(&data_sock);
-		data_sock = child_sock;
 	}
 
-	/* get the data from the network */
+	/* the data is read once it arrives */
+	rc = data_start(conn, data_sock,
+			(data_sock_type == SOCK_STREAM ?
+			 DATA_RECV_ACCEPT : DATA_RECV), EPOLLIN);
+	if (rc == 0)
+		return;
+
+recv_return:
+	ctl_hlp_sendrc(conn, rc);
+	net_hlp_socket_close(&data_sock);
+}
+
+/**
+ * data_recv_read - Read the "recv" data
+ * @conn: control connection
+ *
+ * Description:
+ * Read and discard the available data, without copying it where possible:
+ * TCP data is dropped in the kernel using MSG_TRUNC, UDP datagrams are read
+ * in batches with recvmmsg() and truncated to a byte.  Returns the number of
+ * bytes read, zero on EOF, -1 on error.
+ *
+ */
+ssize_t data_recv_read(struct ctl_conn *conn)
+{
+	int rc;
+	int iter;
+	ssize_t len;
+	char bytes[DATA_VLEN];
+	struct mmsghdr msgs[DATA_VLEN];
+	struct iovec iovs[DATA_VLEN];
+
+	if (conn->data_type == SOCK_STREAM)
+		return recv(conn->data_sock, NULL, DATA_BUF_SIZE, MSG_TRUNC);
+
+	memset(msgs, 0, sizeof(msgs));
+	for (iter = 0; iter < DATA_VLEN; iter++) {
+		iovs[iter].iov_base = &bytes[iter];
+		iovs[iter].iov_len = 1;
+		msgs[iter].msg_hdr.msg_iov = &iovs[iter];
+		msgs[iter].msg_hdr.msg_iovlen = 1;
+	}
+	rc = recvmmsg(conn->data_sock, msgs, DATA_VLEN, MSG_TRUNC, NULL);
+	if (rc < 0)
+		return -1;
+	for (iter = 0, len = 0; iter < rc; iter++)
+		len += msgs[iter].msg_len;
+
+	return len;
+}
+
+/**
+ * data_recv - Receive the "recv" data
+ * @conn: control connection
+ *
+ * Description:
+ * Called when the data socket of @conn is readable, accept the connection
+ * and/or read as much data as is available without blocking.  The operation
+ * is finished once the requested number of bytes arrived, at least one read
+ * was done, or the remote host closed the connection.
+ *
+ */
+void data_recv(struct ctl_conn *conn)
+{
+	ssize_t rc;
+	int child_sock;
+
+	if (conn->data_op == DATA_RECV_ACCEPT) {
+		child_sock = accept4(conn->data_sock, NULL, 0, SOCK_NONBLOCK);
+		if (child_sock < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			SMSG(SMSG_WARN,
+			     fprintf(log_fd,
+				     "error(recv): "
+				     "failed to accept a connection (%d)\n",
+				     errno));
+			data_done(conn, errno);
+			return;
+		}
+
+		/* swap sockets and close the parent */
+		evt_del(conn->data_sock);
+		net_hlp_socket_close(&conn->data_sock);
+		if (data_start(conn, child_sock, DATA_RECV, EPOLLIN) != 0) {
+			net_hlp_socket_close(&child_sock);
+			data_done(conn, errno);
+			return;
+		}
+	}
+
+	/* get the data from the network */
 	do {
-		recv_buf_len = 0;
-		do {
-			/* add 16 bytes of extra buffer space */
-			recv_buf_len += bytes + 16;
-			recv_buf = realloc(recv_buf, recv_buf_len + 1);
-			if (recv_buf == NULL) {
-				SMSG(SMSG_ERR,
-				     fprintf(log_fd,
-					     "error(recv): "
-					     "out of memory (%zu)\n",
-					     recv_buf_len));
-				rc = ENOMEM;
-				goto recv_return;
-			}
-			rc = net_hlp_timeout_rcv(data_sock);
-			if (rc < 0) {
-				SMSG(SMSG_ERR,
-				     fprintf(log_fd,
-					     "error(recv): "
-					     "select failed while "
-					     "waiting (%d)\n", errno));
-				rc = errno;
-				goto recv_return;
-			} else if (rc == 0) {
-				SMSG(SMSG_NOTICE,
-				     fprintf(log_fd,
-					     "notice(recv): "
-					     "timeout while waiting "
-					     "for data\n"));
-				rc = EAGAIN;
-				goto recv_return;
-			}
-			rc = recv(data_sock, recv_buf, recv_buf_len, MSG_PEEK);
-		} while (rc == recv_buf_len);
-		rc = recv(data_sock, recv_buf, recv_buf_len, 0);
-		if (rc > 0)
-			bytes_recv += rc;
-	} while ((rc > 0) && (bytes_recv < bytes));
+		rc = data_recv_read(conn);
+		if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+		if (rc > 0) {
+			conn->data_last = time_us();
+			if (conn->data_time == 0)
+				conn->data_time = conn->data_last;
+			conn->data_done += rc;
+			if (net_timeout_sec != 0)
+				conn->deadline = time_ms() +
+						 net_timeout_sec * 1000LL;
+		}
+	} while ((rc > 0) && (conn->data_done < conn->data_bytes));
+
+	data_done(conn, 0);
+}
+
+/**
+ * ready_sockaddr - Get the notification address of a test socket
+ * @addr: the address
+ * @param: "<host>,<proto>,<port>" string
+ *
+ * Description:
+ * Build the abstract unix socket address used to pass the readiness
+ * notification of the given test socket between the "listen" and
+ * "wait_listen" control messages, possibly handled by different server
+ * instances.  Returns the address length or -1 on error.
+ *
+ */
+socklen_t ready_sockaddr(struct sockaddr_un *addr, const char *param)
+{
+	size_t len = strlen(READY_SOCK_PREFIX) + strlen(param);
+
+	if (len + 1 > sizeof(addr->sun_path))
+		return -1;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	/* leading zero byte means abstract namespace */
+	strcpy(addr->sun_path + 1, READY_SOCK_PREFIX);
+	strcat(addr->sun_path + 1, param);
+
+	return offsetof(struct sockaddr_un, sun_path) + len + 1;
+}
+
+/**
+ * ctl_wait_listen - Handle the "wait_listen" control message
+ * @conn: control connection
+ * @param: parameter string
+ *
+ * Description:
+ * Suspend the connection until the remote host reports, using the "listen"
+ * control message, that its test socket is ready or until the timeout (in
+ * seconds) expires.  This is intended to replace fixed "sleep" commands before
+ * "sendrand".  Returns an error code on the control socket as a positive ASCII
+ * integer, ETIMEDOUT if the notification did not arrive.  The control message
+ * format:
+ *
+ *  wait_listen:<host>,tcp|udp,<port>[,<timeout>]
+ *
+ */
+void ctl_wait_listen(struct ctl_conn *conn, char *param)
+{
+	int rc;
+	char *host_str, *proto_str, *port_str, *timeout_str;
+	char key[256];
+	unsigned int timeout = READY_TIMEOUT_DEFAULT;
+	struct sockaddr_un addr;
+	socklen_t addr_len;
+	int ready_sock = -1;
+
+	if (param == NULL) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(wait_listen): bad message\n"));
+		rc = EINVAL;
+		goto wait_listen_return;
+	}
+
+	/* parse the control message */
+	host_str = strtok(param, ",");
+	proto_str = strtok(NULL, ",");
+	port_str = strtok(NULL, ",");
+	timeout_str = strtok(NULL, "");
+	if (port_str == NULL) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(wait_listen): bad message\n"));
+		rc = EINVAL;
+		goto wait_listen_return;
+	}
+	if (timeout_str != NULL)
+		timeout = atoi(timeout_str);
+	snprintf(key, sizeof(key), "%s,%s,%s", host_str, proto_str, port_str);
+	addr_len = ready_sockaddr(&addr, key);
+	if (addr_len == (socklen_t)-1) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(wait_listen): bad message\n"));
+		rc = EINVAL;
+		goto wait_listen_return;
+	}
+
+	/* wait for a datagram on the notification address */
+	ready_sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if (ready_sock < 0) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd,
+			     "error(wait_listen): "
+			     "failed to create socket (%d)\n", errno));
+		rc = errno;
+		goto wait_listen_return;
+	}
+	rc = bind(ready_sock, (struct sockaddr *)&addr, addr_len);
+	if (rc < 0) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd,
+			     "error(wait_listen): "
+			     "failed to bind the socket (%d)\n", errno));
+		rc = errno;
+		goto wait_listen_return;
+	}
+	rc = data_start(conn, ready_sock, DATA_WAIT_LISTEN, EPOLLIN);
+	if (rc == 0) {
+		conn->deadline = time_ms() + timeout * 1000LL;
+		return;
+	}
+
+wait_listen_return:
+	ctl_hlp_sendrc(conn, rc);
+	net_hlp_socket_close(&ready_sock);
+}
+
+/**
+ * data_ready - Receive the "wait_listen" notification
+ * @conn: control connection
+ *
+ */
+void data_ready(struct ctl_conn *conn)
+{
+	char byte;
+
+	if (recv(conn->data_sock, &byte, sizeof(byte), 0) < 0 &&
+	    (errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+
+	data_done(conn, 0);
+}
+
+/**
+ * ctl_listen - Handle the "listen" control message
+ * @conn: control connection
+ * @param: parameter string
+ *
+ * Description:
+ * Notify a pending "wait_listen" with the same parameters that the test socket
+ * is ready and return an error code on the control socket as a positive ASCII
+ * integer, ECONNREFUSED if nobody is waiting (yet).  The control message
+ * format:
+ *
+ *  listen:<host>,tcp|udp,<port>
+ *
+ */
+void ctl_listen(struct ctl_conn *conn, char *param)
+{
+	int rc;
+	struct sockaddr_un addr;
+	socklen_t addr_len;
+	int ready_sock = -1;
+
+	if (param == NULL ||
+	    (addr_len = ready_sockaddr(&addr, param)) == (socklen_t)-1) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd, "error(listen): bad message\n"));
+		rc = EINVAL;
+		goto listen_return;
+	}
+
+	ready_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (ready_sock < 0) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd,
+			     "error(listen): failed to create socket (%d)\n",
+			     errno));
+		rc = errno;
+		goto listen_return;
+	}
+	rc = sendto(ready_sock, "", 1, 0, (struct sockaddr *)&addr, addr_len);
+	if (rc < 0) {
+		SMSG(SMSG_NOTICE,
+		     fprintf(log_fd,
+			     "notice(listen): nobody is waiting for %s (%d)\n",
+			     param, errno));
+		rc = errno;
+		goto listen_return;
+	}
 
 	rc = 0;
 
-recv_return:
-	ctl_hlp_sendrc(sock, rc);
-	net_hlp_socket_close(&data_sock);
+listen_return:
+	ctl_hlp_sendrc(conn, rc);
+	net_hlp_socket_close(&ready_sock);
 }
 
 /**
  * ctl_sockcon - Set the SELinux context for new sockets
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
- * Set the SELinux context for newly created sockets and return an error code
- * on @sock as a positive ASCII integer.  The control message format:
+ * Set the SELinux context for sockets newly created by this connection and
+ * return an error code on the control socket as a positive ASCII integer.  The
+ * control message format:
  *
  *  sockcon:full|mls,<context>
  *
  */
-void ctl_sockcon(int sock, char *param)
+void ctl_sockcon(struct ctl_conn *conn, char *param)
 {
 	int rc;
 	char *type_str, *ctx_str;
@@ -909,27 +2143,31 @@ void ctl_sockcon(int sock, char *param)
 		goto sockcon_return;
 	}
 
-	/* set socket context */
+	/* check the socket context, it is set for each new data socket */
 	rc = setsockcreatecon(sctx);
 	if (rc < 0) {
 		SMSG(SMSG_ERR,
 		     fprintf(log_fd,
 			     "error(sockcon): "
 			     "failed to set the socket context (%s)\n", sctx));
+		free(sctx);
 		goto sockcon_return;
 	}
+	setsockcreatecon(NULL);
+	free(conn->sockcon);
+	conn->sockcon = sctx;
 
 	rc = 0;
 
 sockcon_return:
-	ctl_hlp_sendrc(sock, rc);
+	ctl_hlp_sendrc(conn, rc);
 	if (ctx != NULL)
 		context_free(ctx);
 }
 
 /**
  * ctl_getcon - Get the SELinux context of the running process
- * @sock: socket
+ * @conn: control connection
  * @param: parameter string
  *
  * Description:
@@ -939,7 +2177,7 @@ sockcon_return:
  *  getcon:full|mls
  *
  */
-void ctl_getcon(int sock, char *param)
+void ctl_getcon(struct ctl_conn *conn, char *param)
 {
 	int rc;
 	char *type_str;
@@ -996,13 +2234,681 @@ void ctl_getcon(int sock, char *param)
 	}
 
 	/* send the context back to the client */
-	ctl_hlp_sendstr(sock, ctx_str);
+	ctl_hlp_sendstr(conn, ctx_str);
 
 getcon_return:
 	if (ctx)
 		context_free(ctx);
 }
 
+/**
+ * conn_alloc - Allocate a control connection
+ * @sock: control socket
+ * @peer_addr: remote address, NULL if unknown
+ *
+ * Description:
+ * Allocate and initialize a control connection for @sock, returns the
+ * connection or NULL on error.
+ *
+ */
+struct ctl_conn *conn_alloc(int sock, struct sockaddr_storage *peer_addr)
+{
+	struct ctl_conn *conn;
+
+	conn = calloc(1, sizeof(*conn));
+	if (conn == NULL)
+		return NULL;
+	conn->sock = sock;
+	conn->data_sock = -1;
+	conn->state = CONN_IDLE;
+	conn->ctl_evt.type = EVT_CTL;
+	conn->ctl_evt.conn = conn;
+	conn->data_evt.type = EVT_DATA;
+	conn->data_evt.conn = conn;
+	if (peer_addr != NULL)
+		conn->peer_addr = *peer_addr;
+
+	return conn;
+}
+
+/**
+ * conn_new - Create a new control connection
+ * @sock: control socket
+ * @peer_addr: remote address, NULL if unknown
+ *
+ * Description:
+ * Allocate a control connection for @sock and add it to the event loop,
+ * returns the connection or NULL on error.
+ *
+ */
+struct ctl_conn *conn_new(int sock, struct sockaddr_storage *peer_addr)
+{
+	struct ctl_conn *conn;
+
+	conn = conn_alloc(sock, peer_addr);
+	if (conn == NULL)
+		return NULL;
+
+	if (evt_add(sock, EPOLLIN, &conn->ctl_evt) < 0) {
+		free(conn);
+		return NULL;
+	}
+
+	conn->next = conn_list;
+	conn_list = conn;
+
+	return conn;
+}
+
+/**
+ * conn_chan - Get a channel of a framed control connection
+ * @parent: control connection
+ * @chan: channel number, not 0
+ *
+ * Description:
+ * Returns the channel @chan of @parent, creating it on first use, or NULL on
+ * error.  A channel is a control connection of its own, fed by its parent
+ * instead of the event loop and writing to a duplicate of the parent socket.
+ * The first channel takes the instance out of the pid file, see drop_pid().
+ *
+ */
+struct ctl_conn *conn_chan(struct ctl_conn *parent, uint32_t chan)
+{
+	struct ctl_conn *conn;
+	int sock;
+
+	for (conn = conn_list; conn != NULL; conn = conn->next)
+		if (conn->parent == parent && conn->chan == chan)
+			return conn;
+
+	sock = -1;
+	if (parent->sock >= 0) {
+		sock = dup(parent->sock);
+		if (sock < 0)
+			return NULL;
+	}
+	conn = conn_alloc(sock, &parent->peer_addr);
+	if (conn == NULL) {
+		if (sock >= 0)
+			close(sock);
+		return NULL;
+	}
+	conn->chan = chan;
+	conn->parent = parent;
+	conn->proto = CTL_PROTO_FRAMED;
+
+	if (inetd_flag && pid_file != NULL) {
+		drop_pid(pid_file);
+		pid_file = NULL;
+	}
+
+	/* right after the parent, so that the main loop runs it next */
+	conn->next = parent->next;
+	parent->next = conn;
+
+	return conn;
+}
+
+/**
+ * conn_free - Destroy a control connection
+ * @conn: control connection
+ *
+ * Description:
+ * Remove @conn from the connection list, close its sockets and free it.
+ *
+ */
+void conn_free(struct ctl_conn *conn)
+{
+	struct ctl_conn **iter;
+
+	for (iter = &conn_list; *iter != NULL; iter = &(*iter)->next)
+		if (*iter == conn) {
+			*iter = conn->next;
+			break;
+		}
+	for (iter = &conn_list; *iter != NULL; iter = &(*iter)->next)
+		if ((*iter)->parent == conn)
+			(*iter)->parent = NULL;
+
+	if (conn->lock_res != NULL)
+		lock_cancel(conn);
+	ctl_hlp_close(conn);
+	evt_del(conn->data_sock);
+	net_hlp_socket_close(&conn->data_sock);
+	free(conn->msg_buf);
+	free(conn->resp_buf);
+	free(conn->sockcon);
+	free(conn);
+}
+
+/**
+ * conn_detach - Close the control socket of a connection
+ * @conn: control connection
+ *
+ * Description:
+ * Close the control socket, the remaining control messages are still handled
+ * but their output is discarded.
+ *
+ */
+void conn_detach(struct ctl_conn *conn)
+{
+	ctl_hlp_close(conn);
+}
+
+/**
+ * conn_buf_add - Add data to the message buffer of a connection
+ * @conn: control connection
+ * @buf: data
+ * @len: length of @buf
+ *
+ * Description:
+ * Append @buf to the message buffer dropping the CTL_MSG_BAD_CHARS on the way
+ * (text protocol only), returns zero on success, negative values on failure.
+ * The space of the messages already handled is reclaimed once it is at least
+ * half of the buffer so that every byte is moved only a few times.
+ *
+ */
+int conn_buf_add(struct ctl_conn *conn, const char *buf, size_t len)
+{
+	size_t iter;
+	char *msg_buf;
+	size_t msg_size;
+
+	/* drop the messages already handled, unless that is all of the
+	 * request in progress as its end would look like no request then */
+	if (conn->msg_off > 0 && conn->msg_off >= conn->msg_len / 2 &&
+	    conn->msg_off != conn->frame_end) {
+		conn->msg_len -= conn->msg_off;
+		memmove(conn->msg_buf,
+			conn->msg_buf + conn->msg_off, conn->msg_len);
+		if (conn->frame_end != 0)
+			conn->frame_end -= conn->msg_off;
+		conn->msg_off = 0;
+	}
+
+	/* add the data to the message buffer */
+	if (conn->msg_len + len + 1 > conn->msg_size) {
+		msg_size = conn->msg_size * 2;
+		if (msg_size < conn->msg_len + len + 1)
+			msg_size = conn->msg_len + len + 1;
+		msg_buf = realloc(conn->msg_buf, msg_size);
+		if (msg_buf == NULL) {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd, "error: out of memory\n"));
+			return -1;
+		}
+		conn->msg_buf = msg_buf;
+		conn->msg_size = msg_size;
+	}
+	msg_buf = conn->msg_buf;
+	if (conn->proto == CTL_PROTO_FRAMED) {
+		memcpy(msg_buf + conn->msg_len, buf, len);
+		conn->msg_len += len;
+	} else {
+		for (iter = 0; iter < len; iter++)
+			if (strchr(CTL_MSG_BAD_CHARS, buf[iter]) == NULL)
+				msg_buf[conn->msg_len++] = buf[iter];
+	}
+	msg_buf[conn->msg_len] = '\0';
+
+	return 0;
+}
+
+/**
+ * conn_read - Read control messages from a connection
+ * @conn: control connection
+ *
+ * Description:
+ * Called when the control socket is readable, append the incoming data to the
+ * message buffer.
+ *
+ */
+void conn_read(struct ctl_conn *conn)
+{
+	int rc;
+	char recv_buf[CTL_SOCK_BUF_SIZE];
+
+	rc = recv(conn->sock, recv_buf, sizeof(recv_buf), 0);
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return;
+		SMSG(SMSG_WARN,
+		     fprintf(log_fd,
+			     "warning: failed to read the "
+			     "control message (%d)\n", errno));
+	}
+	if (rc <= 0) {
+		/* the remote host is done, keep the socket for the replies
+		 * to the messages we have already got */
+		evt_del(conn->sock);
+		conn->eof = 1;
+		return;
+	}
+
+	if (conn->proto == CTL_PROTO_NONE)
+		conn->proto = (recv_buf[0] == '\0' ?
+			       CTL_PROTO_FRAMED : CTL_PROTO_TEXT);
+
+	if (conn_buf_add(conn, recv_buf, rc) < 0) {
+		evt_del(conn->sock);
+		conn->eof = 1;
+	}
+}
+
+/**
+ * conn_frame_start - Start the next request of a framed connection
+ * @conn: control connection
+ *
+ * Description:
+ * Start handling the request at the head of the message buffer if all of it
+ * has arrived, returns zero if the request was started, negative values
+ * otherwise.  Requests for other channels are passed on to the channel.  A
+ * request that is too large means the client does not speak the framed
+ * protocol, the rest of the connection is ignored then.
+ *
+ */
+int conn_frame_start(struct ctl_conn *conn)
+{
+	uint32_t hdr[3];
+	size_t len;
+	uint32_t chan;
+	struct ctl_conn *chan_conn;
+
+	for (;;) {
+		if (conn->msg_len - conn->msg_off < CTL_FRAME_HDR_SIZE)
+			return -1;
+		memcpy(hdr, conn->msg_buf + conn->msg_off, CTL_FRAME_HDR_SIZE);
+		len = ntohl(hdr[0]);
+		if (len > CTL_FRAME_LEN_MAX) {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd,
+				     "error: bad control request length "
+				     "(%zu)\n", len));
+			evt_del(conn->sock);
+			conn->eof = 1;
+			conn->msg_off = conn->msg_len;
+			return -1;
+		}
+		if (conn->msg_len - conn->msg_off - CTL_FRAME_HDR_SIZE < len)
+			return -1;
+
+		chan = ntohl(hdr[2]);
+		if (chan == conn->chan)
+			break;
+
+		/* a request for one of the channels, only the connection
+		 * itself has any */
+		chan_conn = NULL;
+		if (conn->chan == 0)
+			chan_conn = conn_chan(conn, chan);
+		if (chan_conn == NULL ||
+		    conn_buf_add(chan_conn, conn->msg_buf + conn->msg_off,
+				 CTL_FRAME_HDR_SIZE + len) < 0)
+			SMSG(SMSG_WARN,
+			     fprintf(log_fd,
+				     "warning: dropped control request %u "
+				     "for channel %u\n", ntohl(hdr[1]), chan));
+		conn->msg_off += CTL_FRAME_HDR_SIZE + len;
+	}
+
+	conn->frame_id = ntohl(hdr[1]);
+	conn->msg_off += CTL_FRAME_HDR_SIZE;
+	conn->frame_end = conn->msg_off + len;
+
+	/* room for the header, filled in by conn_frame_reply() */
+	conn->resp_len = 0;
+	if (ctl_hlp_resp_add(conn, hdr, CTL_FRAME_HDR_SIZE) < 0)
+		conn_detach(conn);
+
+	return 0;
+}
+
+/**
+ * conn_frame_reply - Send the response of a framed connection
+ * @conn: control connection
+ *
+ * Description:
+ * Send the response with the replies to the messages of the current request
+ * handled so far.
+ *
+ */
+void conn_frame_reply(struct ctl_conn *conn)
+{
+	uint32_t hdr[3];
+
+	if (conn->sock < 0)
+		return;
+
+	hdr[0] = htonl(conn->resp_len - CTL_FRAME_HDR_SIZE);
+	hdr[1] = htonl(conn->frame_id);
+	hdr[2] = htonl(conn->chan);
+	memcpy(conn->resp_buf, hdr, CTL_FRAME_HDR_SIZE);
+	ctl_hlp_write(conn->sock, conn->resp_buf, conn->resp_len);
+}
+
+/**
+ * conn_frame_done - Finish the current request of a framed connection
+ * @conn: control connection
+ *
+ * Description:
+ * Send the response with the replies to all the messages of the request.
+ *
+ */
+void conn_frame_done(struct ctl_conn *conn)
+{
+	conn->frame_end = 0;
+	conn_frame_reply(conn);
+}
+
+/**
+ * conn_msg - Get the next control message of a connection
+ * @conn: control connection
+ *
+ * Description:
+ * Returns the next complete control message, NUL terminated in place of its
+ * ';', or NULL if there is none yet.  The message buffer is scanned only once
+ * as the handled messages are skipped rather than removed.  For the framed
+ * protocol this also starts and finishes the requests as needed.
+ *
+ */
+char *conn_msg(struct ctl_conn *conn)
+{
+	char *msg, *msg_end;
+	size_t limit;
+
+	for (;;) {
+		if (conn->proto == CTL_PROTO_FRAMED) {
+			if (conn->frame_end != 0 &&
+			    conn->msg_off >= conn->frame_end)
+				conn_frame_done(conn);
+			if (conn->frame_end == 0 && conn_frame_start(conn) < 0)
+				return NULL;
+			limit = conn->frame_end;
+		} else
+			limit = conn->msg_len;
+
+		msg = conn->msg_buf + conn->msg_off;
+		msg_end = memchr(msg, ';', limit - conn->msg_off);
+		if (msg_end != NULL) {
+			*msg_end = '\0';
+			conn->msg_off = msg_end - conn->msg_buf + 1;
+			return msg;
+		}
+		if (conn->proto != CTL_PROTO_FRAMED)
+			return NULL;
+
+		/* requests always end with a ';' */
+		SMSG(SMSG_WARN,
+		     fprintf(log_fd,
+			     "warning: incomplete control message "
+			     "in request %u\n", conn->frame_id));
+		conn->msg_off = conn->frame_end;
+	}
+}
+
+/**
+ * ctl_cancel - Handle the "cancel" control message
+ * @conn: control connection
+ *
+ * Description:
+ * Abort all the other channels of the control connection: the operation in
+ * progress fails with ECANCELED, the response so far is sent and the rest of
+ * the requests are dropped, the same as if the client closed a separate
+ * connection for each of them.  The control message format:
+ *
+ *  cancel
+ *
+ * The reply is the number of channels cancelled.
+ *
+ */
+void ctl_cancel(struct ctl_conn *conn)
+{
+	struct ctl_conn *root = (conn->chan != 0 ? conn->parent : conn);
+	struct ctl_conn *iter;
+	int count = 0;
+
+	for (iter = conn_list; root != NULL && iter != NULL;
+	     iter = iter->next) {
+		if (iter->parent != root || iter == conn ||
+		    (iter->sock < 0 && iter->state == CONN_IDLE))
+			continue;
+
+		switch (iter->state) {
+		case CONN_SLEEP:
+			iter->state = CONN_IDLE;
+			break;
+		case CONN_LOCK:
+			lock_cancel(iter);
+			iter->state = CONN_IDLE;
+			ctl_hlp_sendrc(iter, ECANCELED);
+			break;
+		case CONN_DATA:
+			data_done(iter, ECANCELED);
+			break;
+		}
+		iter->deadline = 0;
+		if (iter->frame_end != 0)
+			conn_frame_done(iter);
+		iter->msg_off = iter->msg_len;
+		conn_detach(iter);
+		count++;
+	}
+
+	ctl_hlp_sendrc(conn, count);
+}
+
+/**
+ * conn_run - Handle the pending control messages of a connection
+ * @conn: control connection
+ *
+ * Description:
+ * Handle complete control messages in the message buffer, in order, until
+ * the buffer is empty or one of them suspends the connection.
+ *
+ */
+void conn_run(struct ctl_conn *conn)
+{
+	char *msg;
+	char *ctl_cmd, *ctl_param;
+	uint32_t rec_len = 0;
+
+	while (run_loop && conn->state == CONN_IDLE &&
+	       (msg = conn_msg(conn)) != NULL) {
+		SMSG(SMSG_NOTICE,
+			fprintf(log_fd,
+				"handling request %s\n", msg));
+
+		/* start the reply record of this message */
+		if (conn->proto == CTL_PROTO_FRAMED && conn->sock >= 0) {
+			conn->resp_rec = conn->resp_len;
+			if (ctl_hlp_resp_add(conn, &rec_len,
+					     sizeof(rec_len)) < 0)
+				conn_detach(conn);
+		}
+
+		ctl_cmd = strtok(msg, ":");
+		ctl_param = strtok(NULL, "");
+		if (ctl_cmd != NULL) {
+			if (strcasecmp(ctl_cmd, "exit") == 0) {
+				run_loop = 0;
+			} else if (strcasecmp(ctl_cmd, "detach") == 0) {
+				/* nothing more is sent, so send it now */
+				if (conn->proto == CTL_PROTO_FRAMED)
+					conn_frame_reply(conn);
+				conn_detach(conn);
+			} else if (strcasecmp(ctl_cmd, "cancel") == 0) {
+				ctl_cancel(conn);
+			} else if (strcasecmp(ctl_cmd, "echo") == 0) {
+				ctl_echo(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "sleep") == 0) {
+				ctl_sleep(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "lock") == 0) {
+				ctl_lock(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "sendrand") == 0) {
+				ctl_sendrand(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "recv") == 0) {
+				ctl_recv(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "wait_listen") == 0) {
+				ctl_wait_listen(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "listen") == 0) {
+				ctl_listen(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "sockcon") == 0) {
+				ctl_sockcon(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "getcon") == 0) {
+				ctl_getcon(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "remote_call") == 0) {
+				ctl_remote_call(conn, ctl_param);
+			} else if (strcasecmp(ctl_cmd, "ipsec") == 0) {
+				ctl_ipsec(conn->sock, ctl_param);
+			} else {
+				SMSG(SMSG_WARN,
+				     fprintf(log_fd,
+					     "warning: unknown control "
+					     "message (%s)\n",
+					     ctl_cmd));
+			}
+		}
+	}
+
+	/* when running via [x]inetd give up on an idle client after the
+	 * network timeout, the channels go away with their connection */
+	if (conn->state == CONN_IDLE)
+		conn->deadline = (inetd_flag && net_timeout_sec != 0 &&
+				  conn->chan == 0 ?
+				  time_ms() + net_timeout_sec * 1000LL : 0);
+}
+
+/**
+ * conn_timeout - Handle an expired connection deadline
+ * @conn: control connection
+ *
+ */
+void conn_timeout(struct ctl_conn *conn)
+{
+	conn->deadline = 0;
+
+	switch (conn->state) {
+	case CONN_SLEEP:
+		conn->state = CONN_IDLE;
+		break;
+	case CONN_LOCK:
+		/* the lease of the holder may be over */
+		lock_update(conn->lock_res);
+		if (conn->state != CONN_LOCK ||
+		    conn->lock_deadline > time_ms())
+			break;
+		SMSG(SMSG_NOTICE,
+		     fprintf(log_fd,
+			     "notice(lock): timeout while waiting for %s\n",
+			     conn->lock_res->name));
+		lock_cancel(conn);
+		conn->state = CONN_IDLE;
+		conn->deadline = 0;
+		ctl_hlp_sendrc(conn, ETIMEDOUT);
+		break;
+	case CONN_DATA:
+		if (conn->data_op == DATA_RECV_ACCEPT)
+			SMSG(SMSG_NOTICE,
+			     fprintf(log_fd,
+				     "notice(recv): "
+				     "timeout while waiting for "
+				     "a connection\n"));
+		else if (conn->data_op == DATA_RECV)
+			SMSG(SMSG_NOTICE,
+			     fprintf(log_fd,
+				     "notice(recv): "
+				     "timeout while waiting for data\n"));
+		else if (conn->data_op == DATA_WAIT_LISTEN)
+			SMSG(SMSG_NOTICE,
+			     fprintf(log_fd,
+				     "notice(wait_listen): "
+				     "timeout while waiting for "
+				     "the notification\n"));
+		else
+			SMSG(SMSG_NOTICE,
+			     fprintf(log_fd,
+				     "notice(sendrand): "
+				     "timeout while sending data\n"));
+		data_done(conn, (conn->data_op == DATA_RECV_ACCEPT ||
+				 conn->data_op == DATA_RECV ?
+				 EAGAIN : ETIMEDOUT));
+		break;
+	case CONN_IDLE:
+		SMSG(SMSG_NOTICE,
+		     fprintf(log_fd,
+			     "notice: timeout while waiting for data\n"));
+		evt_del(conn->sock);
+		conn->eof = 1;
+		break;
+	}
+}
+
+/**
+ * conn_done - Check if a connection can be destroyed
+ * @conn: control connection
+ *
+ * Description:
+ * Returns true if nothing more can happen on @conn: the control socket is
+ * closed or at EOF (for a channel, the one of its connection), no operation
+ * is in progress, no complete control message (or request) is left and no
+ * channel is left.  Called right after conn_run() so anything left in the
+ * buffer at this point is incomplete.
+ *
+ */
+int conn_done(struct ctl_conn *conn)
+{
+	struct ctl_conn *iter;
+
+	if (conn->state != CONN_IDLE)
+		return 0;
+
+	if (conn->chan != 0)
+		return (conn->sock < 0 || conn->eof || conn->parent == NULL ||
+			conn->parent->sock < 0 || conn->parent->eof);
+
+	if (conn->sock >= 0 && !conn->eof)
+		return 0;
+	for (iter = conn_list; iter != NULL; iter = iter->next)
+		if (iter->parent == conn)
+			return 0;
+	return 1;
+}
+
+/**
+ * ctl_accept - Accept new control connections
+ * @ctl_sock: listening control socket
+ *
+ */
+void ctl_accept(int ctl_sock)
+{
+	int rem_sock;
+	struct sockaddr_storage peer_addr;
+	socklen_t peer_addr_len;
+
+	for (;;) {
+		peer_addr_len = sizeof(peer_addr);
+		rem_sock = accept(ctl_sock,
+				  (struct sockaddr *)&peer_addr,
+				  &peer_addr_len);
+		if (rem_sock < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				SMSG(SMSG_WARN,
+				     fprintf(log_fd,
+					     "warning: failed to accept new "
+					     "control connection (%d)\n",
+					     errno));
+			return;
+		}
+		if (conn_new(rem_sock, &peer_addr) == NULL) {
+			SMSG(SMSG_WARN,
+			     fprintf(log_fd,
+				     "warning: failed to set up new "
+				     "control connection (%d)\n", errno));
+			close(rem_sock);
+		}
+	}
+}
+
 /*
  * main
  */
@@ -1010,25 +2916,25 @@ int main(int argc, char *argv[])
 {
 	int rc;
 	int arg_iter;
-	int run_loop = 1;
 	unsigned short ctl_port = CTL_SOCK_PORT_DEFAULT;
 	int ctl_sock = -1;
 	int rem_sock = -1;
 	struct sockaddr_in6 ctl_sockaddr;
-	struct sockaddr_storage peer_addr;
-	socklen_t peer_addr_len;
-	char *msg_buf = NULL;
-	char *msg_buf_next;
-	char *recv_buf = NULL;
-	size_t recv_buf_len = 0;
-	char *ctl_cmd, *ctl_param;
+	struct evt_src ctl_evt = { EVT_LISTEN, NULL };
+	struct epoll_event evts[EVT_MAX];
+	struct evt_src *src;
+	struct ctl_conn *conn, *conn_next;
+	long long time_now, deadline;
+	int timeout;
+	int evt_iter;
 
 	int bool_true = 1;
-	size_t tmp_sze;
-	int inetd_flag = 0;
 
 	log_fd = stderr;
 
+	/* a client going away must not take the other connections with it */
+	signal(SIGPIPE, SIG_IGN);
+
 	/* command line arguments */
 	do {
 		arg_iter = getopt(argc, argv, "ip:f:qt:vl:");
@@ -1046,7 +2952,8 @@ int main(int argc, char *argv[])
 				if (write_pid(optarg) < 0) {
 				  fprintf(stderr,
 					  "error: failed to create pidfile %s\n", optarg);
-				}
+				} else
+				  pid_file = optarg;
 				break;
 			case 'q':
 				/* quiet */
@@ -1075,9 +2982,19 @@ int main(int argc, char *argv[])
 		}
 	} while (arg_iter > 0);
 
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		SMSG(SMSG_ERR,
+		     fprintf(log_fd,
+			     "error: failed to create the "
+			     "event loop (%d)\n", errno));
+		return 1;
+	}
+
 	if (!inetd_flag) {
 		/* create, bind, and start listening on the control socket */
-		ctl_sock = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+		ctl_sock = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK,
+				  IPPROTO_TCP);
 		if (ctl_sock < 0) {
 			SMSG(SMSG_ERR,
 			     fprintf(log_fd,
@@ -1116,6 +3033,13 @@ int main(int argc, char *argv[])
 				     "control socket (%d)\n", errno));
 			return 1;
 		}
+		if (evt_add(ctl_sock, EPOLLIN, &ctl_evt) < 0) {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd,
+				     "error: failed to watch the "
+				     "control socket (%d)\n", errno));
+			return 1;
+		}
 	} else {
 		/* dup stdin to rem_sock */
 		rem_sock = dup(fileno(stdin));
@@ -1126,168 +3050,98 @@ int main(int argc, char *argv[])
 				     "control fd (%d)\n", errno));
 			return 1;
 		}
+		conn = conn_new(rem_sock, NULL);
+		if (conn == NULL) {
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd,
+				     "error: failed to set up the "
+				     "control connection (%d)\n", errno));
+			return 1;
+		}
+		conn_run(conn);
 	}
 
-	/* loop on incoming messages */
+	/* loop on incoming messages and data socket events */
 	while (run_loop) {
-		if (rem_sock < 0) {
-			if (!inetd_flag) {
-				/* get a new connection and don't honor the timeout
-				 * here, assume we are running as a daemon */
-				peer_addr_len = sizeof(peer_addr);
-				rem_sock = accept(ctl_sock,
-						  (struct sockaddr *)&peer_addr,
-						  &peer_addr_len);
-				if (rem_sock < 0) {
-					SMSG(SMSG_WARN,
-					     fprintf(log_fd,
-						     "warning: failed to accept new "
-						     "control connection (%d)\n",
-						     errno));
-					continue;
-				}
-			} else {
-				/* running via [x]inetd and the only client conn
-				 * got closed, exit */
+		/* sleep until the nearest connection deadline */
+		timeout = -1;
+		time_now = time_ms();
+		for (conn = conn_list; conn != NULL; conn = conn->next) {
+			/* a connection left over when its last channel went
+			 * away in the previous pass */
+			if (conn_done(conn)) {
+				timeout = 0;
 				break;
 			}
+			if (conn->deadline == 0)
+				continue;
+			deadline = conn->deadline - time_now;
+			if (deadline < 0)
+				deadline = 0;
+			if (timeout < 0 || deadline < timeout)
+				timeout = deadline;
 		}
 
-		/* get a new message */
-		if ((msg_buf == NULL) || (strchr(msg_buf, ';') == NULL)) {
-			/* get more data from the network */
-			recv_buf_len = 0;
-			do {
-				recv_buf_len += CTL_SOCK_BUF_SIZE - 1;
-				recv_buf = realloc(recv_buf, recv_buf_len + 1);
-				if (recv_buf == NULL) {
-					SMSG(SMSG_ERR,
-					     fprintf(log_fd,
-						     "error: out of memory "
-						     "(%zu)\n", recv_buf_len));
-					return 1;
-				}
-				rc = net_hlp_timeout_rcv(rem_sock);
-				if (rc < 0) {
-					SMSG(SMSG_ERR,
-					     fprintf(log_fd,
-						     "error: select failed "
-						     "while waiting (%d)\n",
-						     errno));
-					return 1;
-				} else if (rc == 0) {
-					SMSG(SMSG_NOTICE,
-					     fprintf(log_fd,
-						     "notice: timeout while "
-						     "waiting for data\n"));
-					if (!inetd_flag)
-						continue;
-					else
-						return 0;
-				}
-				rc = recv(rem_sock, recv_buf, recv_buf_len, MSG_PEEK);
-			} while (rc == recv_buf_len);
-			memset(recv_buf, 0, recv_buf_len + 1);
-			rc = recv(rem_sock, recv_buf, recv_buf_len, 0);
-			if (rc == 0) {
-				/* connection is closed */
-				if (!inetd_flag)
-					/* reset for a new connection */
-					net_hlp_socket_close(&rem_sock);
-				else
-					/* we die and let [x]inetd handle any
-					 * new connections */
-					return 0;
-				continue;
-			} else if (rc < 0) {
-				SMSG(SMSG_WARN,
-				     fprintf(log_fd,
-					     "warning: failed to read the "
-					     "control message (%d)\n", errno));
+		rc = epoll_wait(epoll_fd, evts, EVT_MAX, timeout);
+		if (rc < 0) {
+			if (errno == EINTR)
 				continue;
-			}
-
-			/* clean up the data */
-			do {
-				tmp_sze = strcspn(recv_buf, CTL_MSG_BAD_CHARS);
-				if (tmp_sze < strlen(recv_buf)) {
-					char *bad_str = recv_buf + tmp_sze;
-					char *good_str = bad_str +
-					     strspn(bad_str, CTL_MSG_BAD_CHARS);
-					memmove(bad_str, good_str, strlen(good_str) + 1);
-				}
-			} while (tmp_sze < strlen(recv_buf));
-
-			/* add the data to the message buffer */
-			if (msg_buf != NULL) {
-				msg_buf = realloc(msg_buf, strlen(msg_buf) + strlen(recv_buf) + 1);
-				if (msg_buf == NULL) {
-					SMSG(SMSG_ERR,
-					     fprintf(log_fd,
-						     "error: out of memory\n"));
-					return 1;
-				}
-				strcat(msg_buf, recv_buf);
-			} else {
-				msg_buf = recv_buf;
-				recv_buf = NULL;
-			}
+			SMSG(SMSG_ERR,
+			     fprintf(log_fd,
+				     "error: epoll_wait failed (%d)\n", errno));
+			return 1;
 		}
 
-		SMSG(SMSG_NOTICE,
-			fprintf(log_fd,
-				"handling request %s\n", msg_buf));
-
-		/* parse/handle the message buffer */
-		while ((msg_buf_next = strchr(msg_buf, ';')) != NULL) {
-			*msg_buf_next++ = '\0';
-
-			ctl_cmd = strtok(msg_buf, ":");
-			ctl_param = strtok(NULL, "");
-			if (ctl_cmd != NULL) {
-				if (strcasecmp(ctl_cmd, "exit") == 0) {
-					run_loop = 0;
-				} else if (strcasecmp(ctl_cmd, "detach") == 0) {
-					net_hlp_socket_close(&rem_sock);
-				} else if (strcasecmp(ctl_cmd, "echo") == 0) {
-					ctl_echo(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd, "sleep") == 0) {
-					ctl_sleep(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd, "lock") == 0) {
-					ctl_lock(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd,
-						      "sendrand") == 0) {
-					ctl_sendrand(rem_sock,
-						     &peer_addr,
-						     ctl_param);
-				} else if (strcasecmp(ctl_cmd, "recv") == 0) {
-					ctl_recv(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd,
-						      "sockcon") == 0) {
-					ctl_sockcon(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd, "getcon") == 0) {
-					ctl_getcon(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd, "remote_call") == 0) {
-					ctl_remote_call(rem_sock, ctl_param);
-				} else if (strcasecmp(ctl_cmd, "ipsec") == 0) {
-					ctl_ipsec(rem_sock, ctl_param);
-				} else {
-					SMSG(SMSG_WARN,
-					     fprintf(log_fd,
-						     "warning: unknown control "
-						     "message (%s)\n",
-						     ctl_cmd));
-				}
+		for (evt_iter = 0; evt_iter < rc; evt_iter++) {
+			src = evts[evt_iter].data.ptr;
+			switch (src->type) {
+			case EVT_LISTEN:
+				ctl_accept(ctl_sock);
+				break;
+			case EVT_CTL:
+				conn_read(src->conn);
+				break;
+			case EVT_DATA:
+				/* the event may be stale if an earlier event
+				 * in this batch finished the operation */
+				if (src->conn->state != CONN_DATA)
+					break;
+				if (src->conn->data_op == DATA_SEND_CONNECT ||
+				    src->conn->data_op == DATA_SEND)
+					data_send(src->conn);
+				else if (src->conn->data_op == DATA_WAIT_LISTEN)
+					data_ready(src->conn);
+				else if (src->conn->data_op == DATA_CHILD)
+					data_child(src->conn);
+				else
+					data_recv(src->conn);
+				break;
 			}
+		}
 
-			memmove(msg_buf, msg_buf_next, strlen(msg_buf_next) + 1);
+		/* expire deadlines, run the pending messages and drop the
+		 * finished connections */
+		time_now = time_ms();
+		for (conn = conn_list; conn != NULL; conn = conn_next) {
+			if (conn->deadline != 0 && conn->deadline <= time_now)
+				conn_timeout(conn);
+			conn_run(conn);
+			/* after conn_run(), it may have added channels */
+			conn_next = conn->next;
+			if (conn_done(conn))
+				conn_free(conn);
 		}
+
+		/* running via [x]inetd and the only client conn is done */
+		if (inetd_flag && conn_list == NULL)
+			break;
 	}
 
 	/* cleanup */
+	while (conn_list != NULL)
+		conn_free(conn_list);
 	net_hlp_socket_close(&ctl_sock);
-	if (recv_buf)
-		free(recv_buf);
+	close(epoll_fd);
 
 	return 0;
 }